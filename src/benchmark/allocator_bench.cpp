@@ -0,0 +1,59 @@
+#include <memory>
+#include <pbconf/message_allocator.h>
+#include <pbconf/pbconf.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Reloading a yaml config into heap messages, into messages on
+// arenas sized after the previous load, and into reused messages.
+
+static const int kEndpoints = 2000;
+
+static std::string EndpointsYaml() {
+    std::string content = "endpoints:\n";
+    for (int i = 0; i < kEndpoints; ++i) {
+        content += "  - name: endpoint-" + std::to_string(i) + "\n"
+            "    host: 10.0." + std::to_string(i % 256) + ".1\n"
+            "    port: " + std::to_string(8000 + i % 1000) + "\n"
+            "    protocol: GRPC\n"
+            "    tags: [zone-" + std::to_string(i % 8) + ", canary]\n";
+    }
+    return content;
+}
+
+static bool ReloadEndpoints(bool arena, bool reuse, int64_t iterations, std::string& err_msg) {
+    const std::string filename = "allocator_bench.yml";
+    if (!pbconf::bench::WriteFile(filename, EndpointsYaml())) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    pbconf::MessageAllocator allocator(bench::Endpoints::default_instance());
+    allocator.SetArena(arena).SetReuse(reuse);
+    // The current conf stays alive while the next one loads.
+    std::shared_ptr<::google::protobuf::Message> current;
+    for (int64_t i = 0; i < iterations; ++i) {
+        std::shared_ptr<::google::protobuf::Message> fresh = allocator.New();
+        pbconf::PbConf conf;
+        if (!conf.SetFilename(filename).SetUseGenerated(false).Load(*fresh)) {
+            err_msg = conf.ErrorMessage();
+            return false;
+        }
+        current = std::move(fresh);
+    }
+    return true;
+}
+
+PBCONF_BENCH(ReloadEndpointsOnHeap) {
+    return ReloadEndpoints(false, false, iterations, err_msg);
+}
+
+PBCONF_BENCH(ReloadEndpointsOnArena) {
+    return ReloadEndpoints(true, false, iterations, err_msg);
+}
+
+PBCONF_BENCH(ReloadEndpointsReused) {
+    return ReloadEndpoints(false, true, iterations, err_msg);
+}
@@ -0,0 +1,47 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pbconf {
+namespace bench {
+
+// A benchmark body runs its workload `iterations' times.
+// Returns True if success; otherwise False, with err_msg filled.
+typedef std::function<bool(int64_t iterations, std::string& err_msg)> BenchFunc;
+
+struct BenchCase {
+    std::string name;
+    BenchFunc func;
+};
+
+// All benchmarks registered by PBCONF_BENCH, in registration order.
+std::vector<BenchCase>& Registry();
+
+struct Registrar {
+    Registrar(const std::string& name, BenchFunc func) {
+        Registry().push_back({name, std::move(func)});
+    }
+};
+
+// Report that the running benchmark processed `bytes' over all of its
+// iterations, e.g. the size of the conf file times the iterations,
+// so that its throughput is printed as well.
+void SetBytesProcessed(int64_t bytes);
+
+// Write `content' into the file named `filename', replacing it.
+bool WriteFile(const std::string& filename, const std::string& content);
+
+}
+}
+
+#define PBCONF_BENCH(name) \
+    static bool name(int64_t iterations, std::string& err_msg); \
+    static ::pbconf::bench::Registrar name##_registrar(#name, name); \
+    static bool name(int64_t iterations, std::string& err_msg)
+
+#endif
@@ -0,0 +1,147 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+// Every heap allocation of the process, counted for the allocs/op column.
+static std::atomic<int64_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace pbconf {
+namespace bench {
+
+static int64_t g_bytes_processed = 0;
+
+std::vector<BenchCase>& Registry() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+bool WriteFile(const std::string& filename, const std::string& content) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out << content;
+    return out.good();
+}
+
+void SetBytesProcessed(int64_t bytes) {
+    g_bytes_processed = bytes;
+}
+
+}
+}
+
+// Reset the peak RSS of the process to its current RSS, Linux only.
+static void ResetPeakRss() {
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (fp) {
+        fputs("5", fp);
+        fclose(fp);
+    }
+}
+
+// The peak RSS in KB since the last reset, -1 if unknown.
+static int64_t PeakRssKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return strtoll(line.c_str() + 6, nullptr, 10);
+        }
+    }
+    return -1;
+}
+
+// Usage: pbconf_bench [name-filter]
+// Each benchmark is repeated with growing iterations
+// until one round takes at least kMinRoundTime, or kMaxIterations.
+// Prints the time and heap allocations per iteration, the throughput
+// for benchmarks reporting their bytes, and the peak RSS of the round.
+int main(int argc, char* argv[]) {
+    using Clock = std::chrono::steady_clock;
+    const auto kMinRoundTime = std::chrono::milliseconds(200);
+    const int64_t kMaxIterations = 1000000000;
+    const char* filter = argc > 1 ? argv[1] : "";
+
+    int failed = 0;
+    for (auto& bench_case : pbconf::bench::Registry()) {
+        if (!strstr(bench_case.name.c_str(), filter)) {
+            continue;
+        }
+
+        std::string err_msg;
+        int64_t iterations = 1;
+        Clock::duration elapsed;
+        int64_t allocations = 0;
+        int64_t peak_rss_kb = -1;
+        bool ok = true;
+        while (true) {
+            pbconf::bench::g_bytes_processed = 0;
+            ResetPeakRss();
+            const int64_t allocations_before = g_allocations.load();
+            auto start = Clock::now();
+            ok = bench_case.func(iterations, err_msg);
+            elapsed = Clock::now() - start;
+            allocations = g_allocations.load() - allocations_before;
+            peak_rss_kb = PeakRssKb();
+            if (!ok || elapsed >= kMinRoundTime || iterations >= kMaxIterations) {
+                break;
+            }
+            iterations *= 10;
+        }
+
+        if (!ok) {
+            std::cerr << bench_case.name << " FAILED: " << err_msg << std::endl;
+            ++failed;
+            continue;
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+        std::cout << bench_case.name << "\t" << iterations << " iterations\t"
+            << ns.count() / iterations << " ns/op\t"
+            << allocations / iterations << " allocs/op";
+        if (pbconf::bench::g_bytes_processed > 0 && ns.count() > 0) {
+            std::cout << "\t" << pbconf::bench::g_bytes_processed * 1e3 / ns.count()
+                << " MB/s";
+        }
+        if (peak_rss_kb >= 0) {
+            std::cout << "\t" << peak_rss_kb << " KB peak RSS";
+        }
+        std::cout << std::endl;
+    }
+    return failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,83 @@
+#include <butil/file_util.h>
+#include <butil/files/file_path.h>
+#include <pbconf/overlay.h>
+#include <pbconf/pbconf.h>
+#include <stdio.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Loading endpoints split over the fragments of a conf.d directory,
+// parsed concurrently and appended in order, against the same
+// endpoints in one conf file.
+
+static const int kFragments = 32;
+static const int kEndpoints = 50;
+
+static std::string FragmentConf(int fragment) {
+    std::string content = "endpoints:\n";
+    for (int j = 0; j < kEndpoints; ++j) {
+        content += "  - name: endpoint-" + std::to_string(fragment) + "-" + std::to_string(j) + "\n"
+            "    host: 10.0." + std::to_string(fragment % 256) + ".1\n"
+            "    port: " + std::to_string(8000 + j) + "\n"
+            "    protocol: GRPC\n";
+    }
+    return content;
+}
+
+PBCONF_BENCH(LoadConfDirectory) {
+    const std::string dirname = "conf_d_bench.d";
+    if (!butil::CreateDirectory(butil::FilePath(dirname))) {
+        err_msg = "Fail to create " + dirname;
+        return false;
+    }
+    int64_t bytes = 0;
+    for (int i = 0; i < kFragments; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "/%02d-endpoints.yml", i);
+        const std::string content = FragmentConf(i);
+        if (!pbconf::bench::WriteFile(dirname + name, content)) {
+            err_msg = "Fail to write " + dirname + name;
+            return false;
+        }
+        bytes += content.size();
+    }
+
+    pbconf::ConfOverlay overlay;
+    overlay.AddDirectory(dirname).SetMergeRule("endpoints", pbconf::ConfOverlay::APPEND);
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::Endpoints msg;
+        if (!overlay.Load(msg)) {
+            err_msg = overlay.ErrorMessage();
+            return false;
+        }
+    }
+    pbconf::bench::SetBytesProcessed(bytes * iterations);
+    return true;
+}
+
+PBCONF_BENCH(LoadConfOneFile) {
+    const std::string filename = "conf_d_bench.yml";
+    std::string content = "endpoints:\n";
+    for (int i = 0; i < kFragments; ++i) {
+        const std::string fragment = FragmentConf(i);
+        content += fragment.substr(fragment.find('\n') + 1);
+    }
+    if (!pbconf::bench::WriteFile(filename, content)) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    pbconf::PbConf conf;
+    conf.SetFilename(filename);
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::Endpoints msg;
+        if (!conf.Load(msg)) {
+            err_msg = conf.ErrorMessage();
+            return false;
+        }
+    }
+    pbconf::bench::SetBytesProcessed(content.size() * iterations);
+    return true;
+}
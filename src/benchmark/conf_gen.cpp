@@ -0,0 +1,256 @@
+#include "conf_gen.h"
+
+#include <google/protobuf/descriptor.h>
+#include <pbconf/load_plan.h>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pbconf {
+namespace bench {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using string = std::string;
+
+namespace {
+
+// Required message fields are filled in below `depth' too,
+// up to this many more levels.
+const int kMaxRequiredLevels = 16;
+
+// A document of any format: the conf is generated once as a tree,
+// then written out in each format.
+struct Value {
+    enum Kind {
+        SCALAR,
+        STRING,
+        MAP,
+        LIST
+    };
+
+    Kind kind = MAP;
+    // The literal of a scalar, or the content of a string.
+    string text;
+    std::vector<std::pair<string, Value>> members;
+    std::vector<Value> elements;
+};
+
+class Generator {
+public:
+    Generator(const ConfShape& shape) : _shape(shape), _random(shape.seed) {}
+
+    Value Message(const Descriptor* descriptor, int level) {
+        Value map;
+        std::vector<const FieldDescriptor*> fields;
+        CollectFields(descriptor, fields);
+        for (const FieldDescriptor* field : fields) {
+            if (!Wanted(field, level)) {
+                continue;
+            }
+            if (!field->is_repeated()) {
+                map.members.emplace_back(field->name(), Element(field, level));
+                continue;
+            }
+            Value list;
+            list.kind = Value::LIST;
+            const int length = field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE
+                ? _shape.message_list_length : _shape.list_length;
+            for (int i = 0; i < length; ++i) {
+                list.elements.push_back(Element(field, level));
+            }
+            map.members.emplace_back(field->name(), std::move(list));
+        }
+        return map;
+    }
+
+private:
+    bool Wanted(const FieldDescriptor* field, int level) const {
+        const bool message = field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE;
+        if (field->is_required()) {
+            return !message || level < _shape.depth + kMaxRequiredLevels;
+        }
+        if (field->is_repeated() && !_shape.lists) {
+            return false;
+        }
+        switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_MESSAGE:
+            return _shape.messages && level < _shape.depth;
+        case FieldDescriptor::CPPTYPE_STRING:
+            return _shape.strings;
+        case FieldDescriptor::CPPTYPE_ENUM:
+            return _shape.enums;
+        default:
+            return _shape.numbers;
+        }
+    }
+
+    Value Element(const FieldDescriptor* field, int level) {
+        if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+            return Message(field->message_type(), level + 1);
+        }
+
+        Value value;
+        value.kind = Value::SCALAR;
+        // Values every format represents exactly.
+        switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+            value.text = std::to_string(static_cast<int32_t>(_random() % 100000) - 50000);
+            break;
+        case FieldDescriptor::CPPTYPE_INT64:
+            value.text = std::to_string(
+                    static_cast<int64_t>(_random() % 2000000000) * 1000 - 1000000000000LL);
+            break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+            value.text = std::to_string(_random() % 1000000);
+            break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+            value.text = std::to_string(static_cast<uint64_t>(_random() % 1000000000) * 1000);
+            break;
+        case FieldDescriptor::CPPTYPE_BOOL:
+            value.text = _random() % 2 ? "true" : "false";
+            break;
+        case FieldDescriptor::CPPTYPE_FLOAT:
+            value.text = std::to_string(_random() % 10000) + ".25";
+            break;
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+            value.text = std::to_string(_random() % 1000000) + ".125";
+            break;
+        case FieldDescriptor::CPPTYPE_ENUM: {
+            const auto* type = field->enum_type();
+            value.kind = Value::STRING;
+            value.text = type->value(_random() % type->value_count())->name();
+            break;
+        }
+        default:
+            value.kind = Value::STRING;
+            value.text.reserve(_shape.string_length);
+            for (int i = 0; i < _shape.string_length; ++i) {
+                value.text.push_back("abcdefghijklmnopqrstuvwxyz-0123456789"
+                        [_random() % (i == 0 ? 26 : 37)]);
+            }
+            break;
+        }
+        return value;
+    }
+
+    const ConfShape& _shape;
+    std::mt19937 _random;
+};
+
+// Begin yaml
+void WriteYamlMap(const Value& map, int indent, string& out);
+
+void WriteYamlFlow(const Value& value, string& out) {
+    if (value.kind == Value::STRING) {
+        out += "\"" + value.text + "\"";
+    } else {
+        out += value.text;
+    }
+}
+
+void WriteYamlMember(const string& key, const Value& value, int indent, string& out) {
+    const string spaces(indent, ' ');
+    out += spaces + key + ":";
+    if (value.kind == Value::MAP) {
+        if (value.members.empty()) {
+            out += " {}\n";
+            return;
+        }
+        out += "\n";
+        WriteYamlMap(value, indent + 2, out);
+        return;
+    }
+    if (value.kind != Value::LIST) {
+        out += " ";
+        WriteYamlFlow(value, out);
+        out += "\n";
+        return;
+    }
+
+    if (value.elements.empty() || value.elements[0].kind != Value::MAP) {
+        // Lists of scalars in flow style, as they are usually written.
+        out += " [";
+        for (size_t i = 0; i < value.elements.size(); ++i) {
+            out += i == 0 ? "" : ", ";
+            WriteYamlFlow(value.elements[i], out);
+        }
+        out += "]\n";
+        return;
+    }
+    out += "\n";
+    for (const Value& element : value.elements) {
+        if (element.members.empty()) {
+            out += spaces + "  - {}\n";
+            continue;
+        }
+        // The first key goes on the line of the dash.
+        const size_t begin = out.size();
+        WriteYamlMap(element, indent + 4, out);
+        out.replace(begin, indent + 4, spaces + "  - ");
+    }
+}
+
+void WriteYamlMap(const Value& map, int indent, string& out) {
+    for (const auto& member : map.members) {
+        WriteYamlMember(member.first, member.second, indent, out);
+    }
+}
+// End yaml
+
+// Begin json and hocon
+// Both are written the same way, but for the separators.
+void WriteBraced(const Value& value, bool hocon, string& out) {
+    switch (value.kind) {
+    case Value::STRING:
+        out += "\"" + value.text + "\"";
+        break;
+    case Value::SCALAR:
+        out += value.text;
+        break;
+    case Value::LIST:
+        out += "[";
+        for (size_t i = 0; i < value.elements.size(); ++i) {
+            out += i == 0 ? "" : ", ";
+            WriteBraced(value.elements[i], hocon, out);
+        }
+        out += "]";
+        break;
+    case Value::MAP:
+        out += "{";
+        for (size_t i = 0; i < value.members.size(); ++i) {
+            out += i == 0 ? "" : ", ";
+            const auto& member = value.members[i];
+            out += hocon ? member.first + " = " : "\"" + member.first + "\": ";
+            WriteBraced(member.second, hocon, out);
+        }
+        out += "}";
+        break;
+    }
+}
+// End json and hocon
+
+}
+
+string GenerateConf(const Descriptor* descriptor, const ConfShape& shape, ConfFormat format) {
+    const Value root = Generator(shape).Message(descriptor, 0);
+    string out;
+    switch (format) {
+    case YAML:
+        WriteYamlMap(root, 0, out);
+        break;
+    case JSON:
+        WriteBraced(root, false, out);
+        out += "\n";
+        break;
+    case HOCON:
+        WriteBraced(root, true, out);
+        out += "\n";
+        break;
+    }
+    return out;
+}
+
+}
+}
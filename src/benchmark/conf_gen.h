@@ -0,0 +1,48 @@
+#ifndef CONF_GEN_H
+#define CONF_GEN_H
+
+#include <google/protobuf/descriptor.h>
+#include <stdint.h>
+#include <string>
+
+namespace pbconf {
+namespace bench {
+
+// What a generated conf looks like.
+struct ConfShape {
+    // Elements of each repeated number, string and enum field.
+    int list_length = 4;
+    // Elements of each repeated message field.
+    int message_list_length = 2;
+    // Levels of sub-messages below the root message.
+    int depth = 2;
+    int string_length = 16;
+
+    // The kinds of fields filled in, besides required fields.
+    bool numbers = true;
+    bool strings = true;
+    bool enums = true;
+    bool lists = true;
+    bool messages = true;
+
+    uint32_t seed = 1;
+};
+
+enum ConfFormat {
+    YAML,
+    JSON,
+    HOCON
+};
+
+// Generate a conf of the message type `descriptor' in `format'.
+// The same shape and seed give the same conf in every format.
+// Extensions are filled in as well, under their plain names.
+std::string GenerateConf(
+        const ::google::protobuf::Descriptor* descriptor,
+        const ConfShape& shape,
+        ConfFormat format);
+
+}
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include <pbconf/snapshot.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Reading a conf from many threads while it is published again every
+// millisecond: through Snapshot, and through a shared_ptr behind a mutex.
+// Each iteration is one read on every reader thread.
+
+static const int kReaders = 8;
+
+static std::shared_ptr<const bench::Endpoints> MakeConf(int port) {
+    std::shared_ptr<bench::Endpoints> conf(new bench::Endpoints());
+    bench::Endpoint* endpoint = conf->add_endpoints();
+    endpoint->set_name("endpoint");
+    endpoint->set_host("127.0.0.1");
+    endpoint->set_port(port);
+    return conf;
+}
+
+// Run `read' `iterations' times on each reader thread,
+// while `publish' runs every millisecond.
+template <typename Read, typename Publish>
+static bool Contend(int64_t iterations, Read read, Publish publish, std::string& err_msg) {
+    std::atomic<bool> stop(false);
+    std::thread writer([&] {
+        for (int port = 1; !stop.load(std::memory_order_relaxed); ++port) {
+            publish(MakeConf(port));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    std::atomic<int> failures(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; ++i) {
+        readers.emplace_back([&] {
+            for (int64_t n = 0; n < iterations; ++n) {
+                if (read() <= 0) {
+                    failures.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    stop = true;
+    writer.join();
+
+    if (failures.load() != 0) {
+        err_msg = "Fail to read conf";
+        return false;
+    }
+    return true;
+}
+
+PBCONF_BENCH(SnapshotContendedRead) {
+    pbconf::Snapshot<bench::Endpoints> snapshot;
+    snapshot.Publish(MakeConf(1));
+    return Contend(iterations,
+            [&] {
+                pbconf::Snapshot<bench::Endpoints>::ReadPtr conf;
+                if (!snapshot.Read(&conf) || conf.get() == nullptr) {
+                    return 0;
+                }
+                return conf->endpoints(0).port();
+            },
+            [&](std::shared_ptr<const bench::Endpoints> conf) {
+                snapshot.Publish(std::move(conf));
+            },
+            err_msg);
+}
+
+PBCONF_BENCH(MutexSharedPtrContendedRead) {
+    std::mutex mutex;
+    std::shared_ptr<const bench::Endpoints> current = MakeConf(1);
+    return Contend(iterations,
+            [&] {
+                std::shared_ptr<const bench::Endpoints> conf;
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    conf = current;
+                }
+                return conf->endpoints(0).port();
+            },
+            [&](std::shared_ptr<const bench::Endpoints> conf) {
+                std::lock_guard<std::mutex> guard(mutex);
+                current.swap(conf);
+            },
+            err_msg);
+}
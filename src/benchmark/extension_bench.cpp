@@ -0,0 +1,44 @@
+#include <pbconf/load_plan.h>
+#include <pbconf/yaml_conf.h>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Regression: collecting the fields of a message declaring
+// `extensions 1000 to max' must not walk the whole range.
+PBCONF_BENCH(CollectFieldsOfMaxExtensionRange) {
+    const auto* descriptor = bench::OpenExtendable::descriptor();
+    std::vector<const ::google::protobuf::FieldDescriptor*> fields;
+    for (int64_t i = 0; i < iterations; ++i) {
+        fields.clear();
+        pbconf::CollectFields(descriptor, fields);
+    }
+    if (fields.size() != 3) {
+        err_msg = "Expect 1 field and 2 extensions";
+        return false;
+    }
+    return true;
+}
+
+PBCONF_BENCH(YamlLoadMaxExtensionRange) {
+    const std::string filename = "extension_bench.yml";
+    if (!pbconf::bench::WriteFile(filename,
+                "id: 1\nlabel: \"open\"\nweight: 7\n")) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::OpenExtendable msg;
+        if (!pbconf::YamlConf().Load(filename, msg, err_msg)) {
+            return false;
+        }
+        if (msg.GetExtension(bench::weight) != 7) {
+            err_msg = "Extension weight is not loaded";
+            return false;
+        }
+    }
+    return true;
+}
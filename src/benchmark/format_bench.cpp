@@ -0,0 +1,175 @@
+#include <google/protobuf/message.h>
+#include <map>
+#include <pbconf/hocon_conf.h>
+#include <pbconf/json_conf.h>
+#include <pbconf/yaml_conf.h>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "bench.pb.h"
+#include "conf_gen.h"
+
+// Every loader path on configs generated from bench::Mixed,
+// the same config in each format, at several sizes and shapes.
+
+namespace {
+
+using pbconf::bench::ConfFormat;
+using pbconf::bench::ConfShape;
+
+struct Shape {
+    const char* name;
+    ConfShape shape;
+};
+
+std::vector<Shape> Shapes() {
+    std::vector<Shape> shapes;
+
+    // A single message of scalars.
+    Shape flat{"Flat", ConfShape()};
+    flat.shape.depth = 0;
+    flat.shape.lists = false;
+    shapes.push_back(flat);
+
+    // Long lists of numbers, strings and enums.
+    Shape lists{"Lists", ConfShape()};
+    lists.shape.depth = 0;
+    lists.shape.list_length = 2000;
+    shapes.push_back(lists);
+
+    // Many small messages in one list.
+    Shape wide{"Wide", ConfShape()};
+    wide.shape.depth = 1;
+    wide.shape.message_list_length = 5000;
+    wide.shape.list_length = 2;
+    shapes.push_back(wide);
+
+    // Messages nested 6 levels deep.
+    Shape deep{"Deep", ConfShape()};
+    deep.shape.depth = 6;
+    deep.shape.message_list_length = 2;
+    shapes.push_back(deep);
+
+    // Mostly strings, or mostly numbers.
+    Shape strings{"Strings", ConfShape()};
+    strings.shape.depth = 1;
+    strings.shape.message_list_length = 500;
+    strings.shape.list_length = 8;
+    strings.shape.string_length = 64;
+    strings.shape.numbers = false;
+    strings.shape.enums = false;
+    shapes.push_back(strings);
+
+    Shape numbers{"Numbers", ConfShape()};
+    numbers.shape.depth = 1;
+    numbers.shape.message_list_length = 500;
+    numbers.shape.list_length = 16;
+    numbers.shape.strings = false;
+    numbers.shape.enums = false;
+    shapes.push_back(numbers);
+
+    return shapes;
+}
+
+// One way of loading a conf file.
+struct Path {
+    const char* name;
+    ConfFormat format;
+    bool (*load)(const std::string& filename, google::protobuf::Message& msg,
+            std::string& err_msg);
+};
+
+const std::vector<Path>& Paths() {
+    static const std::vector<Path> paths = {
+        {"YamlTree", pbconf::bench::YAML,
+            [](const std::string& filename, google::protobuf::Message& msg, std::string& err_msg) {
+                return pbconf::YamlConf().SetUseGenerated(false).Load(filename, msg, err_msg);
+            }},
+        {"YamlGenerated", pbconf::bench::YAML,
+            [](const std::string& filename, google::protobuf::Message& msg, std::string& err_msg) {
+                return pbconf::YamlConf().Load(filename, msg, err_msg);
+            }},
+        {"YamlStreaming", pbconf::bench::YAML,
+            [](const std::string& filename, google::protobuf::Message& msg, std::string& err_msg) {
+                return pbconf::YamlConf().SetStreaming(true).Load(filename, msg, err_msg);
+            }},
+        {"YamlParallel", pbconf::bench::YAML,
+            [](const std::string& filename, google::protobuf::Message& msg, std::string& err_msg) {
+                return pbconf::YamlConf().SetParallel(true).Load(filename, msg, err_msg);
+            }},
+        {"Json", pbconf::bench::JSON,
+            [](const std::string& filename, google::protobuf::Message& msg, std::string& err_msg) {
+                return pbconf::JsonConf().SetUseGenerated(false).Load(filename, msg, err_msg);
+            }},
+        {"JsonGenerated", pbconf::bench::JSON,
+            [](const std::string& filename, google::protobuf::Message& msg, std::string& err_msg) {
+                return pbconf::JsonConf().Load(filename, msg, err_msg);
+            }},
+        {"Hocon", pbconf::bench::HOCON,
+            [](const std::string& filename, google::protobuf::Message& msg, std::string& err_msg) {
+                return pbconf::HoconConf().Load(filename, msg, err_msg);
+            }},
+    };
+    return paths;
+}
+
+const char* Extension(ConfFormat format) {
+    switch (format) {
+    case pbconf::bench::YAML:
+        return ".yml";
+    case pbconf::bench::JSON:
+        return ".json";
+    default:
+        return ".conf";
+    }
+}
+
+// Write the conf of `shape' in `format' on first use.
+// Returns its size, or -1 if it could not be written.
+int64_t PrepareConf(const std::string& filename, const ConfShape& shape, ConfFormat format) {
+    static std::map<std::string, int64_t>* sizes = new std::map<std::string, int64_t>();
+    auto found = sizes->find(filename);
+    if (found != sizes->end()) {
+        return found->second;
+    }
+    const std::string content = pbconf::bench::GenerateConf(
+            bench::Mixed::descriptor(), shape, format);
+    if (!pbconf::bench::WriteFile(filename, content)) {
+        return -1;
+    }
+    (*sizes)[filename] = content.size();
+    return content.size();
+}
+
+bool RegisterAll() {
+    for (const Shape& shape : Shapes()) {
+        for (const Path& path : Paths()) {
+            const std::string filename = std::string("format_bench_") + shape.name
+                + Extension(path.format);
+            const ConfShape conf_shape = shape.shape;
+            const Path load_path = path;
+            pbconf::bench::Registrar(std::string("Load") + shape.name + path.name,
+                    [=](int64_t iterations, std::string& err_msg) {
+                        const int64_t size = PrepareConf(filename, conf_shape, load_path.format);
+                        if (size < 0) {
+                            err_msg = "Fail to write " + filename;
+                            return false;
+                        }
+                        for (int64_t i = 0; i < iterations; ++i) {
+                            bench::Mixed msg;
+                            if (!load_path.load(filename, msg, err_msg)) {
+                                return false;
+                            }
+                        }
+                        pbconf::bench::SetBytesProcessed(size * iterations);
+                        return true;
+                    });
+        }
+    }
+    return true;
+}
+
+const bool registered = RegisterAll();
+
+}
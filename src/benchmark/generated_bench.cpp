@@ -0,0 +1,78 @@
+#include <pbconf/json_conf.h>
+#include <pbconf/yaml_conf.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Loading a large config of small messages through Reflection
+// and through the loaders generated by protoc-gen-pbconf,
+// which bench.pbconf.cc registers for the bench protos.
+
+static const int kEndpoints = 20000;
+
+static std::string EndpointJson(int i) {
+    const std::string id = std::to_string(i);
+    return "{\"name\": \"endpoint-" + id + "\", "
+        "\"host\": \"10.0." + std::to_string(i % 256) + ".1\", "
+        "\"port\": " + std::to_string(8000 + i % 1000) + ", "
+        "\"protocol\": \"GRPC\", "
+        "\"timeout_ms\": 1500, "
+        "\"weight\": 0.75, "
+        "\"enabled\": true, "
+        "\"tags\": [\"zone-" + std::to_string(i % 8) + "\", \"canary\"]}";
+}
+
+// The flow style of yaml is a superset of json.
+static std::string EndpointsConf() {
+    std::string content = "{\"endpoints\": [";
+    for (int i = 0; i < kEndpoints; ++i) {
+        content += (i ? ",\n" : "") + EndpointJson(i);
+    }
+    content += "]}\n";
+    return content;
+}
+
+template <typename Conf>
+static bool LoadEndpoints(
+        const std::string& filename,
+        bool use_generated,
+        int64_t iterations,
+        std::string& err_msg) {
+    if (!pbconf::bench::WriteFile(filename, EndpointsConf())) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::Endpoints msg;
+        if (!Conf().SetUseGenerated(use_generated).Load(filename, msg, err_msg)) {
+            return false;
+        }
+        if (msg.endpoints_size() != kEndpoints) {
+            err_msg = "Wrong endpoint count";
+            return false;
+        }
+    }
+    return true;
+}
+
+PBCONF_BENCH(YamlLoadEndpointsByReflection) {
+    return LoadEndpoints<pbconf::YamlConf>(
+            "generated_bench.yml", false, iterations, err_msg);
+}
+
+PBCONF_BENCH(YamlLoadEndpointsByGenerated) {
+    return LoadEndpoints<pbconf::YamlConf>(
+            "generated_bench.yml", true, iterations, err_msg);
+}
+
+PBCONF_BENCH(JsonLoadEndpointsByReflection) {
+    return LoadEndpoints<pbconf::JsonConf>(
+            "generated_bench.json", false, iterations, err_msg);
+}
+
+PBCONF_BENCH(JsonLoadEndpointsByGenerated) {
+    return LoadEndpoints<pbconf::JsonConf>(
+            "generated_bench.json", true, iterations, err_msg);
+}
@@ -0,0 +1,72 @@
+#include <pbconf/lazy_fields.h>
+#include <pbconf/pbconf.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+#include "conf_gen.h"
+
+// Loading a config whose large `child' section is not read,
+// converting all of it, or leaving the section to LazyFields.
+
+// A conf of bench::Mixed, most of which is its `child' section.
+static std::string SectionConf(pbconf::bench::ConfFormat format) {
+    pbconf::bench::ConfShape shape;
+    shape.depth = 4;
+    shape.message_list_length = 6;
+    const std::string section = pbconf::bench::GenerateConf(
+            bench::Mixed::descriptor(), shape, format);
+    if (format == pbconf::bench::JSON) {
+        return "{\"i32\": 1, \"s\": \"small\", \"child\": " + section + "}\n";
+    }
+
+    std::string content = "i32: 1\ns: small\nchild:\n";
+    size_t begin = 0;
+    while (begin < section.size()) {
+        const size_t end = section.find('\n', begin) + 1;
+        content += "  " + section.substr(begin, end - begin);
+        begin = end;
+    }
+    return content;
+}
+
+static bool LoadSection(pbconf::bench::ConfFormat format, bool lazy, int64_t iterations,
+        std::string& err_msg) {
+    const std::string filename = format == pbconf::bench::JSON
+        ? "lazy_bench.json" : "lazy_bench.yml";
+    const std::string content = SectionConf(format);
+    if (!pbconf::bench::WriteFile(filename, content)) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::Mixed msg;
+        pbconf::LazyFields fields;
+        fields.AddField("child");
+        pbconf::PbConf conf;
+        conf.SetFilename(filename).SetLazyFields(lazy ? &fields : nullptr);
+        if (!conf.Load(msg)) {
+            err_msg = conf.ErrorMessage();
+            return false;
+        }
+    }
+    pbconf::bench::SetBytesProcessed(content.size() * iterations);
+    return true;
+}
+
+PBCONF_BENCH(LoadYamlSectionEager) {
+    return LoadSection(pbconf::bench::YAML, false, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadYamlSectionLazy) {
+    return LoadSection(pbconf::bench::YAML, true, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadJsonSectionEager) {
+    return LoadSection(pbconf::bench::JSON, false, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadJsonSectionLazy) {
+    return LoadSection(pbconf::bench::JSON, true, iterations, err_msg);
+}
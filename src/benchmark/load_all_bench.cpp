@@ -0,0 +1,76 @@
+#include <memory>
+#include <pbconf/pbconf.h>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Loading many small conf files at startup,
+// one PbConf::Load after another and all at once through LoadAll.
+
+static const int kFiles = 300;
+static const int kEndpoints = 20;
+
+static bool WriteFiles(std::vector<std::string>& filenames, std::string& err_msg) {
+    for (int i = 0; i < kFiles; ++i) {
+        std::string content = "endpoints:\n";
+        for (int j = 0; j < kEndpoints; ++j) {
+            content += "  - name: endpoint-" + std::to_string(j) + "\n"
+                "    host: 10.0." + std::to_string(i % 256) + ".1\n"
+                "    port: " + std::to_string(8000 + j) + "\n"
+                "    protocol: GRPC\n";
+        }
+        const std::string filename = "load_all_bench_" + std::to_string(i) + ".yml";
+        if (!pbconf::bench::WriteFile(filename, content)) {
+            err_msg = "Fail to write " + filename;
+            return false;
+        }
+        filenames.push_back(filename);
+    }
+    return true;
+}
+
+PBCONF_BENCH(PbConfLoadFilesOneByOne) {
+    std::vector<std::string> filenames;
+    if (!WriteFiles(filenames, err_msg)) {
+        return false;
+    }
+    for (int64_t i = 0; i < iterations; ++i) {
+        for (const std::string& filename : filenames) {
+            bench::Endpoints msg;
+            pbconf::PbConf conf;
+            if (!conf.SetFilename(filename).Load(msg)) {
+                err_msg = conf.ErrorMessage();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+PBCONF_BENCH(PbConfLoadAllFiles) {
+    std::vector<std::string> filenames;
+    if (!WriteFiles(filenames, err_msg)) {
+        return false;
+    }
+    for (int64_t i = 0; i < iterations; ++i) {
+        std::vector<std::unique_ptr<bench::Endpoints>> msgs;
+        std::vector<pbconf::LoadTask> tasks(filenames.size());
+        for (size_t j = 0; j < filenames.size(); ++j) {
+            msgs.emplace_back(new bench::Endpoints());
+            tasks[j].filename = filenames[j];
+            tasks[j].msg = msgs.back().get();
+        }
+        if (!pbconf::PbConf().LoadAll(tasks)) {
+            for (const pbconf::LoadTask& task : tasks) {
+                if (!task.ok) {
+                    err_msg = task.filename + ":" + task.error_msg;
+                    break;
+                }
+            }
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+#include <pbconf/json_conf.h>
+#include <pbconf/yaml_conf.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Loading a lookup table of 100k keys into a map field, written as a
+// map through Reflection and through the generated loaders, and
+// written as the list of its entries, as it had to be before.
+
+static const int kKeys = 100000;
+
+// The flow style of yaml is a superset of json.
+static std::string LookupConf(bool entry_list) {
+    std::string content = entry_list ? "{\"weights\": [" : "{\"weights\": {";
+    for (int i = 0; i < kKeys; ++i) {
+        const std::string key = "\"route-" + std::to_string(i) + "\"";
+        const std::string value = std::to_string(i % 1000);
+        content += i ? ",\n" : "";
+        content += entry_list
+            ? "{\"key\": " + key + ", \"value\": " + value + "}"
+            : key + ": " + value;
+    }
+    content += entry_list ? "]}\n" : "}}\n";
+    return content;
+}
+
+template <typename Conf>
+static bool LoadLookup(
+        const std::string& filename,
+        bool entry_list,
+        bool use_generated,
+        int64_t iterations,
+        std::string& err_msg) {
+    const std::string content = LookupConf(entry_list);
+    if (!pbconf::bench::WriteFile(filename, content)) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::LookupTable msg;
+        if (!Conf().SetUseGenerated(use_generated).Load(filename, msg, err_msg)) {
+            return false;
+        }
+        // Entries added through Reflection become the map on first access.
+        if (msg.weights().size() != kKeys) {
+            err_msg = "Wrong key count";
+            return false;
+        }
+    }
+    pbconf::bench::SetBytesProcessed(content.size() * iterations);
+    return true;
+}
+
+PBCONF_BENCH(YamlLoadMapByReflection) {
+    return LoadLookup<pbconf::YamlConf>("map_bench.yml", false, false, iterations, err_msg);
+}
+
+PBCONF_BENCH(YamlLoadMapByGenerated) {
+    return LoadLookup<pbconf::YamlConf>("map_bench.yml", false, true, iterations, err_msg);
+}
+
+PBCONF_BENCH(YamlLoadEntryList) {
+    return LoadLookup<pbconf::YamlConf>("map_bench.yml", true, false, iterations, err_msg);
+}
+
+PBCONF_BENCH(JsonLoadMapByReflection) {
+    return LoadLookup<pbconf::JsonConf>("map_bench.json", false, false, iterations, err_msg);
+}
+
+PBCONF_BENCH(JsonLoadMapByGenerated) {
+    return LoadLookup<pbconf::JsonConf>("map_bench.json", false, true, iterations, err_msg);
+}
+
+PBCONF_BENCH(JsonLoadEntryList) {
+    return LoadLookup<pbconf::JsonConf>("map_bench.json", true, false, iterations, err_msg);
+}
@@ -0,0 +1,109 @@
+#include <google/protobuf/field_mask.pb.h>
+#include <pbconf/pbconf.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+#include "conf_gen.h"
+
+// Loading one `child' section out of the ten sections of a config,
+// the whole config, the section through a FieldMask, and a config
+// holding that section alone, which is what the mask should cost.
+
+static pbconf::bench::ConfShape SectionShape(int depth) {
+    pbconf::bench::ConfShape shape;
+    shape.depth = depth;
+    // `child' and 9 `children' per message.
+    shape.message_list_length = 9;
+    return shape;
+}
+
+// The conf of all sections, or of the `child' section alone.
+static std::string MaskConf(pbconf::bench::ConfFormat format, bool alone) {
+    if (!alone) {
+        return pbconf::bench::GenerateConf(
+                bench::Mixed::descriptor(), SectionShape(2), format);
+    }
+
+    const std::string section = pbconf::bench::GenerateConf(
+            bench::Mixed::descriptor(), SectionShape(1), format);
+    if (format == pbconf::bench::JSON) {
+        return "{\"child\": " + section + "}\n";
+    }
+    std::string content = "child:\n";
+    size_t begin = 0;
+    while (begin < section.size()) {
+        const size_t end = section.find('\n', begin) + 1;
+        content += "  " + section.substr(begin, end - begin);
+        begin = end;
+    }
+    return content;
+}
+
+enum MaskMode {
+    WHOLE,
+    MASKED,
+    ALONE
+};
+
+static bool LoadMasked(pbconf::bench::ConfFormat format, bool streaming, MaskMode mode,
+        int64_t iterations, std::string& err_msg) {
+    const std::string filename = format == pbconf::bench::JSON
+        ? "mask_bench.json" : "mask_bench.yml";
+    const std::string content = MaskConf(format, mode == ALONE);
+    if (!pbconf::bench::WriteFile(filename, content)) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    google::protobuf::FieldMask mask;
+    mask.add_paths("child");
+    pbconf::PbConf conf;
+    conf.SetFilename(filename).SetStreaming(streaming);
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::Mixed msg;
+        bool ok = mode == MASKED ? conf.Load(msg, mask) : conf.Load(msg);
+        if (!ok) {
+            err_msg = conf.ErrorMessage();
+            return false;
+        }
+    }
+    pbconf::bench::SetBytesProcessed(content.size() * iterations);
+    return true;
+}
+
+PBCONF_BENCH(LoadYamlWhole) {
+    return LoadMasked(pbconf::bench::YAML, false, WHOLE, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadYamlMasked) {
+    return LoadMasked(pbconf::bench::YAML, false, MASKED, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadYamlAlone) {
+    return LoadMasked(pbconf::bench::YAML, false, ALONE, iterations, err_msg);
+}
+
+PBCONF_BENCH(StreamYamlWhole) {
+    return LoadMasked(pbconf::bench::YAML, true, WHOLE, iterations, err_msg);
+}
+
+PBCONF_BENCH(StreamYamlMasked) {
+    return LoadMasked(pbconf::bench::YAML, true, MASKED, iterations, err_msg);
+}
+
+PBCONF_BENCH(StreamYamlAlone) {
+    return LoadMasked(pbconf::bench::YAML, true, ALONE, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadJsonWhole) {
+    return LoadMasked(pbconf::bench::JSON, false, WHOLE, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadJsonMasked) {
+    return LoadMasked(pbconf::bench::JSON, false, MASKED, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadJsonAlone) {
+    return LoadMasked(pbconf::bench::JSON, false, ALONE, iterations, err_msg);
+}
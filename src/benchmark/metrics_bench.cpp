@@ -0,0 +1,41 @@
+#include <pbconf/load_metrics.h>
+#include <pbconf/pbconf.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+#include "conf_gen.h"
+
+// Loading a small yaml config without metrics, and with the phases,
+// sizes and results recorded into bvars.
+
+static bool LoadMixed(pbconf::LoadMetrics* metrics, int64_t iterations, std::string& err_msg) {
+    const std::string filename = "metrics_bench.yml";
+    pbconf::bench::ConfShape shape;
+    shape.depth = 1;
+    if (!pbconf::bench::WriteFile(filename, pbconf::bench::GenerateConf(
+                    bench::Mixed::descriptor(), shape, pbconf::bench::YAML))) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    pbconf::PbConf conf;
+    conf.SetFilename(filename).SetMetrics(metrics);
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::Mixed msg;
+        if (!conf.Load(msg)) {
+            err_msg = conf.ErrorMessage();
+            return false;
+        }
+    }
+    return true;
+}
+
+PBCONF_BENCH(LoadWithoutMetrics) {
+    return LoadMixed(nullptr, iterations, err_msg);
+}
+
+PBCONF_BENCH(LoadWithMetrics) {
+    static pbconf::LoadMetrics* metrics = new pbconf::LoadMetrics("pbconf_bench");
+    return LoadMixed(metrics, iterations, err_msg);
+}
@@ -0,0 +1,116 @@
+#include <boost/lexical_cast.hpp>
+#include <pbconf/hocon_conf.h>
+#include <pbconf/number_conv.h>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Per-element cost of the numeric conversions of the hocon loader:
+// the former allocate-and-lexical_cast path against number_conv.h.
+
+static const std::vector<std::string>& DoubleLiterals() {
+    static std::vector<std::string> literals = {
+        "3.1415926", "2.718281828", "-0.5", "1e-3", "6.02214076e23", "100"
+    };
+    return literals;
+}
+
+static const std::vector<std::string>& IntegerLiterals() {
+    static std::vector<std::string> literals = {
+        "64", "-1", "9223372036854775807", "123456789", "0", "42"
+    };
+    return literals;
+}
+
+PBCONF_BENCH(DoubleByLexicalCast) {
+    const auto& literals = DoubleLiterals();
+    double sum = 0;
+    for (int64_t i = 0; i < iterations; ++i) {
+        // The hocon loader used to format each number into a new string.
+        std::string literal = literals[i % literals.size()];
+        try {
+            sum += boost::lexical_cast<double>(literal);
+        } catch (boost::bad_lexical_cast& e) {
+            err_msg = e.what();
+            return false;
+        }
+    }
+    return sum != 0;
+}
+
+PBCONF_BENCH(DoubleByParseNumber) {
+    const auto& literals = DoubleLiterals();
+    double sum = 0;
+    for (int64_t i = 0; i < iterations; ++i) {
+        const std::string& literal = literals[i % literals.size()];
+        double value = 0;
+        if (!pbconf::ParseNumber(literal.data(), literal.size(), value)) {
+            err_msg = "Fail to parse " + literal;
+            return false;
+        }
+        sum += value;
+    }
+    return sum != 0;
+}
+
+PBCONF_BENCH(Int64ByLexicalCast) {
+    const auto& literals = IntegerLiterals();
+    int64_t sum = 0;
+    for (int64_t i = 0; i < iterations; ++i) {
+        std::string literal = literals[i % literals.size()];
+        try {
+            sum += boost::lexical_cast<int64_t>(literal);
+        } catch (boost::bad_lexical_cast& e) {
+            err_msg = e.what();
+            return false;
+        }
+    }
+    return sum != 0;
+}
+
+PBCONF_BENCH(Int64ByParseNumber) {
+    const auto& literals = IntegerLiterals();
+    int64_t sum = 0;
+    for (int64_t i = 0; i < iterations; ++i) {
+        const std::string& literal = literals[i % literals.size()];
+        int64_t value = 0;
+        if (!pbconf::ParseNumber(literal.data(), literal.size(), value)) {
+            err_msg = "Fail to parse " + literal;
+            return false;
+        }
+        sum += value;
+    }
+    return sum != 0;
+}
+
+PBCONF_BENCH(HoconLoadNumericArrays) {
+    const std::string filename = "number_bench.conf";
+    const int kElements = 100000;
+    std::string content = "ds: [";
+    for (int i = 0; i < kElements; ++i) {
+        content += (i ? ", " : "") + std::to_string(i) + ".25";
+    }
+    content += "]\ni64s: [";
+    for (int i = 0; i < kElements; ++i) {
+        content += (i ? ", " : "") + std::to_string(i * 1000003LL);
+    }
+    content += "]\n";
+    if (!pbconf::bench::WriteFile(filename, content)) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::NumericArrays msg;
+        if (!pbconf::HoconConf().Load(filename, msg, err_msg)) {
+            return false;
+        }
+        if (msg.ds_size() != kElements || msg.i64s_size() != kElements) {
+            err_msg = "Wrong element count";
+            return false;
+        }
+    }
+    return true;
+}
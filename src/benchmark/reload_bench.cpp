@@ -0,0 +1,57 @@
+#include <pbconf/incremental_state.h>
+#include <pbconf/yaml_conf.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Reloading a yaml config after one value changed,
+// as a whole and incrementally through IncrementalState.
+
+static const int kEndpoints = 1000;
+
+static std::string EndpointsYaml(int changed_port) {
+    std::string content = "endpoints:\n";
+    for (int i = 0; i < kEndpoints; ++i) {
+        int port = i == kEndpoints / 2 ? changed_port : 8000 + i % 1000;
+        content += "  - name: endpoint-" + std::to_string(i) + "\n"
+            "    host: 10.0." + std::to_string(i % 256) + ".1\n"
+            "    port: " + std::to_string(port) + "\n"
+            "    protocol: GRPC\n"
+            "    tags: [zone-" + std::to_string(i % 8) + ", canary]\n";
+    }
+    return content;
+}
+
+static bool ReloadEndpoints(bool incremental, int64_t iterations, std::string& err_msg) {
+    const std::string filename = "reload_bench.yml";
+    const std::string contents[2] = {EndpointsYaml(1), EndpointsYaml(2)};
+
+    bench::Endpoints prototype;
+    pbconf::IncrementalState state(prototype);
+    for (int64_t i = 0; i < iterations; ++i) {
+        if (!pbconf::bench::WriteFile(filename, contents[i % 2])) {
+            err_msg = "Fail to write " + filename;
+            return false;
+        }
+        if (incremental) {
+            if (!pbconf::YamlConf().Load(filename, state, err_msg)) {
+                return false;
+            }
+            continue;
+        }
+        bench::Endpoints msg;
+        if (!pbconf::YamlConf().SetUseGenerated(false).Load(filename, msg, err_msg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+PBCONF_BENCH(YamlReloadEndpoints) {
+    return ReloadEndpoints(false, iterations, err_msg);
+}
+
+PBCONF_BENCH(YamlReloadEndpointsIncremental) {
+    return ReloadEndpoints(true, iterations, err_msg);
+}
@@ -0,0 +1,74 @@
+#include <pbconf/hocon_conf.h>
+#include <pbconf/json_conf.h>
+#include <pbconf/yaml_conf.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Loading one repeated double field of 1M elements in each format,
+// which the loaders reserve once and fill through RepeatedField<double>.
+
+static const int kElements = 1000000;
+
+// `ds: [0.25, 1.25, ...]', valid yaml and hocon alike.
+static std::string DoubleList() {
+    std::string content = "[";
+    for (int i = 0; i < kElements; ++i) {
+        content += (i ? ", " : "") + std::to_string(i) + ".25";
+    }
+    content += "]";
+    return content;
+}
+
+static bool LoadRepeatedDouble(
+        const std::string& filename,
+        const std::string& content,
+        bool (*load)(const std::string&, bench::NumericArrays&, std::string&),
+        int64_t iterations,
+        std::string& err_msg) {
+    if (!pbconf::bench::WriteFile(filename, content)) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::NumericArrays msg;
+        if (!load(filename, msg, err_msg)) {
+            return false;
+        }
+        if (msg.ds_size() != kElements) {
+            err_msg = "Wrong element count";
+            return false;
+        }
+    }
+    return true;
+}
+
+PBCONF_BENCH(YamlLoadRepeatedDouble) {
+    return LoadRepeatedDouble("repeated_bench.yml", "ds: " + DoubleList() + "\n",
+            [](const std::string& filename, bench::NumericArrays& msg,
+                    std::string& err_msg) {
+                return pbconf::YamlConf().Load(filename, msg, err_msg);
+            },
+            iterations, err_msg);
+}
+
+PBCONF_BENCH(JsonLoadRepeatedDouble) {
+    return LoadRepeatedDouble("repeated_bench.json",
+            "{\"ds\": " + DoubleList() + "}\n",
+            [](const std::string& filename, bench::NumericArrays& msg,
+                    std::string& err_msg) {
+                return pbconf::JsonConf().Load(filename, msg, err_msg);
+            },
+            iterations, err_msg);
+}
+
+PBCONF_BENCH(HoconLoadRepeatedDouble) {
+    return LoadRepeatedDouble("repeated_bench.conf", "ds: " + DoubleList() + "\n",
+            [](const std::string& filename, bench::NumericArrays& msg,
+                    std::string& err_msg) {
+                return pbconf::HoconConf().Load(filename, msg, err_msg);
+            },
+            iterations, err_msg);
+}
@@ -0,0 +1,56 @@
+#include <pbconf/pbconf.h>
+#include <stdio.h>
+#include <string>
+
+#include "bench.h"
+#include "bench.pb.h"
+
+// Loading a yaml config through PbConf, parsing the file
+// every time and reading the binary snapshot cached next to it.
+
+static const int kEndpoints = 2000;
+
+static std::string EndpointsYaml() {
+    std::string content = "endpoints:\n";
+    for (int i = 0; i < kEndpoints; ++i) {
+        content += "  - name: endpoint-" + std::to_string(i) + "\n"
+            "    host: 10.0." + std::to_string(i % 256) + ".1\n"
+            "    port: " + std::to_string(8000 + i % 1000) + "\n"
+            "    protocol: GRPC\n"
+            "    timeout_ms: 1500\n"
+            "    tags: [zone-" + std::to_string(i % 8) + ", canary]\n";
+    }
+    return content;
+}
+
+static bool LoadEndpoints(bool snapshot_cache, int64_t iterations, std::string& err_msg) {
+    const std::string filename = "snapshot_bench.yml";
+    if (!pbconf::bench::WriteFile(filename, EndpointsYaml())) {
+        err_msg = "Fail to write " + filename;
+        return false;
+    }
+    // Start cold, the first load writes the snapshot.
+    remove((filename + ".pbcache").c_str());
+
+    for (int64_t i = 0; i < iterations; ++i) {
+        bench::Endpoints msg;
+        pbconf::PbConf conf;
+        if (!conf.SetFilename(filename).SetSnapshotCache(snapshot_cache).Load(msg)) {
+            err_msg = conf.ErrorMessage();
+            return false;
+        }
+        if (msg.endpoints_size() != kEndpoints) {
+            err_msg = "Wrong endpoint count";
+            return false;
+        }
+    }
+    return true;
+}
+
+PBCONF_BENCH(PbConfLoadEndpoints) {
+    return LoadEndpoints(false, iterations, err_msg);
+}
+
+PBCONF_BENCH(PbConfLoadEndpointsFromSnapshot) {
+    return LoadEndpoints(true, iterations, err_msg);
+}
@@ -0,0 +1,146 @@
+#include "change_notifier.h"
+
+#include <algorithm>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "field_path.h"
+
+namespace pbconf {
+
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using Message = ::google::protobuf::Message;
+using string = std::string;
+
+int ChangeNotifier::Subscribe(
+        const std::vector<string>& paths,
+        Callback callback,
+        string& err_msg) {
+    std::vector<std::vector<const FieldDescriptor*>> resolved(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!ResolveFieldPath(_descriptor, paths[i], &resolved[i], err_msg)) {
+            return -1;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(_mutex);
+    const int id = _next_id++;
+    Subscription& subscription = _subscriptions[id];
+    subscription.callback = std::move(callback);
+    for (const auto& fields : resolved) {
+        PathNode* node = _root.get();
+        for (const FieldDescriptor* field : fields) {
+            std::unique_ptr<PathNode>& child = node->children[field];
+            if (!child) {
+                child.reset(new PathNode());
+            }
+            node = child.get();
+        }
+        // The same path twice is one subscription.
+        if (std::find(node->subscribers.begin(), node->subscribers.end(), id)
+                == node->subscribers.end()) {
+            node->subscribers.push_back(id);
+            subscription.nodes.push_back(node);
+        }
+    }
+    return id;
+}
+
+void ChangeNotifier::Unsubscribe(int id) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto found = _subscriptions.find(id);
+    if (found == _subscriptions.end()) {
+        return;
+    }
+    for (PathNode* node : found->second.nodes) {
+        auto& subscribers = node->subscribers;
+        subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), id),
+                subscribers.end());
+    }
+    _subscriptions.erase(found);
+}
+
+void ChangeNotifier::Notify(
+        const std::shared_ptr<const Message>& conf,
+        const std::vector<string>& changed_paths) {
+    // Affected subscribers in the order they are first found,
+    // with the changed paths concerning each of them.
+    std::vector<std::pair<int, std::vector<string>>> affected;
+    std::unordered_map<int, size_t> positions;
+    auto affect = [&](const std::vector<int>& subscribers, const string& path) {
+        for (int id : subscribers) {
+            auto inserted = positions.emplace(id, affected.size());
+            if (inserted.second) {
+                affected.emplace_back(id, std::vector<string>());
+            }
+            auto& paths = affected[inserted.first->second].second;
+            if (paths.empty() || paths.back() != path) {
+                paths.push_back(path);
+            }
+        }
+    };
+
+    std::vector<std::function<void()>> tasks;
+    Executor executor;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        std::vector<const FieldDescriptor*> fields;
+        std::vector<const PathNode*> below;
+        for (const string& path : changed_paths) {
+            fields.clear();
+            string ignored;
+            if (!ResolveFieldPath(_descriptor, path, &fields, ignored)) {
+                continue;
+            }
+
+            // Subscribers of the fields on the path,
+            // then of every path below a changed field.
+            const PathNode* node = _root.get();
+            for (const FieldDescriptor* field : fields) {
+                auto child = node->children.find(field);
+                if (child == node->children.end()) {
+                    node = nullptr;
+                    break;
+                }
+                node = child->second.get();
+                affect(node->subscribers, path);
+            }
+            if (!node) {
+                continue;
+            }
+            below.assign(1, node);
+            while (!below.empty()) {
+                const PathNode* parent = below.back();
+                below.pop_back();
+                for (const auto& child : parent->children) {
+                    affect(child.second->subscribers, path);
+                    below.push_back(child.second.get());
+                }
+            }
+        }
+
+        tasks.reserve(affected.size());
+        for (auto& entry : affected) {
+            Callback callback = _subscriptions[entry.first].callback;
+            std::vector<string> paths = std::move(entry.second);
+            tasks.push_back([callback, conf, paths]() {
+                callback(conf, paths);
+            });
+        }
+        executor = _executor;
+    }
+
+    for (auto& task : tasks) {
+        if (executor) {
+            executor(std::move(task));
+        } else {
+            task();
+        }
+    }
+}
+
+}
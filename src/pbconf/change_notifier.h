@@ -0,0 +1,94 @@
+#ifndef CHANGE_NOTIFIER_H
+#define CHANGE_NOTIFIER_H
+
+#include <functional>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pbconf {
+
+// Calls subscribers of field paths when a reload changed them.
+//
+// Paths are field names joined by `.', e.g. `user' or `classmates.age',
+// with `(full.name)' for extensions. A path covers every element of
+// the repeated fields on it, so element indices are ignored.
+// Paths are resolved against the Descriptor when subscribing.
+//
+// Notify takes the changed paths of a reload, see
+// IncrementalState::ChangedPaths. A subscriber is affected by changes
+// below its path, and by changes of a field its path goes through.
+// Each affected subscriber is called once per Notify, on the executor,
+// with all of the changed paths concerning it. The cost of Notify
+// follows the number of changed paths, not the number of subscribers.
+class ChangeNotifier final {
+public:
+    typedef std::function<void(
+            const std::shared_ptr<const ::google::protobuf::Message>& conf,
+            const std::vector<std::string>& changed_paths)> Callback;
+    // Runs a task, e.g. on a thread pool or a bthread.
+    typedef std::function<void(std::function<void()>)> Executor;
+
+    explicit ChangeNotifier(const ::google::protobuf::Descriptor* descriptor)
+        : _descriptor(descriptor), _root(new PathNode()) {
+    }
+
+    ChangeNotifier(const ChangeNotifier&) = delete;
+    ChangeNotifier& operator=(const ChangeNotifier&) = delete;
+
+    // Subscribers are called on the notifying thread by default.
+    ChangeNotifier& SetExecutor(Executor executor) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _executor = std::move(executor);
+        return *this;
+    }
+
+    // Call `callback' when any of `paths' changed.
+    // Returns the id of the subscription if success;
+    // otherwise -1, with err_msg filled.
+    int Subscribe(
+            const std::vector<std::string>& paths,
+            Callback callback,
+            std::string& err_msg);
+
+    int Subscribe(
+            const std::string& path,
+            Callback callback,
+            std::string& err_msg) {
+        return Subscribe(std::vector<std::string>{path}, std::move(callback), err_msg);
+    }
+
+    void Unsubscribe(int id);
+
+    // Call the subscribers affected by `changed_paths' with `conf'.
+    void Notify(
+            const std::shared_ptr<const ::google::protobuf::Message>& conf,
+            const std::vector<std::string>& changed_paths);
+
+private:
+    struct PathNode {
+        std::unordered_map<const ::google::protobuf::FieldDescriptor*,
+            std::unique_ptr<PathNode>> children;
+        std::vector<int> subscribers;
+    };
+
+    struct Subscription {
+        Callback callback;
+        std::vector<PathNode*> nodes;
+    };
+
+    const ::google::protobuf::Descriptor* _descriptor;
+    std::mutex _mutex;
+    Executor _executor;
+    std::unique_ptr<PathNode> _root;
+    std::unordered_map<int, Subscription> _subscriptions;
+    int _next_id = 0;
+};
+
+}
+
+#endif
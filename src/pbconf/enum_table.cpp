@@ -0,0 +1,241 @@
+#include "enum_table.h"
+
+#include <algorithm>
+#include <google/protobuf/descriptor.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "number_conv.h"
+
+namespace pbconf {
+
+using EnumDescriptor = ::google::protobuf::EnumDescriptor;
+using EnumValueDescriptor = ::google::protobuf::EnumValueDescriptor;
+
+static inline char FoldCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static inline size_t HashName(
+        const char* name, size_t size, uint32_t seed, bool ignore_case) {
+    // FNV-1a, seeded
+    size_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (size_t i = 0; i < size; ++i) {
+        char c = ignore_case ? FoldCase(name[i]) : name[i];
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static inline bool NameEquals(
+        const std::string& expected, const char* name, size_t size,
+        bool ignore_case) {
+    if (expected.size() != size) {
+        return false;
+    }
+    if (!ignore_case) {
+        return memcmp(expected.data(), name, size) == 0;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        if (FoldCase(expected[i]) != FoldCase(name[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Seeds tried for each table size before falling back to probing.
+// A try stops at the first collision, so it costs little even for
+// large enums, which hardly ever get a table without collisions.
+static const uint32_t kMaxSeeds = 16;
+
+void EnumTable::NameTable::Build(
+        const std::vector<const EnumValueDescriptor*>& all_values,
+        bool fold) {
+    ignore_case = fold;
+    values = &all_values;
+
+    std::vector<int> members;
+    for (size_t i = 0; i < all_values.size(); ++i) {
+        if (all_values[i]) {
+            members.push_back(static_cast<int>(i));
+        }
+    }
+
+    // Try seeds until every name lands in its own slot, in a table of
+    // twice then four times as many slots as names. Otherwise probe on
+    // collisions, with a table at most half full.
+    size_t capacity = 8;
+    while (capacity < members.size() * 2) {
+        capacity <<= 1;
+    }
+    for (int doubling = 0; doubling < 2; ++doubling, capacity <<= 1) {
+        for (uint32_t candidate = 0; candidate < kMaxSeeds; ++candidate) {
+            slots.assign(capacity, -1);
+            bool collided = false;
+            for (int member : members) {
+                const std::string& name = all_values[member]->name();
+                size_t slot = HashName(name.data(), name.size(), candidate, fold)
+                    & (capacity - 1);
+                if (slots[slot] >= 0) {
+                    collided = true;
+                    break;
+                }
+                slots[slot] = member;
+            }
+            if (!collided) {
+                seed = candidate;
+                mask = capacity - 1;
+                probing = false;
+                return;
+            }
+        }
+    }
+
+    capacity >>= 2;
+    slots.assign(capacity, -1);
+    seed = 0;
+    mask = capacity - 1;
+    probing = true;
+    for (int member : members) {
+        const std::string& name = all_values[member]->name();
+        size_t slot = HashName(name.data(), name.size(), seed, fold) & mask;
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = member;
+    }
+}
+
+int EnumTable::NameTable::Find(const char* name, size_t size) const {
+    size_t slot = HashName(name, size, seed, ignore_case) & mask;
+    while (true) {
+        int member = slots[slot];
+        if (member < 0) {
+            return -1;
+        }
+        if (NameEquals((*values)[member]->name(), name, size, ignore_case)) {
+            return member;
+        }
+        if (!probing) {
+            return -1;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+// Orders names ignoring ASCII case.
+static bool FoldedLess(const EnumValueDescriptor* a, const EnumValueDescriptor* b) {
+    const std::string& x = a->name();
+    const std::string& y = b->name();
+    return std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end(),
+            [](char c, char d) { return FoldCase(c) < FoldCase(d); });
+}
+
+EnumTable::EnumTable(const EnumDescriptor* descriptor) : _descriptor(descriptor) {
+    for (int i = 0; i < descriptor->value_count(); ++i) {
+        _values.push_back(descriptor->value(i));
+    }
+    _names.Build(_values, false);
+
+    // Leave out the names which only differ by case,
+    // next to each other once sorted ignoring case.
+    std::vector<size_t> order(_values.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return FoldedLess(_values[a], _values[b]);
+    });
+    std::vector<const EnumValueDescriptor*> foldable(_values);
+    for (size_t i = 1; i < order.size(); ++i) {
+        const std::string& name = _values[order[i]]->name();
+        if (NameEquals(_values[order[i - 1]]->name(), name.data(), name.size(), true)) {
+            foldable[order[i - 1]] = nullptr;
+            foldable[order[i]] = nullptr;
+        }
+    }
+    _folded_values.swap(foldable);
+    _folded_names.Build(_folded_values, true);
+
+    if (_values.empty()) {
+        return;
+    }
+    int min_number = _values[0]->number();
+    int max_number = min_number;
+    for (auto value : _values) {
+        min_number = std::min(min_number, value->number());
+        max_number = std::max(max_number, value->number());
+    }
+    // Dense enough: at most 4 slots per value, plus some slack.
+    int64_t span = static_cast<int64_t>(max_number) - min_number + 1;
+    if (span <= static_cast<int64_t>(_values.size()) * 4 + 64) {
+        _min_number = min_number;
+        _by_number.assign(span, nullptr);
+        for (auto value : _values) {
+            // The first of aliased values wins, as in FindValueByNumber.
+            auto& slot = _by_number[value->number() - min_number];
+            if (!slot) {
+                slot = value;
+            }
+        }
+    }
+}
+
+const EnumTable& EnumTable::Get(const EnumDescriptor* descriptor) {
+    static std::mutex mutex;
+    static std::unordered_map<const EnumDescriptor*,
+        std::unique_ptr<EnumTable>> tables;
+
+    std::lock_guard<std::mutex> guard(mutex);
+    auto& table = tables[descriptor];
+    if (!table) {
+        table.reset(new EnumTable(descriptor));
+    }
+    return *table;
+}
+
+const EnumValueDescriptor* EnumTable::FindByNumber(int number) const {
+    if (_by_number.empty()) {
+        return _descriptor->FindValueByNumber(number);
+    }
+    int64_t pos = static_cast<int64_t>(number) - _min_number;
+    if (pos < 0 || pos >= static_cast<int64_t>(_by_number.size())) {
+        return nullptr;
+    }
+    return _by_number[pos];
+}
+
+const EnumValueDescriptor* EnumTable::FindByName(
+        const char* name, size_t size, bool ignore_case) const {
+    int member = _names.Find(name, size);
+    if (member >= 0) {
+        return _values[member];
+    }
+    if (!ignore_case) {
+        return nullptr;
+    }
+    member = _folded_names.Find(name, size);
+    return member >= 0 ? _folded_values[member] : nullptr;
+}
+
+const EnumValueDescriptor* EnumTable::Find(
+        const char* literal, size_t size, bool ignore_case) const {
+    if (size == 0) {
+        return nullptr;
+    }
+    char first = literal[0];
+    if ((first >= '0' && first <= '9') || first == '-' || first == '+') {
+        int32_t number = 0;
+        if (!ParseNumber(literal, size, number)) {
+            return nullptr;
+        }
+        return FindByNumber(number);
+    }
+    return FindByName(literal, size, ignore_case);
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef ENUM_TABLE_H
+#define ENUM_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <google/protobuf/descriptor.h>
+#include <vector>
+
+namespace pbconf {
+
+// Lookup tables of one enum type, built once and shared by all loads.
+// Names are found through a hash table, optionally ignoring ASCII
+// case, collision-free for most small enums, and numbers through a
+// dense array when the numbers are compact. Lookups never allocate.
+class EnumTable final {
+public:
+    // Returns the table of `descriptor', building it on first use.
+    // Thread-safe; the table lives until the process exits.
+    static const EnumTable& Get(
+            const ::google::protobuf::EnumDescriptor* descriptor);
+
+    const ::google::protobuf::EnumValueDescriptor* FindByNumber(int number) const;
+
+    const ::google::protobuf::EnumValueDescriptor* FindByName(
+            const char* name, size_t size, bool ignore_case) const;
+
+    // Resolve a conf literal, either a decimal number or a value name.
+    // Names never start with a digit or a sign,
+    // so the literal is parsed only the way that can match.
+    const ::google::protobuf::EnumValueDescriptor* Find(
+            const char* literal, size_t size, bool ignore_case) const;
+
+private:
+    explicit EnumTable(const ::google::protobuf::EnumDescriptor* descriptor);
+
+    // A hash table where every name owns one slot, probed linearly
+    // from the slot of its hash unless no names collide.
+    struct NameTable {
+        void Build(
+                const std::vector<const ::google::protobuf::EnumValueDescriptor*>& values,
+                bool ignore_case);
+        int Find(const char* name, size_t size) const;
+
+        bool ignore_case = false;
+        uint32_t seed = 0;
+        size_t mask = 0;
+        // Whether names collide, so that Find probes past their slot.
+        bool probing = false;
+        // Index into EnumTable::_values, -1 for empty slots.
+        std::vector<int> slots;
+        const std::vector<const ::google::protobuf::EnumValueDescriptor*>* values = nullptr;
+    };
+
+    const ::google::protobuf::EnumDescriptor* _descriptor;
+    std::vector<const ::google::protobuf::EnumValueDescriptor*> _values;
+    NameTable _names;
+    // Names folded to lower case. Names that only differ by case
+    // are left out(nullptr), they can only be found case-sensitively.
+    std::vector<const ::google::protobuf::EnumValueDescriptor*> _folded_values;
+    NameTable _folded_names;
+    // Dense table of numbers starting at _min_number,
+    // empty if the numbers are too sparse.
+    int _min_number = 0;
+    std::vector<const ::google::protobuf::EnumValueDescriptor*> _by_number;
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "field_path.h"
+
+#include <algorithm>
+#include <butil/strings/stringprintf.h>
+#include <google/protobuf/descriptor.h>
+#include <string>
+#include <vector>
+
+namespace pbconf {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using string = std::string;
+
+string FieldPath(const string& prefix, const FieldDescriptor* field) {
+    if (field->is_extension()) {
+        return prefix + "(" + field->full_name() + ")";
+    }
+    return prefix + field->name();
+}
+
+bool ResolveFieldPath(
+        const Descriptor* descriptor,
+        const string& path,
+        std::vector<const FieldDescriptor*>* fields,
+        string& err_msg) {
+    const Descriptor* type = descriptor;
+    size_t pos = 0;
+    while (pos < path.size()) {
+        if (!type) {
+            butil::StringAppendF(&err_msg, "Not a message field in path:%s", path.c_str());
+            return false;
+        }
+
+        // An extension `(full.name)' holds dots of its own.
+        size_t end = path[pos] == '(' ? path.find(')', pos) : pos;
+        if (end == string::npos) {
+            butil::StringAppendF(&err_msg, "Unbalanced parenthesis in path:%s", path.c_str());
+            return false;
+        }
+        end = std::min(path.find('.', end), path.size());
+        string name = path.substr(pos, end - pos);
+        // All elements of a repeated field are covered alike.
+        name = name.substr(0, name.find('['));
+        pos = end + 1;
+
+        const FieldDescriptor* field = nullptr;
+        if (name.size() > 2 && name.front() == '(' && name.back() == ')') {
+            field = type->file()->pool()->FindExtensionByName(name.substr(1, name.size() - 2));
+            if (field && field->containing_type() != type) {
+                field = nullptr;
+            }
+        } else {
+            field = type->FindFieldByName(name);
+        }
+        if (!field) {
+            butil::StringAppendF(&err_msg, "Unknown field `%s' in path:%s",
+                    name.c_str(), path.c_str());
+            return false;
+        }
+        fields->push_back(field);
+        type = field->message_type();
+    }
+
+    if (fields->empty()) {
+        butil::StringAppendF(&err_msg, "Empty field path");
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef FIELD_PATH_H
+#define FIELD_PATH_H
+
+#include <google/protobuf/descriptor.h>
+#include <string>
+#include <vector>
+
+namespace pbconf {
+
+// Field paths are field names joined by `.', e.g. `classmates[1].age',
+// with `(full.name)' for extensions.
+
+// The path of `field' under `prefix', which is empty or ends with `.'.
+std::string FieldPath(
+        const std::string& prefix,
+        const ::google::protobuf::FieldDescriptor* field);
+
+// Resolve `path' into the fields it goes through from `descriptor'.
+// Element indices are ignored, `classmates[1].age' resolves
+// the same as `classmates.age'.
+// Returns True if success; otherwise False, with err_msg filled.
+bool ResolveFieldPath(
+        const ::google::protobuf::Descriptor* descriptor,
+        const std::string& path,
+        std::vector<const ::google::protobuf::FieldDescriptor*>* fields,
+        std::string& err_msg);
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+#include "generated_loader.h"
+
+#include <atomic>
+#include <butil/strings/stringprintf.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pbconf {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using Message = ::google::protobuf::Message;
+
+namespace {
+
+// The loaders registered when it was built, by descriptor.
+// Never changed once published, so lookups read it without a lock.
+struct LoaderIndex {
+    size_t indexed = 0;
+    std::unordered_map<const Descriptor*, const GeneratedLoader*> loaders;
+};
+
+struct LoaderRegistry {
+    std::mutex mutex;
+    std::vector<const GeneratedLoader*> loaders;
+    // The size of `loaders', read without the mutex.
+    std::atomic<size_t> registered{0};
+    // Built lazily from `loaders': descriptors may not be
+    // available yet while loaders register themselves.
+    std::atomic<const LoaderIndex*> index{nullptr};
+    // Every index built, as lookups may still read the ones replaced
+    // after loaders registered late, e.g. by a library opened later.
+    std::vector<std::unique_ptr<const LoaderIndex>> indexes;
+};
+
+LoaderRegistry& Registry() {
+    static LoaderRegistry* registry = new LoaderRegistry();
+    return *registry;
+}
+
+// The index of all the loaders registered, built once they are.
+const LoaderIndex& CurrentIndex(LoaderRegistry& registry) {
+    const LoaderIndex* index = registry.index.load(std::memory_order_acquire);
+    if (index && index->indexed == registry.registered.load(std::memory_order_acquire)) {
+        return *index;
+    }
+
+    std::lock_guard<std::mutex> guard(registry.mutex);
+    index = registry.index.load(std::memory_order_relaxed);
+    if (index && index->indexed == registry.loaders.size()) {
+        return *index;
+    }
+    std::unique_ptr<LoaderIndex> built(new LoaderIndex());
+    built->indexed = registry.loaders.size();
+    for (const GeneratedLoader* loader : registry.loaders) {
+        built->loaders.emplace(loader->prototype()->GetDescriptor(), loader);
+    }
+    registry.index.store(built.get(), std::memory_order_release);
+    registry.indexes.push_back(std::move(built));
+    return *registry.indexes.back();
+}
+
+}
+
+void RegisterGeneratedLoader(const GeneratedLoader* loader) {
+    LoaderRegistry& registry = Registry();
+    std::lock_guard<std::mutex> guard(registry.mutex);
+    registry.loaders.push_back(loader);
+    registry.registered.store(registry.loaders.size(), std::memory_order_release);
+}
+
+const GeneratedLoader* FindGeneratedLoader(const Message& msg) {
+    const LoaderIndex& index = CurrentIndex(Registry());
+    auto found = index.loaders.find(msg.GetDescriptor());
+    if (found == index.loaders.end()) {
+        return nullptr;
+    }
+    // A DynamicMessage may share the descriptor of a generated type,
+    // but not the reflection of the generated class.
+    const GeneratedLoader* loader = found->second;
+    if (loader->prototype()->GetReflection() != msg.GetReflection()) {
+        return nullptr;
+    }
+    return loader;
+}
+
+namespace generated {
+
+bool ExpectValue(const char* type_name, const char* full_name, std::string& err_msg) {
+    butil::StringAppendF(&err_msg, "Expect %s value at:%s", type_name, full_name);
+    return false;
+}
+
+bool ExpectArray(const char* full_name, std::string& err_msg) {
+    butil::StringAppendF(&err_msg, "Expect array at:%s", full_name);
+    return false;
+}
+
+bool ExpectObject(const char* full_name, std::string& err_msg) {
+    butil::StringAppendF(&err_msg, "Expect an object for:%s", full_name);
+    return false;
+}
+
+bool Required(const char* full_name, std::string& err_msg) {
+    butil::StringAppendF(&err_msg, "Field is required:%s", full_name);
+    return false;
+}
+
+}
+
+}
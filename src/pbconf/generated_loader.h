@@ -0,0 +1,120 @@
+#ifndef GENERATED_LOADER_H
+#define GENERATED_LOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <string>
+#include <yaml-cpp/yaml.h>
+
+#include "enum_table.h"
+#include "json_reader.h"
+#include "map_field.h"
+
+namespace pbconf {
+
+// Loaders of one message type, emitted by protoc-gen-pbconf.
+// They convert a document straight into the generated message class
+// through its typed accessors, with a static switch over the keys,
+// instead of going through Reflection and a LoadPlan.
+struct GeneratedLoader {
+    // The default instance of the generated message class.
+    const ::google::protobuf::Message* (*prototype)();
+    bool (*load_yaml)(
+            const YAML::Node& node,
+            ::google::protobuf::Message& msg,
+            bool ignore_enum_case,
+            std::string& err_msg);
+    bool (*load_json)(
+            JsonReader& reader,
+            ::google::protobuf::Message& msg,
+            bool ignore_enum_case,
+            std::string& err_msg);
+};
+
+// Register `loader', which must live until the process exits.
+// Generated code calls it during static initialization.
+void RegisterGeneratedLoader(const GeneratedLoader* loader);
+
+// Returns the loader of the type of `msg', or nullptr if none is
+// registered, e.g. for a DynamicMessage of a generated type.
+// Thread-safe, and without a lock once no more loaders register.
+const GeneratedLoader* FindGeneratedLoader(const ::google::protobuf::Message& msg);
+
+// Used by the generated loaders, so that they convert values
+// and report errors the same way as the reflection loaders.
+namespace generated {
+
+bool Get(const YAML::Node& node, int32_t& value);
+bool Get(const YAML::Node& node, int64_t& value);
+bool Get(const YAML::Node& node, uint32_t& value);
+bool Get(const YAML::Node& node, uint64_t& value);
+bool Get(const YAML::Node& node, bool& value);
+bool Get(const YAML::Node& node, float& value);
+bool Get(const YAML::Node& node, double& value);
+bool Get(const YAML::Node& node, std::string& value);
+const ::google::protobuf::EnumValueDescriptor* GetEnum(
+        const YAML::Node& node, const EnumTable& table, bool ignore_case);
+// Load a message whose type has no loader in the same file,
+// through its own generated loader if any, otherwise through Reflection.
+bool LoadMessage(
+        const YAML::Node& node,
+        ::google::protobuf::Message& msg,
+        bool ignore_enum_case,
+        std::string& err_msg);
+// Load the field numbered `number' of msg through Reflection,
+// e.g. a map field written as the list of its entries.
+bool LoadField(
+        const YAML::Node& node,
+        ::google::protobuf::Message& msg,
+        int number,
+        bool ignore_enum_case,
+        std::string& err_msg);
+// Parse a map key as the reflection loaders do, see ParseMapKey.
+template <typename T>
+inline bool GetKey(const YAML::Node& node, T& value) {
+    if (!node.IsScalar()) {
+        return false;
+    }
+    const std::string& text = node.Scalar();
+    return ParseMapKey(text.data(), text.size(), value);
+}
+
+bool Get(JsonReader& reader, int32_t& value);
+bool Get(JsonReader& reader, int64_t& value);
+bool Get(JsonReader& reader, uint32_t& value);
+bool Get(JsonReader& reader, uint64_t& value);
+bool Get(JsonReader& reader, bool& value);
+bool Get(JsonReader& reader, float& value);
+bool Get(JsonReader& reader, double& value);
+bool Get(JsonReader& reader, std::string& value);
+const ::google::protobuf::EnumValueDescriptor* GetEnum(
+        JsonReader& reader, const EnumTable& table, bool ignore_case);
+bool LoadMessage(
+        JsonReader& reader,
+        ::google::protobuf::Message& msg,
+        bool ignore_enum_case,
+        std::string& err_msg);
+bool LoadField(
+        JsonReader& reader,
+        ::google::protobuf::Message& msg,
+        int number,
+        bool ignore_enum_case,
+        std::string& err_msg);
+template <typename T>
+inline bool GetKey(const char* data, size_t size, T& value) {
+    return ParseMapKey(data, size, value);
+}
+
+// Append the error and return False.
+bool ExpectValue(const char* type_name, const char* full_name, std::string& err_msg);
+bool ExpectArray(const char* full_name, std::string& err_msg);
+bool ExpectObject(const char* full_name, std::string& err_msg);
+bool Required(const char* full_name, std::string& err_msg);
+
+}
+
+}
+
+#endif
@@ -2,7 +2,8 @@
 
 #include <algorithm>
 #include <boost/exception/diagnostic_information.hpp> 
-#include <boost/lexical_cast.hpp>
+#include <butil/file_util.h>
+#include <butil/files/file_path.h>
 #include <butil/strings/stringprintf.h>
 #include <google/protobuf/message.h>
 #include <string>
@@ -12,12 +13,24 @@
 #include <hocon/config_parse_options.hpp>
 #include <hocon/config_syntax.hpp>
 #include <hocon/config_value.hpp>
+#include <hocon/types.hpp>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 //#include <internal/values/config_int.hpp>
 
+#include "include_cache.h"
+#include "lazy_fields.h"
+#include "load_mask.h"
+#include "load_metrics.h"
+#include "load_plan.h"
+#include "map_field.h"
+#include "number_conv.h"
+#include "repeated_field.h"
+
 namespace pbconf {
 
 using Descriptor = ::google::protobuf::Descriptor;
@@ -30,7 +43,24 @@ using string = std::string;
 using shared_object = ::hocon::shared_object;
 using shared_value = ::hocon::shared_value;
 
-static bool OnMap(shared_object node, Message& msg, string& err_msg);
+using FieldPlan = ::pbconf::BasicFieldPlan<shared_value>;
+using LoadPlan = ::pbconf::BasicLoadPlan<shared_value>;
+
+// Where OnMap leaves the lazy fields of the root message.
+struct LazySink {
+    LazyFields* fields;
+    bool ignore_enum_case;
+};
+
+static bool OnMap(
+        shared_object node,
+        const LoadPlan& plan,
+        Message& msg,
+        string& err_msg,
+        const LazySink* lazy = nullptr,
+        const LoadMask* mask = nullptr);
+
+static void Defer(shared_value node, const FieldPlan& plan, const LazySink& lazy);
 
 static bool IsMap(shared_value node) {
     return node->value_type() == ::hocon::config_value::type::OBJECT;
@@ -40,19 +70,10 @@ static bool IsNull(shared_value node) {
     return node->value_type() == ::hocon::config_value::type::CONFIG_NULL;
 }
 
-template <typename T>
-static bool OnNodeFor(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    return false;
-}
-
 template <typename T>
 static bool OnNodeForSingle(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     return false;
@@ -61,7 +82,7 @@ static bool OnNodeForSingle(
 template <typename T>
 static bool OnNodeForRepeated(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     return false;
@@ -72,28 +93,56 @@ static inline bool get(shared_value node, T& value) {
     return false;
 }
 
-// Begin int32_t
-template <>
-inline bool get<int32_t>(shared_value node, int32_t& value) {
+// A double held by hocon converts directly into floating point fields.
+template <typename T>
+static typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+GetFromDouble(shared_value node, double typed, T& value) {
+    return CastNumber(typed, value);
+}
+
+// Integer fields go through the literal instead,
+// which still accepts uint64 values above the int64 range.
+template <typename T>
+static typename std::enable_if<std::is_integral<T>::value, bool>::type
+GetFromDouble(shared_value node, double typed, T& value) {
+    string literal = node->transform_to_string();
+    return ParseNumber(literal.data(), literal.size(), value);
+}
+
+// Read the number a hocon node already holds,
+// without formatting it back to a string.
+template <typename T>
+static bool GetNumber(shared_value node, T& value) {
     if (!node || node->value_type() != ::hocon::config_value::type::NUMBER) {
         return false;
     }
-    string literal = node->transform_to_string();
 
-    try {
-        value = boost::lexical_cast<int32_t>(literal);
-    } catch (boost::bad_lexical_cast& e) {
-        return false;
+    auto unwrapped = node->unwrapped();
+    if (const int* typed = boost::get<int>(&unwrapped)) {
+        return CastNumber(*typed, value);
     }
-    return true;
+    if (const int64_t* typed = boost::get<int64_t>(&unwrapped)) {
+        return CastNumber(*typed, value);
+    }
+    if (const double* typed = boost::get<double>(&unwrapped)) {
+        return GetFromDouble(node, *typed, value);
+    }
+    return false;
+}
+
+// Begin int32_t
+template <>
+inline bool get<int32_t>(shared_value node, int32_t& value) {
+    return GetNumber(node, value);
 }
 
 template <>
 inline bool OnNodeForSingle<int32_t>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     int32_t value{0};
     if (!get(node, value)) {
         return false;
@@ -106,7 +155,7 @@ inline bool OnNodeForSingle<int32_t>(
 template <>
 inline bool OnNodeForRepeated<int32_t>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -115,56 +164,33 @@ inline bool OnNodeForRepeated<int32_t>(
     }
 
     auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<int32_t>(
+            parent_msg, plan.field, real_node->size());
 
     int32_t value{0};
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddInt32(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<int32_t>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<int32_t>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<int32_t>(node, field, parent_msg, err_msg);
-    }
-}
 // End int32_t
 
 // Begin int64_t
 template <>
 inline bool get<int64_t>(shared_value node, int64_t& value) {
-    if (!node || node->value_type() != ::hocon::config_value::type::NUMBER) {
-        return false;
-    }
-    string literal = node->transform_to_string();
-
-    try {
-        value = boost::lexical_cast<int64_t>(literal);
-    } catch (boost::bad_lexical_cast& e) {
-        return false;
-    }
-    return true;
+    return GetNumber(node, value);
 }
 
 template <>
 inline bool OnNodeForSingle<int64_t>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     int64_t value{0};
     if (!get(node, value)) {
         return false;
@@ -177,7 +203,7 @@ inline bool OnNodeForSingle<int64_t>(
 template <>
 inline bool OnNodeForRepeated<int64_t>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -186,56 +212,33 @@ inline bool OnNodeForRepeated<int64_t>(
     }
 
     auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<int64_t>(
+            parent_msg, plan.field, real_node->size());
 
     int64_t value{0};
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddInt64(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<int64_t>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<int64_t>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<int64_t>(node, field, parent_msg, err_msg);
-    }
-}
 // End int64_t
 
 // Begin uint32_t
 template <>
 inline bool get<uint32_t>(shared_value node, uint32_t& value) {
-    if (!node || node->value_type() != ::hocon::config_value::type::NUMBER) {
-        return false;
-    }
-    string literal = node->transform_to_string();
-
-    try {
-        value = boost::lexical_cast<uint32_t>(literal);
-    } catch (boost::bad_lexical_cast& e) {
-        return false;
-    }
-    return true;
+    return GetNumber(node, value);
 }
 
 template <>
 inline bool OnNodeForSingle<uint32_t>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     uint32_t value{0};
     if (!get(node, value)) {
         return false;
@@ -248,7 +251,7 @@ inline bool OnNodeForSingle<uint32_t>(
 template <>
 inline bool OnNodeForRepeated<uint32_t>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -257,56 +260,33 @@ inline bool OnNodeForRepeated<uint32_t>(
     }
 
     auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<uint32_t>(
+            parent_msg, plan.field, real_node->size());
 
     uint32_t value{0};
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddUInt32(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<uint32_t>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<uint32_t>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<uint32_t>(node, field, parent_msg, err_msg);
-    }
-}
 // End uint32_t
 
 // Begin uint64_t
 template <>
 inline bool get<uint64_t>(shared_value node, uint64_t& value) {
-    if (!node || node->value_type() != ::hocon::config_value::type::NUMBER) {
-        return false;
-    }
-    string literal = node->transform_to_string();
-
-    try {
-        value = boost::lexical_cast<uint64_t>(literal);
-    } catch (boost::bad_lexical_cast& e) {
-        return false;
-    }
-    return true;
+    return GetNumber(node, value);
 }
 
 template <>
 inline bool OnNodeForSingle<uint64_t>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     uint64_t value{0};
     if (!get(node, value)) {
         return false;
@@ -319,7 +299,7 @@ inline bool OnNodeForSingle<uint64_t>(
 template <>
 inline bool OnNodeForRepeated<uint64_t>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -328,32 +308,18 @@ inline bool OnNodeForRepeated<uint64_t>(
     }
 
     auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<uint64_t>(
+            parent_msg, plan.field, real_node->size());
 
     uint64_t value{0};
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddUInt64(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<uint64_t>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<uint64_t>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<uint64_t>(node, field, parent_msg, err_msg);
-    }
-}
 // End uint64_t
 
 // Begin bool
@@ -363,25 +329,22 @@ inline bool get<bool>(shared_value node, bool& value) {
         return false;
     }
 
-    string literal = node->transform_to_string();
-    if (literal.compare("true") == 0) {
-        value = true;
-        return true;
-    }
-    if (literal.compare("false") == 0) {
-        value = false;
-        return true;
+    auto unwrapped = node->unwrapped();
+    const bool* typed = boost::get<bool>(&unwrapped);
+    if (!typed) {
+        return false;
     }
-
-    return false;
+    value = *typed;
+    return true;
 }
 
 template <>
 inline bool OnNodeForSingle<bool>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     bool value{false};
     if (!get(node, value)) {
         butil::StringAppendF(&err_msg, "Expect boolean value at:%s",
@@ -396,7 +359,7 @@ inline bool OnNodeForSingle<bool>(
 template <>
 inline bool OnNodeForRepeated<bool>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -405,56 +368,33 @@ inline bool OnNodeForRepeated<bool>(
     }
 
     auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<bool>(
+            parent_msg, plan.field, real_node->size());
 
     bool value{false};
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddBool(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<bool>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<bool>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<bool>(node, field, parent_msg, err_msg);
-    }
-}
 // End bool
 
 // Begin float
 template <>
 inline bool get<float>(shared_value node, float& value) {
-    if (!node || node->value_type() != ::hocon::config_value::type::NUMBER) {
-        return false;
-    }
-    string literal = node->transform_to_string();
-
-    try {
-        value = boost::lexical_cast<float>(literal);
-    } catch (boost::bad_lexical_cast& e) {
-        return false;
-    }
-    return true;
+    return GetNumber(node, value);
 }
 
 template <>
 inline bool OnNodeForSingle<float>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     float value{0.};
     if (!get(node, value)) {
         butil::StringAppendF(&err_msg, "Expect float value at:%s",
@@ -469,7 +409,7 @@ inline bool OnNodeForSingle<float>(
 template <>
 inline bool OnNodeForRepeated<float>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -478,56 +418,33 @@ inline bool OnNodeForRepeated<float>(
     }
 
     auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<float>(
+            parent_msg, plan.field, real_node->size());
 
     float value{0.};
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddFloat(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<float>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<float>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<float>(node, field, parent_msg, err_msg);
-    }
-}
 // End float
 
 // Begin double
 template <>
 inline bool get<double>(shared_value node, double& value) {
-    if (!node || node->value_type() != ::hocon::config_value::type::NUMBER) {
-        return false;
-    }
-    string literal = node->transform_to_string();
-
-    try {
-        value = boost::lexical_cast<double>(literal);
-    } catch (boost::bad_lexical_cast& e) {
-        return false;
-    }
-    return true;
+    return GetNumber(node, value);
 }
 
 template <>
 inline bool OnNodeForSingle<double>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     double value{0.};
     if (!get(node, value)) {
         butil::StringAppendF(&err_msg, "Expect double value at:%s",
@@ -542,7 +459,7 @@ inline bool OnNodeForSingle<double>(
 template <>
 inline bool OnNodeForRepeated<double>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -551,32 +468,18 @@ inline bool OnNodeForRepeated<double>(
     }
 
     auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<double>(
+            parent_msg, plan.field, real_node->size());
 
     double value{0.};
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddDouble(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<double>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<double>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<double>(node, field, parent_msg, err_msg);
-    }
-}
 // End double
 
 // Begin enum
@@ -585,39 +488,45 @@ enum DummyEnum {};
 template <>
 inline bool get<string>(shared_value node, string& value);
 
-template <>
-inline bool OnNodeForSingle<enum DummyEnum>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const EnumValueDescriptor* enumd = nullptr;
-
+// cpp-hocon only hands a string value out as a copy, so each name
+// costs one std::string, which allocates unless the name is short
+// enough for its inline buffer. The lookup itself allocates nothing.
+static const EnumValueDescriptor* GetEnum(shared_value node, const FieldPlan& plan) {
     int32_t value{0};
     if (get<int32_t>(node, value)) {
-        enumd = field->enum_type()->FindValueByNumber(value);
+        return plan.enum_table->FindByNumber(value);
     }
 
     std::string literal;
-    if (!enumd && get<std::string>(node, literal)) {
-        enumd = field->enum_type()->FindValueByName(literal);
+    if (get<std::string>(node, literal)) {
+        return plan.enum_table->FindByName(
+                literal.data(), literal.size(), plan.ignore_enum_case);
     }
+    return nullptr;
+}
 
+template <>
+inline bool OnNodeForSingle<enum DummyEnum>(
+        shared_value node,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    const EnumValueDescriptor* enumd = GetEnum(node, plan);
     if (!enumd) {
         butil::StringAppendF(&err_msg, "Expect enum value at:%s",
-                field->full_name().c_str());
+                plan.field->full_name().c_str());
         return false;
     }
 
     const Reflection* reflection = parent_msg.GetReflection();
-    reflection->SetEnum(&parent_msg, field, enumd);
+    reflection->SetEnum(&parent_msg, plan.field, enumd);
     return true;
 }
 
 template <>
 inline bool OnNodeForRepeated<enum DummyEnum>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -629,42 +538,16 @@ inline bool OnNodeForRepeated<enum DummyEnum>(
     const Reflection* reflection = parent_msg.GetReflection();
 
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
-        const EnumValueDescriptor* enumd = nullptr;
-
-        int32_t value{0};
-        if (get<int32_t>(*citr, value)) {
-            enumd = field->enum_type()->FindValueByNumber(value);
-        }
-
-        std::string literal;
-        if (!enumd && get<std::string>(*citr, literal)) {
-            enumd = field->enum_type()->FindValueByName(literal);
-        }
-
+        const EnumValueDescriptor* enumd = GetEnum(*citr, plan);
         if (!enumd) {
             butil::StringAppendF(&err_msg, "Expect enum value at:%s",
-                    field->full_name().c_str());
+                    plan.field->full_name().c_str());
             return false;
         }
-
-        const Reflection* reflection = parent_msg.GetReflection();
-        reflection->AddEnum(&parent_msg, field, enumd);
+        reflection->AddEnum(&parent_msg, plan.field, enumd);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<enum DummyEnum>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<enum DummyEnum>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<enum DummyEnum>(node, field, parent_msg, err_msg);
-    }
-}
 // End enum
 
 // Begin string
@@ -680,24 +563,26 @@ inline bool get<string>(shared_value node, string& value) {
 template <>
 inline bool OnNodeForSingle<string>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     string value;
     if (!get(node, value)) {
-        butil::StringAppendF(&err_msg, "Expect double value at:%s",
+        butil::StringAppendF(&err_msg, "Expect string value at:%s",
                 field->full_name().c_str());
         return false;
     }
+    // transform_to_string() returns a new string, move it on from there.
     const Reflection* reflection = parent_msg.GetReflection();
-    reflection->SetString(&parent_msg, field, value);
+    reflection->SetString(&parent_msg, field, std::move(value));
     return true;
 }
 
 template <>
 inline bool OnNodeForRepeated<string>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
@@ -706,32 +591,17 @@ inline bool OnNodeForRepeated<string>(
     }
 
     auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<string>(
+            parent_msg, plan.field, real_node->size());
 
-    string value;
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
-        if (!get(*citr, value)) {
+        if (!get(*citr, *values->Add())) {
+            values->RemoveLast();
             return false;
         }
-        reflection->AddString(&parent_msg, field, value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<string>(
-        shared_value node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<string>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<string>(node, field, parent_msg, err_msg);
-    }
-}
 // End string
 
 // Begin message
@@ -740,22 +610,24 @@ class DummyClass {};
 template <>
 inline bool OnNodeForSingle<DummyClass>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     const Reflection* reflection = parent_msg.GetReflection();
 
     Message& child_msg = *(reflection->MutableMessage(&parent_msg, field));
     auto real_node = std::static_pointer_cast<const ::hocon::config_object>(node);
-    return OnMap(real_node, child_msg, err_msg);
+    return OnMap(real_node, *plan.message_plan, child_msg, err_msg);
 }
 
 template <>
 inline bool OnNodeForRepeated<DummyClass>(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
         butil::StringAppendF(&err_msg, "Wrong type");
         return false;
@@ -767,129 +639,274 @@ inline bool OnNodeForRepeated<DummyClass>(
     for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
         Message& child_msg = *(reflection->AddMessage(&parent_msg, field));
         auto sub_node = std::static_pointer_cast<const ::hocon::config_object>(*citr);
-        if (!OnMap(sub_node, child_msg, err_msg)) {
+        if (!OnMap(sub_node, *plan.message_plan, child_msg, err_msg)) {
             return false;
         }
     }
     return true;
 }
 
-template <>
-inline bool OnNodeFor<DummyClass>(
+// Convert the message field of `plan', only the fields in `mask'.
+static bool OnMaskedMessage(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
+        const LoadMask& mask,
         Message& parent_msg,
         string& err_msg) {
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<DummyClass>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<DummyClass>(node, field, parent_msg, err_msg);
+    const FieldDescriptor* field = plan.field;
+    const Reflection* reflection = parent_msg.GetReflection();
+    if (!field->is_repeated()) {
+        Message& child_msg = *(reflection->MutableMessage(&parent_msg, field));
+        auto real_node = std::static_pointer_cast<const ::hocon::config_object>(node);
+        return OnMap(real_node, *plan.message_plan, child_msg, err_msg, nullptr, &mask);
+    }
+
+    if (!node || node->value_type() != ::hocon::config_value::type::LIST) {
+        butil::StringAppendF(&err_msg, "Wrong type");
+        return false;
+    }
+    auto real_node = std::static_pointer_cast<const ::hocon::config_list>(node);
+    for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
+        Message& child_msg = *(reflection->AddMessage(&parent_msg, field));
+        auto sub_node = std::static_pointer_cast<const ::hocon::config_object>(*citr);
+        if (!OnMap(sub_node, *plan.message_plan, child_msg, err_msg, nullptr, &mask)) {
+            return false;
+        }
     }
+    return true;
 }
 // End message
 
 static bool OnNode(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg);
 
-static bool OnMap(shared_object node, Message& msg, string& err_msg) {
+// Begin map
+// An object fills a map field with one entry per key,
+// a list is taken as the list of its entries.
+static bool OnNodeForMap(
+        shared_value node,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    if (!node || !IsMap(node)) {
+        return OnNodeForRepeated<DummyClass>(node, plan, parent_msg, err_msg);
+    }
+
+    auto real_node = std::static_pointer_cast<const ::hocon::config_object>(node);
+    const FieldPlan& value_plan = plan.message_plan->fields[kMapValuePos];
+    const Reflection* reflection = parent_msg.GetReflection();
+    MutableRepeated<Message>(parent_msg, plan.field, real_node->size());
+    for (auto citr = real_node->begin(); citr != real_node->end(); ++citr) {
+        Message& entry_msg = *(reflection->AddMessage(&parent_msg, plan.field));
+        const string& key = citr->first;
+        if (!SetMapKey(entry_msg, key.data(), key.size(), err_msg)) {
+            return false;
+        }
+        // A null value leaves the default one.
+        if (citr->second && !IsNull(citr->second)
+                && !OnNode(citr->second, value_plan, entry_msg, err_msg)) {
+            return false;
+        }
+    }
+    return true;
+}
+// End map
+
+static bool OnMap(
+        shared_object node,
+        const LoadPlan& plan,
+        Message& msg,
+        string& err_msg,
+        const LazySink* lazy,
+        const LoadMask* mask) {
     if (!node || !IsMap(node)) {
         butil::StringAppendF(&err_msg, "Expect an map/object");
         return false;
     }
 
-    const Descriptor* descriptor = msg.GetDescriptor();
-    const Reflection* reflection = msg.GetReflection();
+    // Walk the keys of the object once,
+    // resolving each of them through the plan's name index.
+    PresenceBitmap present(plan.fields.size());
+    for (auto citr = node->begin(); citr != node->end(); ++citr) {
+        int pos = plan.index.Find(citr->first);
+        // Not in the schema, or a null value which is the same as a missing one.
+        if (pos < 0 || !citr->second || IsNull(citr->second)) {
+            continue;
+        }
+        // Not in the mask.
+        if (mask && !mask->Contains(pos)) {
+            continue;
+        }
 
-    // Collect all field descriptors of msg,
-    // including the normal and extended fields.
-    std::vector<const FieldDescriptor*> fields;
-    for (int i = 0; i < descriptor->field_count(); ++i) {
-        fields.push_back(descriptor->field(i));
-    }
-    for (int i = 0; i < descriptor->extension_range_count(); ++i) {
-        auto range = descriptor->extension_range(i);
-        for (int tag = range->start; tag < range->end; ++tag) {
-            auto field = reflection->FindKnownExtensionByNumber(tag);
-            if (field) {
-                fields.push_back(field);
+        present.Set(pos);
+        if (lazy && lazy->fields->IsLazy(plan.fields[pos].field)) {
+            Defer(citr->second, plan.fields[pos], *lazy);
+            continue;
+        }
+        const LoadMask* child_mask = mask ? mask->Child(pos) : nullptr;
+        if (child_mask) {
+            if (!OnMaskedMessage(citr->second, plan.fields[pos], *child_mask, msg, err_msg)) {
+                return false;
             }
+        } else if (!OnNode(citr->second, plan.fields[pos], msg, err_msg)) {
+            return false;
         }
     }
 
-	// Convert each sub-node.
-    for (auto field : fields) {
-        auto field_node = (*node)[field->name()];
-        if (!OnNode(field_node, field, msg, err_msg)) {
+    // Missing the required field
+    for (auto pos : mask ? mask->Required() : plan.required) {
+        if (!present.Test(pos)) {
+            butil::StringAppendF(&err_msg, "Field is required:%s",
+                    plan.fields[pos].field->full_name().c_str());
             return false;
         }
-	}
+    }
 
     return true;
 }
 
-static inline bool OnRootNode(shared_object node, Message& msg, string& err_msg) {
+static inline bool OnRootNode(
+        shared_object node,
+        const LoadPlan& plan,
+        Message& msg,
+        string& err_msg,
+        const LazySink* lazy = nullptr,
+        const LoadMask* mask = nullptr) {
     // Root node is an object (which is a map)
-    return OnMap(node, msg, err_msg);
+    return OnMap(node, plan, msg, err_msg, lazy, mask);
 }
 
 static bool OnNode(
         shared_value node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    // Missing the required field
-    if (field->is_required() && (!node || IsNull(node))) {
-        butil::StringAppendF(&err_msg, "Field is required:%s",
-                field->full_name().c_str());
-        return false;
+    if (!plan.convert) {
+        return true;
+    }
+    return plan.convert(node, plan, parent_msg, err_msg);
+}
+
+template <typename T>
+static FieldPlan::Converter ConverterFor(const FieldDescriptor* field) {
+    if (field->is_repeated()) {
+        return &OnNodeForRepeated<T>;
+    } else {
+        return &OnNodeForSingle<T>;
+    }
+}
+
+// Resolve the converter of field once, when its LoadPlan is built.
+static FieldPlan::Converter ResolveConverter(const FieldDescriptor* field) {
+    if (field->is_map()) {
+        return &OnNodeForMap;
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT32) {
-        return OnNodeFor<int32_t>(node, field, parent_msg, err_msg);
+        return ConverterFor<int32_t>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
-        return OnNodeFor<int64_t>(node, field, parent_msg, err_msg);
+        return ConverterFor<int64_t>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT32) {
-        return OnNodeFor<uint32_t>(node, field, parent_msg, err_msg);
+        return ConverterFor<uint32_t>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT64) {
-        return OnNodeFor<uint64_t>(node, field, parent_msg, err_msg);
+        return ConverterFor<uint64_t>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
-        return OnNodeFor<bool>(node, field, parent_msg, err_msg);
+        return ConverterFor<bool>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT) {
-        return OnNodeFor<float>(node, field, parent_msg, err_msg);
+        return ConverterFor<float>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE) {
-        return OnNodeFor<double>(node, field, parent_msg, err_msg);
+        return ConverterFor<double>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
-        return OnNodeFor<enum DummyEnum>(node, field, parent_msg, err_msg);
+        return ConverterFor<enum DummyEnum>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
-        return OnNodeFor<string>(node, field, parent_msg, err_msg);
+        return ConverterFor<string>(field);
     }
     if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
-        return OnNodeFor<DummyClass>(node, field, parent_msg, err_msg);
+        return ConverterFor<DummyClass>(field);
     }
 
-    return true;
+    return nullptr;
+}
+
+static LoadPlanRegistry<shared_value>& PlanRegistry(bool ignore_enum_case) {
+    static LoadPlanRegistry<shared_value> registry(ResolveConverter);
+    static LoadPlanRegistry<shared_value> ignore_case_registry(ResolveConverter, true);
+    return ignore_enum_case ? ignore_case_registry : registry;
+}
+
+// Loads a lazy field from its parsed value on first access.
+struct DeferredHocon {
+    shared_value node;
+    bool ignore_enum_case;
+
+    bool operator()(Message& msg, string& err_msg) {
+        try {
+            const LoadPlan& plan =
+                PlanRegistry(ignore_enum_case).Get(msg.GetDescriptor());
+            return OnMap(std::static_pointer_cast<const ::hocon::config_object>(node),
+                    plan, msg, err_msg);
+        } catch (...) {
+            err_msg = boost::current_exception_diagnostic_information();
+            return false;
+        }
+    }
+};
+
+// Hocon values are immutable and hold no reference to their parent,
+// so keeping the value of a lazy field only keeps its subtree.
+static void Defer(shared_value node, const FieldPlan& plan, const LazySink& lazy) {
+    lazy.fields->Defer(plan.field, DeferredHocon{node, lazy.ignore_enum_case});
 }
 
 bool HoconConf::Load(const string& filename, Message& msg, string& err_msg) {
-    hocon::config_parse_options option;
-    option.set_syntax(config_syntax::CONF);
-    option.set_allow_missing(true);
+    const bool ok = LoadFile(filename, msg, err_msg);
+    if (_metrics) {
+        _metrics->RecordResult(LoadMetrics::HOCON, ok, msg);
+    }
+    return ok;
+}
+
+bool HoconConf::LoadFile(const string& filename, Message& msg, string& err_msg) {
+    int64_t size = 0;
+    if (_metrics && butil::GetFileSize(butil::FilePath(filename), &size)) {
+        _metrics->RecordBytesRead(LoadMetrics::HOCON, size);
+    }
+
+    // The setters return a modified copy.
+    hocon::config_parse_options option = hocon::config_parse_options()
+        .set_syntax(config_syntax::CONF)
+        .set_allow_missing(true);
+    if (_include_cache) {
+        option = _include_cache->Options(filename, option);
+    }
 
     try {
-        hocon::shared_config conf =
-            hocon::config::parse_file_any_syntax(filename, option);
-        shared_object root = conf->root();
-        return OnRootNode(root, msg, err_msg);
+        shared_object root;
+        {
+            // Reads the file while parsing it.
+            ScopedPhase parse(_metrics, LoadMetrics::HOCON, LoadMetrics::PARSE);
+            hocon::shared_config conf =
+                hocon::config::parse_file_any_syntax(filename, option);
+            root = conf->root();
+        }
+        ScopedPhase convert(_metrics, LoadMetrics::HOCON, LoadMetrics::CONVERT);
+        if (_lazy && !_lazy->Reset(msg, err_msg)) {
+            return false;
+        }
+        const LoadPlan& plan =
+            PlanRegistry(_ignore_enum_case).Get(msg.GetDescriptor());
+        LazySink lazy{_lazy, _ignore_enum_case};
+        return OnRootNode(root, plan, msg, err_msg, _lazy ? &lazy : nullptr, _mask);
     } catch (...) {
         err_msg = boost::current_exception_diagnostic_information();
         return false;
@@ -6,8 +6,54 @@
 
 namespace pbconf {
 
+class IncludeCache;
+class LazyFields;
+class LoadMask;
+class LoadMetrics;
+
 class HoconConf final {
 public:
+    // Match enum names ignoring ASCII case, e.g. `red' for `RED'.
+    // Names that only differ by case still need the exact spelling.
+    // Unlike yaml and json, each enum name is copied out of cpp-hocon
+    // into a std::string, which allocates for names too long for its
+    // inline buffer, 15 characters with libstdc++.
+    HoconConf& SetIgnoreEnumCase(bool ignore_enum_case) {
+        _ignore_enum_case = ignore_enum_case;
+        return *this;
+    }
+
+    // Leave the lazy fields of the root message to `lazy', to be
+    // converted on first access, see LazyFields.
+    // `lazy' must outlive the loads.
+    HoconConf& SetLazyFields(LazyFields* lazy) {
+        _lazy = lazy;
+        return *this;
+    }
+
+    // Parse the files the conf file includes through `cache',
+    // once for all the conf files including them, see IncludeCache.
+    // `cache' must outlive the loads.
+    HoconConf& SetIncludeCache(IncludeCache* cache) {
+        _include_cache = cache;
+        return *this;
+    }
+
+    // Only convert the fields in `mask', skipping the others, see
+    // LoadMask. Lazy fields in the mask are converted whole when
+    // accessed. `mask' must outlive the loads.
+    HoconConf& SetLoadMask(const LoadMask* mask) {
+        _mask = mask;
+        return *this;
+    }
+
+    // Record the phases, size and result of each load
+    // into `metrics', see LoadMetrics. The metrics must outlive the loads.
+    HoconConf& SetMetrics(LoadMetrics* metrics) {
+        _metrics = metrics;
+        return *this;
+    }
+
     // Treat the specified file named `filename'
     // as a hocon-formatted conf file.
     // Load the conf info into msg.
@@ -16,6 +62,18 @@ public:
             const std::string& filename,
             ::google::protobuf::Message& msg,
             std::string& err_msg);
+
+private:
+    bool LoadFile(
+            const std::string& filename,
+            ::google::protobuf::Message& msg,
+            std::string& err_msg);
+
+    bool _ignore_enum_case = false;
+    IncludeCache* _include_cache = nullptr;
+    LazyFields* _lazy = nullptr;
+    const LoadMask* _mask = nullptr;
+    LoadMetrics* _metrics = nullptr;
 };
 
 }
@@ -0,0 +1,195 @@
+#include "include_cache.h"
+
+#include <algorithm>
+#include <butil/file_util.h>
+#include <butil/files/file_path.h>
+#include <butil/strings/string_util.h>
+#include <hocon/config.hpp>
+#include <hocon/config_includer.hpp>
+#include <hocon/config_includer_file.hpp>
+#include <hocon/config_object.hpp>
+#include <hocon/config_parse_options.hpp>
+#include <hocon/config_syntax.hpp>
+#include <hocon/types.hpp>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+namespace pbconf {
+
+using string = std::string;
+
+namespace {
+
+// What tells a file changed. A missing file has size -1,
+// so that it is parsed again once it exists.
+struct FileKey {
+    int64_t size = -1;
+    int64_t mtime_ns = -1;
+
+    bool operator==(const FileKey& other) const {
+        return size == other.size && mtime_ns == other.mtime_ns;
+    }
+};
+
+FileKey StatFile(const string& path) {
+    FileKey key;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        key.size = st.st_size;
+        key.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+    return key;
+}
+
+string RealPath(const string& filename) {
+    butil::FilePath path = butil::MakeAbsoluteFilePath(butil::FilePath(filename));
+    return path.empty() ? filename : path.value();
+}
+
+}
+
+struct IncludeCache::Entry {
+    FileKey key;
+    hocon::shared_object root;
+    // The targets it includes, directly or not, as they were parsed.
+    std::vector<std::pair<string, FileKey>> includes;
+
+    bool Fresh(const FileKey& current) const {
+        if (!(key == current)) {
+            return false;
+        }
+        for (const auto& include : includes) {
+            if (!(StatFile(include.first) == include.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Resolves the includes of one file, the root conf file or a target.
+class IncludeCache::Includer final
+    : public hocon::config_includer,
+      public hocon::config_includer_file {
+public:
+    Includer(IncludeCache* cache, const string& filename,
+            std::vector<string> parents, std::vector<std::pair<string, FileKey>>* includes)
+        : _cache(cache),
+        _dirname(butil::FilePath(filename).DirName().value()),
+        _parents(std::move(parents)),
+        _includes(includes) {
+        _parents.push_back(filename);
+    }
+
+    hocon::shared_includer with_fallback(hocon::shared_includer fallback) const override {
+        std::shared_ptr<Includer> includer = std::make_shared<Includer>(*this);
+        includer->_fallback = fallback;
+        return includer;
+    }
+
+    hocon::shared_object include(
+            hocon::shared_include_context context, std::string what) const override {
+        if (!EndsWith(what, ".conf", true) && !EndsWith(what, ".json", true)) {
+            return _fallback ? _fallback->include(context, what)
+                : hocon::config::parse_string("", hocon::config_parse_options())->root();
+        }
+        return include_file(context, what);
+    }
+
+    hocon::shared_object include_file(
+            hocon::shared_include_context context, std::string what) const override {
+        butil::FilePath path(what);
+        if (!path.IsAbsolute()) {
+            path = butil::FilePath(_dirname).Append(what);
+        }
+        return _cache->Include(path.value(), *this);
+    }
+
+private:
+    friend class IncludeCache;
+
+    IncludeCache* _cache;
+    string _dirname;
+    // The files being parsed down to this one, to tell cycles.
+    std::vector<string> _parents;
+    // Where the targets included are recorded.
+    std::vector<std::pair<string, FileKey>>* _includes;
+    hocon::shared_includer _fallback;
+};
+
+IncludeCache::IncludeCache() : _parse_count(0) {}
+
+IncludeCache::~IncludeCache() {}
+
+size_t IncludeCache::ParseCount() const {
+    return _parse_count.load(std::memory_order_relaxed);
+}
+
+std::vector<string> IncludeCache::Includes(const string& filename) const {
+    std::vector<string> includes;
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    auto found = _roots.find(RealPath(filename));
+    if (found != _roots.end()) {
+        for (const auto& include : found->second->includes) {
+            includes.push_back(include.first);
+        }
+    }
+    std::sort(includes.begin(), includes.end());
+    includes.erase(std::unique(includes.begin(), includes.end()), includes.end());
+    return includes;
+}
+
+hocon::config_parse_options IncludeCache::Options(
+        const string& filename,
+        const hocon::config_parse_options& options) {
+    const string path = RealPath(filename);
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    std::unique_ptr<Entry>& root = _roots[path];
+    if (!root) {
+        root.reset(new Entry());
+    }
+    // Recorded again by the parse to come.
+    root->includes.clear();
+    return options.set_includer(std::make_shared<Includer>(
+                this, path, std::vector<string>(), &root->includes));
+}
+
+hocon::shared_object IncludeCache::Include(const string& target, const Includer& parent) {
+    // The same file under another name is the same target.
+    const string path = RealPath(target);
+    if (std::find(parent._parents.begin(), parent._parents.end(), path)
+            != parent._parents.end()) {
+        throw std::runtime_error("Include cycle at " + path);
+    }
+
+    // Held while parsing, includes of the target lock it again.
+    std::lock_guard<std::recursive_mutex> guard(_mutex);
+    const FileKey key = StatFile(path);
+    std::unique_ptr<Entry>& entry = _entries[path];
+    if (!entry || !entry->Fresh(key)) {
+        std::unique_ptr<Entry> parsed(new Entry());
+        parsed->key = key;
+        auto includer = std::make_shared<Includer>(
+                this, path, parent._parents, &parsed->includes);
+        const hocon::config_parse_options options = hocon::config_parse_options()
+            .set_syntax(EndsWith(path, ".json", true)
+                    ? hocon::config_syntax::JSON : hocon::config_syntax::CONF)
+            .set_allow_missing(true)
+            .set_includer(includer);
+        parsed->root = hocon::config::parse_file_any_syntax(path, options)->root();
+        ++_parse_count;
+        entry = std::move(parsed);
+    }
+
+    parent._includes->emplace_back(path, entry->key);
+    parent._includes->insert(parent._includes->end(),
+            entry->includes.begin(), entry->includes.end());
+    return entry->root;
+}
+
+}
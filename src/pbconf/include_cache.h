@@ -0,0 +1,76 @@
+#ifndef INCLUDE_CACHE_H
+#define INCLUDE_CACHE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hocon {
+class config_object;
+class config_parse_options;
+}
+
+namespace pbconf {
+
+// The include targets of hocon conf files, parsed once and shared by
+// all the conf files including them, e.g. the fragments of a conf.d
+// directory, see ConfOverlay::AddDirectory, and by later loads.
+//
+// A target, e.g. `include "common.conf"', resolves against the
+// directory of the file including it. It is parsed again only when
+// its size or mtime changed, or those of the targets it includes in
+// turn. Targets are parsed one at a time: conf files parsed
+// concurrently wait for a target another one is parsing instead of
+// parsing it again. An include cycle fails the load.
+// Targets without a .conf or .json extension, which hocon looks up
+// under several extensions, and url() or classpath() targets are
+// left to cpp-hocon, uncached.
+//
+// Thread-safe.
+class IncludeCache final {
+public:
+    IncludeCache();
+    ~IncludeCache();
+    IncludeCache(const IncludeCache&) = delete;
+    IncludeCache& operator=(const IncludeCache&) = delete;
+
+    // How many times a target was parsed rather than reused.
+    size_t ParseCount() const;
+
+    // The targets the conf file `filename' included, directly or not,
+    // the last time it was parsed through this cache, by real path and
+    // sorted, e.g. for PbConfWatcher to follow them. Targets left to
+    // cpp-hocon are not known.
+    std::vector<std::string> Includes(const std::string& filename) const;
+
+    // Used by the loaders.
+    // `options' resolving the includes of the hocon conf file
+    // `filename' through this cache.
+    hocon::config_parse_options Options(
+            const std::string& filename,
+            const hocon::config_parse_options& options);
+
+private:
+    struct Entry;
+    class Includer;
+
+    // The parsed target `path', included by the file of `parent'.
+    std::shared_ptr<const hocon::config_object> Include(
+            const std::string& path,
+            const Includer& parent);
+
+    mutable std::recursive_mutex _mutex;
+    // By real path.
+    std::unordered_map<std::string, std::unique_ptr<Entry>> _entries;
+    // The root conf files, by real path, with only what they included.
+    std::unordered_map<std::string, std::unique_ptr<Entry>> _roots;
+    std::atomic<size_t> _parse_count;
+};
+
+}
+
+#endif
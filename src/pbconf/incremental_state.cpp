@@ -0,0 +1,123 @@
+#include "incremental_state.h"
+
+#include <algorithm>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace pbconf {
+
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using Message = ::google::protobuf::Message;
+using Reflection = ::google::protobuf::Reflection;
+using string = std::string;
+
+// Whether the non-message field holds the same value in both messages,
+// at `index' for repeated fields.
+static bool SameValue(
+        const Message& lhs,
+        const Message& rhs,
+        const FieldDescriptor* field,
+        int index) {
+    const Reflection* l = lhs.GetReflection();
+    const Reflection* r = rhs.GetReflection();
+    const bool repeated = field->is_repeated();
+#define PBCONF_SAME_VALUE(TYPE) \
+    (repeated \
+        ? l->GetRepeated##TYPE(lhs, field, index) == r->GetRepeated##TYPE(rhs, field, index) \
+        : l->Get##TYPE(lhs, field) == r->Get##TYPE(rhs, field))
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+        return PBCONF_SAME_VALUE(Int32);
+    case FieldDescriptor::CPPTYPE_INT64:
+        return PBCONF_SAME_VALUE(Int64);
+    case FieldDescriptor::CPPTYPE_UINT32:
+        return PBCONF_SAME_VALUE(UInt32);
+    case FieldDescriptor::CPPTYPE_UINT64:
+        return PBCONF_SAME_VALUE(UInt64);
+    case FieldDescriptor::CPPTYPE_BOOL:
+        return PBCONF_SAME_VALUE(Bool);
+    case FieldDescriptor::CPPTYPE_FLOAT:
+        return PBCONF_SAME_VALUE(Float);
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+        return PBCONF_SAME_VALUE(Double);
+    case FieldDescriptor::CPPTYPE_ENUM:
+        return PBCONF_SAME_VALUE(EnumValue);
+    case FieldDescriptor::CPPTYPE_STRING:
+        return PBCONF_SAME_VALUE(String);
+    default:
+        return false;
+    }
+#undef PBCONF_SAME_VALUE
+}
+
+static void DiffFields(
+        const Message& previous,
+        const Message& current,
+        const string& prefix,
+        std::vector<string>* paths) {
+    const Reflection* reflection = current.GetReflection();
+    std::vector<const FieldDescriptor*> fields;
+    std::vector<const FieldDescriptor*> previous_fields;
+    reflection->ListFields(current, &fields);
+    previous.GetReflection()->ListFields(previous, &previous_fields);
+    // Both lists are ordered by field number.
+    std::vector<const FieldDescriptor*> all_fields;
+    std::set_union(fields.begin(), fields.end(),
+            previous_fields.begin(), previous_fields.end(),
+            std::back_inserter(all_fields),
+            [](const FieldDescriptor* lhs, const FieldDescriptor* rhs) {
+                return lhs->number() < rhs->number();
+            });
+
+    for (const FieldDescriptor* field : all_fields) {
+        const string path = FieldPath(prefix, field);
+        if (!field->is_repeated()) {
+            bool had = previous.GetReflection()->HasField(previous, field);
+            bool has = reflection->HasField(current, field);
+            if (had != has) {
+                paths->push_back(path);
+            } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+                DiffFields(previous.GetReflection()->GetMessage(previous, field),
+                        reflection->GetMessage(current, field), path + ".", paths);
+            } else if (!SameValue(previous, current, field, -1)) {
+                paths->push_back(path);
+            }
+            continue;
+        }
+
+        int previous_size = previous.GetReflection()->FieldSize(previous, field);
+        int size = reflection->FieldSize(current, field);
+        if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+            bool same = previous_size == size;
+            for (int i = 0; same && i < size; ++i) {
+                same = SameValue(previous, current, field, i);
+            }
+            if (!same) {
+                paths->push_back(path);
+            }
+            continue;
+        }
+        for (int i = 0; i < std::max(previous_size, size); ++i) {
+            const string element_path = path + "[" + std::to_string(i) + "]";
+            if (i >= previous_size || i >= size) {
+                paths->push_back(element_path);
+                continue;
+            }
+            DiffFields(previous.GetReflection()->GetRepeatedMessage(previous, field, i),
+                    reflection->GetRepeatedMessage(current, field, i),
+                    element_path + ".", paths);
+        }
+    }
+}
+
+void IncrementalState::Diff(
+        const Message& previous,
+        const Message& current,
+        std::vector<string>* paths) {
+    DiffFields(previous, current, string(), paths);
+}
+
+}
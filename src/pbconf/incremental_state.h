@@ -0,0 +1,102 @@
+#ifndef INCREMENTAL_STATE_H
+#define INCREMENTAL_STATE_H
+
+#include <google/protobuf/message.h>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "field_path.h"
+#include "message_allocator.h"
+
+namespace pbconf {
+
+// Hashes of the document subtrees a message was loaded from.
+// A message map keeps one hash per field of its load plan,
+// zero for absent fields. Message fields also keep the hashes
+// of their maps, one per element for repeated ones.
+struct SubtreeHash {
+    struct Field {
+        uint64_t hash = 0;
+        // Whether `elements' follows the field's messages one by one,
+        // which needs a single occurrence of the field in the map.
+        bool by_element = false;
+        std::vector<SubtreeHash> elements;
+    };
+
+    uint64_t hash = 0;
+    std::vector<Field> fields;
+};
+
+// What an incremental load keeps from one load to the next:
+// the loaded message and the subtree hashes of its document.
+// A reload then only converts the subtrees whose hash changed
+// and copies everything else from the previous message,
+// see YamlConf::Load and PbConf::Load.
+class IncrementalState final {
+public:
+    // Loads fill new messages of the prototype's type.
+    explicit IncrementalState(const ::google::protobuf::Message& prototype)
+        : _prototype(prototype.New()) {
+    }
+
+    // Take the messages loads fill from `allocator', e.g. to build them
+    // on arenas or to reuse released ones, instead of the heap.
+    // The allocator must outlive the state.
+    IncrementalState& SetAllocator(MessageAllocator* allocator) {
+        _allocator = allocator;
+        return *this;
+    }
+
+    // The message of the last successful load, nullptr before it.
+    // Each load publishes a new message, those returned before stay intact.
+    std::shared_ptr<const ::google::protobuf::Message> Current() const {
+        return _current;
+    }
+
+    // Paths of the fields the last successful load changed,
+    // e.g. `endpoints[3].port', or `endpoints[5]' for an added element.
+    // The first load reports every top-level field it set.
+    const std::vector<std::string>& ChangedPaths() const {
+        return _changed_paths;
+    }
+
+    // Forget the previous load, the next one converts everything.
+    void Reset() {
+        _current.reset();
+        _hashes.reset();
+        _changed_paths.clear();
+    }
+
+    // Fill `paths' with the paths of the fields that differ between
+    // `previous' and `current', which share their type.
+    // For formats loaded as a whole, see PbConf::Load.
+    static void Diff(
+            const ::google::protobuf::Message& previous,
+            const ::google::protobuf::Message& current,
+            std::vector<std::string>* paths);
+
+private:
+    friend class YamlConf;
+    friend class PbConf;
+
+    std::shared_ptr<::google::protobuf::Message> NewMessage() const {
+        if (_allocator) {
+            return _allocator->New();
+        }
+        return std::shared_ptr<::google::protobuf::Message>(_prototype->New());
+    }
+
+    std::unique_ptr<::google::protobuf::Message> _prototype;
+    std::shared_ptr<const ::google::protobuf::Message> _current;
+    // The hashes of _current's document, if it was loaded incrementally.
+    std::unique_ptr<SubtreeHash> _hashes;
+    bool _ignore_enum_case = false;
+    std::vector<std::string> _changed_paths;
+    MessageAllocator* _allocator = nullptr;
+};
+
+}
+
+#endif
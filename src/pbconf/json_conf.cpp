@@ -0,0 +1,710 @@
+#include "json_conf.h"
+
+#include <butil/file_util.h>
+#include <butil/files/file_path.h>
+#include <butil/strings/stringprintf.h>
+#include <google/protobuf/message.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "field_path.h"
+#include "generated_loader.h"
+#include "json_reader.h"
+#include "lazy_fields.h"
+#include "load_mask.h"
+#include "load_metrics.h"
+#include "load_plan.h"
+#include "map_field.h"
+#include "number_conv.h"
+#include "repeated_field.h"
+
+namespace pbconf {
+
+using EnumValueDescriptor = ::google::protobuf::EnumValueDescriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using Message = ::google::protobuf::Message;
+using Reflection = ::google::protobuf::Reflection;
+using string = std::string;
+
+using FieldPlan = ::pbconf::BasicFieldPlan<JsonReader&>;
+using LoadPlan = ::pbconf::BasicLoadPlan<JsonReader&>;
+
+// Converters are called with the reader positioned at the field value,
+// and consume exactly that value.
+
+// Where OnMap leaves the lazy fields of the root message.
+struct LazySink {
+    LazyFields* fields;
+    bool ignore_enum_case;
+    bool use_generated;
+    const string* filename;
+};
+
+static bool OnMap(
+        JsonReader& reader,
+        const LoadPlan& plan,
+        Message& msg,
+        string& err_msg,
+        const LazySink* lazy = nullptr,
+        const LoadMask* mask = nullptr);
+
+static bool ExpectValue(const FieldDescriptor* field, string& err_msg) {
+    butil::StringAppendF(&err_msg, "Expect %s value at:%s",
+            field->cpp_type_name(), field->full_name().c_str());
+    return false;
+}
+
+template <typename T>
+static inline bool get(JsonReader& reader, T& value) {
+    const char* data = nullptr;
+    size_t size = 0;
+    if (reader.Peek() != JsonReader::NUMBER || !reader.ReadNumber(data, size)) {
+        return false;
+    }
+    return ParseNumber(data, size, value);
+}
+
+template <>
+inline bool get<bool>(JsonReader& reader, bool& value) {
+    if (reader.Peek() != JsonReader::BOOLEAN) {
+        return false;
+    }
+    return reader.ReadBool(value);
+}
+
+template <>
+inline bool get<string>(JsonReader& reader, string& value) {
+    const char* data = nullptr;
+    size_t size = 0;
+    if (reader.Peek() != JsonReader::STRING || !reader.ReadString(data, size)) {
+        return false;
+    }
+    value.assign(data, size);
+    return true;
+}
+
+static inline void set(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        int32_t value) {
+    reflection->SetInt32(&msg, field, value);
+}
+
+static inline void set(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        int64_t value) {
+    reflection->SetInt64(&msg, field, value);
+}
+
+static inline void set(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        uint32_t value) {
+    reflection->SetUInt32(&msg, field, value);
+}
+
+static inline void set(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        uint64_t value) {
+    reflection->SetUInt64(&msg, field, value);
+}
+
+static inline void set(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        bool value) {
+    reflection->SetBool(&msg, field, value);
+}
+
+static inline void set(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        float value) {
+    reflection->SetFloat(&msg, field, value);
+}
+
+static inline void set(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        double value) {
+    reflection->SetDouble(&msg, field, value);
+}
+
+static inline void set(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        string&& value) {
+    reflection->SetString(&msg, field, std::move(value));
+}
+
+// Read the next element of a repeated field into it.
+template <typename T>
+static inline bool add(JsonReader& reader, typename RepeatedOf<T>::Type* values) {
+    T value{};
+    if (!get(reader, value)) {
+        return false;
+    }
+    values->Add(value);
+    return true;
+}
+
+// Strings go straight into the new element,
+// which reuses a cleared one if any.
+template <>
+inline bool add<string>(JsonReader& reader, RepeatedOf<string>::Type* values) {
+    if (!get(reader, *values->Add())) {
+        values->RemoveLast();
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+static bool OnNodeForSingle(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    T value{};
+    if (!get(reader, value)) {
+        return ExpectValue(plan.field, err_msg);
+    }
+    set(parent_msg.GetReflection(), parent_msg, plan.field, std::move(value));
+    return true;
+}
+
+template <typename T>
+static bool OnNodeForRepeated(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    if (!reader.StartArray()) {
+        butil::StringAppendF(&err_msg, "Expect array at:%s",
+                plan.field->full_name().c_str());
+        return false;
+    }
+
+    // The array length is only known at its end, and counting it
+    // first costs more than the regrowth, so nothing is reserved.
+    auto values = MutableRepeated<T>(parent_msg, plan.field);
+    bool end = false;
+    while (reader.NextElement(end) && !end) {
+        if (!add<T>(reader, values)) {
+            return ExpectValue(plan.field, err_msg);
+        }
+    }
+    return end;
+}
+
+// Begin enum
+enum DummyEnum {};
+
+// Names are matched straight on the document buffer.
+static const EnumValueDescriptor* GetEnum(
+        JsonReader& reader,
+        const EnumTable& table,
+        bool ignore_case) {
+    if (reader.Peek() == JsonReader::NUMBER) {
+        int32_t value{0};
+        if (!get(reader, value)) {
+            return nullptr;
+        }
+        return table.FindByNumber(value);
+    }
+
+    const char* data = nullptr;
+    size_t size = 0;
+    if (!reader.ReadString(data, size)) {
+        return nullptr;
+    }
+    return table.FindByName(data, size, ignore_case);
+}
+
+static inline const EnumValueDescriptor* GetEnum(
+        JsonReader& reader,
+        const FieldPlan& plan) {
+    return GetEnum(reader, *plan.enum_table, plan.ignore_enum_case);
+}
+
+template <>
+inline bool OnNodeForSingle<enum DummyEnum>(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    const EnumValueDescriptor* enumd = GetEnum(reader, plan);
+    if (!enumd) {
+        return ExpectValue(plan.field, err_msg);
+    }
+    parent_msg.GetReflection()->SetEnum(&parent_msg, plan.field, enumd);
+    return true;
+}
+
+template <>
+inline bool OnNodeForRepeated<enum DummyEnum>(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    if (!reader.StartArray()) {
+        butil::StringAppendF(&err_msg, "Expect array at:%s",
+                plan.field->full_name().c_str());
+        return false;
+    }
+
+    const Reflection* reflection = parent_msg.GetReflection();
+    bool end = false;
+    while (reader.NextElement(end) && !end) {
+        const EnumValueDescriptor* enumd = GetEnum(reader, plan);
+        if (!enumd) {
+            return ExpectValue(plan.field, err_msg);
+        }
+        reflection->AddEnum(&parent_msg, plan.field, enumd);
+    }
+    return end;
+}
+// End enum
+
+// Begin message
+class DummyClass {};
+
+template <>
+inline bool OnNodeForSingle<DummyClass>(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    const Reflection* reflection = parent_msg.GetReflection();
+
+    Message& child_msg = *(reflection->MutableMessage(&parent_msg, plan.field));
+    return OnMap(reader, *plan.message_plan, child_msg, err_msg);
+}
+
+template <>
+inline bool OnNodeForRepeated<DummyClass>(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    if (!reader.StartArray()) {
+        butil::StringAppendF(&err_msg, "Expect array at:%s",
+                plan.field->full_name().c_str());
+        return false;
+    }
+
+    const Reflection* reflection = parent_msg.GetReflection();
+    bool end = false;
+    while (reader.NextElement(end) && !end) {
+        Message& child_msg = *(reflection->AddMessage(&parent_msg, plan.field));
+        if (!OnMap(reader, *plan.message_plan, child_msg, err_msg)) {
+            return false;
+        }
+    }
+    return end;
+}
+
+// Convert the message field of `plan', only the fields in `mask'.
+static bool OnMaskedMessage(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        const LoadMask& mask,
+        Message& parent_msg,
+        string& err_msg) {
+    const Reflection* reflection = parent_msg.GetReflection();
+    if (!plan.field->is_repeated()) {
+        Message& child_msg = *(reflection->MutableMessage(&parent_msg, plan.field));
+        return OnMap(reader, *plan.message_plan, child_msg, err_msg, nullptr, &mask);
+    }
+
+    if (!reader.StartArray()) {
+        butil::StringAppendF(&err_msg, "Expect array at:%s",
+                plan.field->full_name().c_str());
+        return false;
+    }
+    bool end = false;
+    while (reader.NextElement(end) && !end) {
+        Message& child_msg = *(reflection->AddMessage(&parent_msg, plan.field));
+        if (!OnMap(reader, *plan.message_plan, child_msg, err_msg, nullptr, &mask)) {
+            return false;
+        }
+    }
+    return end;
+}
+
+// Skip a value outside the mask. Objects and arrays are only
+// checked for their nesting, their strings are not even decoded.
+static bool SkipMasked(JsonReader& reader) {
+    const JsonReader::Type type = reader.Peek();
+    if (type != JsonReader::OBJECT && type != JsonReader::ARRAY) {
+        return reader.Skip();
+    }
+    const char* data = nullptr;
+    size_t size = 0;
+    return reader.SkipRaw(data, size);
+}
+// End message
+
+// Begin map
+// An object fills a map field with one entry per member,
+// an array is taken as the list of its entries.
+static bool OnNodeForMap(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    if (reader.Peek() == JsonReader::ARRAY) {
+        return OnNodeForRepeated<DummyClass>(reader, plan, parent_msg, err_msg);
+    }
+    if (!reader.StartObject()) {
+        butil::StringAppendF(&err_msg, "Expect an object for:%s",
+                plan.field->full_name().c_str());
+        return false;
+    }
+
+    const FieldPlan& value_plan = plan.message_plan->fields[kMapValuePos];
+    const Reflection* reflection = parent_msg.GetReflection();
+    const char* key = nullptr;
+    size_t key_size = 0;
+    bool end = false;
+    while (reader.NextMember(key, key_size, end) && !end) {
+        Message& entry_msg = *(reflection->AddMessage(&parent_msg, plan.field));
+        if (!SetMapKey(entry_msg, key, key_size, err_msg)) {
+            return false;
+        }
+        // A null value leaves the default one.
+        if (reader.Peek() == JsonReader::NUL) {
+            if (!reader.ReadNull()) {
+                return false;
+            }
+            continue;
+        }
+        if (!value_plan.convert || !value_plan.convert(reader, value_plan, entry_msg, err_msg)) {
+            return false;
+        }
+    }
+    return end;
+}
+// End map
+
+static bool Defer(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        const LazySink& lazy,
+        string& err_msg);
+
+static bool OnMap(
+        JsonReader& reader,
+        const LoadPlan& plan,
+        Message& msg,
+        string& err_msg,
+        const LazySink* lazy,
+        const LoadMask* mask) {
+    if (!reader.StartObject()) {
+        butil::StringAppendF(&err_msg, "Expect an object for:%s",
+                plan.descriptor->full_name().c_str());
+        return false;
+    }
+
+    // Convert each member in document order,
+    // remembering which fields were present.
+    PresenceBitmap present(plan.fields.size());
+    const char* key = nullptr;
+    size_t key_size = 0;
+    bool end = false;
+    while (reader.NextMember(key, key_size, end) && !end) {
+        int pos = plan.index.Find(key, key_size);
+        if (pos < 0) {
+            // Not in the schema.
+            if (!reader.Skip()) {
+                return false;
+            }
+            continue;
+        }
+        if (mask && !mask->Contains(pos)) {
+            if (!SkipMasked(reader)) {
+                return false;
+            }
+            continue;
+        }
+
+        // A null value counts as absent.
+        if (reader.Peek() == JsonReader::NUL) {
+            if (!reader.ReadNull()) {
+                return false;
+            }
+            continue;
+        }
+
+        const FieldPlan& field_plan = plan.fields[pos];
+        const LoadMask* child_mask = mask ? mask->Child(pos) : nullptr;
+        if (lazy && lazy->fields->IsLazy(field_plan.field)) {
+            if (!Defer(reader, field_plan, *lazy, err_msg)) {
+                return false;
+            }
+        } else if (child_mask) {
+            if (!OnMaskedMessage(reader, field_plan, *child_mask, msg, err_msg)) {
+                return false;
+            }
+        } else if (!field_plan.convert
+                || !field_plan.convert(reader, field_plan, msg, err_msg)) {
+            return false;
+        }
+        present.Set(pos);
+    }
+    if (!end) {
+        return false;
+    }
+
+    // Missing the required field
+    for (auto pos : mask ? mask->Required() : plan.required) {
+        if (!present.Test(pos)) {
+            butil::StringAppendF(&err_msg, "Field is required:%s",
+                    plan.fields[pos].field->full_name().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static FieldPlan::Converter ConverterFor(const FieldDescriptor* field) {
+    if (field->is_repeated()) {
+        return &OnNodeForRepeated<T>;
+    } else {
+        return &OnNodeForSingle<T>;
+    }
+}
+
+// Resolve the converter of field once, when its LoadPlan is built.
+static FieldPlan::Converter ResolveConverter(const FieldDescriptor* field) {
+    if (field->is_map()) {
+        return &OnNodeForMap;
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT32) {
+        return ConverterFor<int32_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
+        return ConverterFor<int64_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT32) {
+        return ConverterFor<uint32_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT64) {
+        return ConverterFor<uint64_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
+        return ConverterFor<bool>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT) {
+        return ConverterFor<float>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE) {
+        return ConverterFor<double>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+        return ConverterFor<enum DummyEnum>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+        return ConverterFor<string>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+        return ConverterFor<DummyClass>(field);
+    }
+
+    return nullptr;
+}
+
+static LoadPlanRegistry<JsonReader&>& PlanRegistry(bool ignore_enum_case) {
+    static LoadPlanRegistry<JsonReader&> registry(ResolveConverter);
+    static LoadPlanRegistry<JsonReader&> ignore_case_registry(ResolveConverter, true);
+    return ignore_enum_case ? ignore_case_registry : registry;
+}
+
+namespace generated {
+
+bool Get(JsonReader& reader, int32_t& value) {
+    return get(reader, value);
+}
+
+bool Get(JsonReader& reader, int64_t& value) {
+    return get(reader, value);
+}
+
+bool Get(JsonReader& reader, uint32_t& value) {
+    return get(reader, value);
+}
+
+bool Get(JsonReader& reader, uint64_t& value) {
+    return get(reader, value);
+}
+
+bool Get(JsonReader& reader, bool& value) {
+    return get(reader, value);
+}
+
+bool Get(JsonReader& reader, float& value) {
+    return get(reader, value);
+}
+
+bool Get(JsonReader& reader, double& value) {
+    return get(reader, value);
+}
+
+bool Get(JsonReader& reader, string& value) {
+    return get(reader, value);
+}
+
+const EnumValueDescriptor* GetEnum(
+        JsonReader& reader, const EnumTable& table, bool ignore_case) {
+    return ::pbconf::GetEnum(reader, table, ignore_case);
+}
+
+bool LoadMessage(
+        JsonReader& reader,
+        Message& msg,
+        bool ignore_enum_case,
+        string& err_msg) {
+    const GeneratedLoader* loader = FindGeneratedLoader(msg);
+    if (loader) {
+        return loader->load_json(reader, msg, ignore_enum_case, err_msg);
+    }
+    const LoadPlan& plan =
+        PlanRegistry(ignore_enum_case).Get(msg.GetDescriptor());
+    return OnMap(reader, plan, msg, err_msg);
+}
+
+bool LoadField(
+        JsonReader& reader,
+        Message& msg,
+        int number,
+        bool ignore_enum_case,
+        string& err_msg) {
+    const LoadPlan& plan =
+        PlanRegistry(ignore_enum_case).Get(msg.GetDescriptor());
+    for (const FieldPlan& field_plan : plan.fields) {
+        if (field_plan.field->number() == number) {
+            return field_plan.convert && field_plan.convert(reader, field_plan, msg, err_msg);
+        }
+    }
+    return false;
+}
+
+}
+
+bool JsonConf::Load(const string& filename, Message& msg, string& err_msg) {
+    const bool ok = LoadFile(filename, msg, err_msg);
+    if (_metrics) {
+        _metrics->RecordResult(LoadMetrics::JSON, ok, msg);
+    }
+    return ok;
+}
+
+// Load the json document in `content', decoded in place, into msg.
+// `source' names the document in errors.
+static bool LoadContent(
+        string& content,
+        const string& source,
+        Message& msg,
+        bool ignore_enum_case,
+        bool use_generated,
+        const LazySink* lazy,
+        const LoadMask* mask,
+        string& err_msg) {
+    // The reader decodes strings in place, inside `content'.
+    JsonReader reader(&content[0], &content[0] + content.size());
+    const size_t err_size = err_msg.size();
+    bool ok = false;
+    if (use_generated && !lazy && !mask) {
+        ok = generated::LoadMessage(reader, msg, ignore_enum_case, err_msg);
+    } else {
+        const LoadPlan& plan =
+            PlanRegistry(ignore_enum_case).Get(msg.GetDescriptor());
+        ok = OnMap(reader, plan, msg, err_msg, lazy, mask);
+    }
+    if (!ok) {
+        if (err_msg.size() == err_size) {
+            err_msg.append("Invalid json");
+        }
+        butil::StringAppendF(&err_msg, " at %s of %s",
+                reader.Position().c_str(), source.c_str());
+        return false;
+    }
+    if (!reader.AtEnd()) {
+        butil::StringAppendF(&err_msg, "Unexpected content at %s of %s",
+                reader.Position().c_str(), source.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Loads a lazy field from its json text on first access.
+struct DeferredJson {
+    string content;
+    string source;
+    bool ignore_enum_case;
+    bool use_generated;
+
+    bool operator()(Message& msg, string& err_msg) {
+        return LoadContent(content, source, msg,
+                ignore_enum_case, use_generated, nullptr, nullptr, err_msg);
+    }
+};
+
+static bool Defer(
+        JsonReader& reader,
+        const FieldPlan& plan,
+        const LazySink& lazy,
+        string& err_msg) {
+    DeferredJson deferred;
+    const char* data = nullptr;
+    size_t size = 0;
+    if (!reader.SkipRaw(data, size)) {
+        butil::StringAppendF(&err_msg, "Expect an object for:%s",
+                plan.field->full_name().c_str());
+        return false;
+    }
+    deferred.content.assign(data, size);
+    deferred.source = "lazy field `" + FieldPath(string(), plan.field)
+        + "' of " + *lazy.filename;
+    deferred.ignore_enum_case = lazy.ignore_enum_case;
+    deferred.use_generated = lazy.use_generated;
+    lazy.fields->Defer(plan.field, std::move(deferred));
+    return true;
+}
+
+bool JsonConf::LoadFile(const string& filename, Message& msg, string& err_msg) {
+    string content;
+    {
+        ScopedPhase read(_metrics, LoadMetrics::JSON, LoadMetrics::READ);
+        if (!butil::ReadFileToString(butil::FilePath(filename), &content)) {
+            butil::StringAppendF(&err_msg, "Fail to read file:%s", filename.c_str());
+            return false;
+        }
+    }
+    if (_metrics) {
+        _metrics->RecordBytesRead(LoadMetrics::JSON, content.size());
+    }
+    if (_lazy && !_lazy->Reset(msg, err_msg)) {
+        return false;
+    }
+
+    // Parsed while converting.
+    ScopedPhase convert(_metrics, LoadMetrics::JSON, LoadMetrics::CONVERT);
+    LazySink lazy{_lazy, _ignore_enum_case, _use_generated, &filename};
+    return LoadContent(content, filename, msg, _ignore_enum_case, _use_generated,
+            _lazy ? &lazy : nullptr, _mask, err_msg);
+}
+
+}
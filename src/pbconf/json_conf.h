@@ -1,11 +1,79 @@
 #ifndef JSON_CONF_H
 #define JSON_CONF_H
 
-#include "hocon_conf.h"
+#include <google/protobuf/message.h>
+#include <string>
 
 namespace pbconf {
 
-using JsonConf = HoconConf;
+class LazyFields;
+class LoadMask;
+class LoadMetrics;
+
+class JsonConf final {
+public:
+    // Match enum names ignoring ASCII case, e.g. `red' for `RED'.
+    // Names that only differ by case still need the exact spelling.
+    JsonConf& SetIgnoreEnumCase(bool ignore_enum_case) {
+        _ignore_enum_case = ignore_enum_case;
+        return *this;
+    }
+
+    // Load through the loader generated by protoc-gen-pbconf
+    // when one is linked in for the message type, which is the default.
+    // Otherwise, or when disabled, the message is loaded through Reflection.
+    JsonConf& SetUseGenerated(bool use_generated) {
+        _use_generated = use_generated;
+        return *this;
+    }
+
+    // Leave the lazy fields of the root message to `lazy', to be
+    // converted on first access, see LazyFields. The root message is
+    // then loaded through Reflection; lazy fields follow the options
+    // above when converted.
+    // `lazy' must outlive the loads.
+    JsonConf& SetLazyFields(LazyFields* lazy) {
+        _lazy = lazy;
+        return *this;
+    }
+
+    // Only convert the fields in `mask', skipping the others undecoded,
+    // see LoadMask. The message is then loaded through Reflection; lazy
+    // fields in the mask are converted whole when accessed.
+    // `mask' must outlive the loads.
+    JsonConf& SetLoadMask(const LoadMask* mask) {
+        _mask = mask;
+        return *this;
+    }
+
+    // Record the phases, size and result of each load
+    // into `metrics', see LoadMetrics. The metrics must outlive the loads.
+    JsonConf& SetMetrics(LoadMetrics* metrics) {
+        _metrics = metrics;
+        return *this;
+    }
+
+    // Treat the specified file named `filename'
+    // as a json-formatted conf file.
+    // Load the conf info into msg.
+    // Returns True if success; otherwise False.
+    bool Load(
+            const std::string& filename,
+            ::google::protobuf::Message& msg,
+            std::string& err_msg);
+
+private:
+    bool LoadFile(
+            const std::string& filename,
+            ::google::protobuf::Message& msg,
+            std::string& err_msg);
+
+    bool _ignore_enum_case = false;
+    bool _use_generated = true;
+    LazyFields* _lazy = nullptr;
+    const LoadMask* _mask = nullptr;
+    LoadMetrics* _metrics = nullptr;
+};
 
 }
 
@@ -0,0 +1,450 @@
+#include "json_reader.h"
+
+#include <butil/strings/stringprintf.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace pbconf {
+
+void JsonReader::SkipSpace() {
+    // Raw newlines may only appear here, never inside strings,
+    // so lines are counted as they are skipped.
+    while (_cur < _end
+            && (*_cur == ' ' || *_cur == '\n' || *_cur == '\r' || *_cur == '\t')) {
+        if (*_cur == '\n') {
+            ++_line;
+            _line_start = _cur + 1;
+        }
+        ++_cur;
+    }
+}
+
+bool JsonReader::Fail() {
+    if (!_error) {
+        _error = _cur;
+        _error_line = _line;
+        _error_line_start = _line_start;
+    }
+    return false;
+}
+
+JsonReader::Type JsonReader::Peek() {
+    SkipSpace();
+    if (_cur == _end) {
+        return INVALID;
+    }
+    switch (*_cur) {
+    case '{':
+        return OBJECT;
+    case '[':
+        return ARRAY;
+    case '"':
+        return STRING;
+    case 't':
+    case 'f':
+        return BOOLEAN;
+    case 'n':
+        return NUL;
+    case '-':
+        return NUMBER;
+    default:
+        return (*_cur >= '0' && *_cur <= '9') ? NUMBER : INVALID;
+    }
+}
+
+bool JsonReader::StartObject() {
+    if (Peek() != OBJECT) {
+        return Fail();
+    }
+    ++_cur;
+    _first = true;
+    return true;
+}
+
+bool JsonReader::NextMember(const char*& key, size_t& key_size, bool& end) {
+    SkipSpace();
+    if (_cur < _end && *_cur == '}') {
+        ++_cur;
+        _first = false;
+        end = true;
+        return true;
+    }
+    if (!_first) {
+        if (_cur == _end || *_cur != ',') {
+            return Fail();
+        }
+        ++_cur;
+    }
+    _first = false;
+    end = false;
+
+    if (Peek() != STRING || !ReadString(key, key_size)) {
+        return Fail();
+    }
+    SkipSpace();
+    if (_cur == _end || *_cur != ':') {
+        return Fail();
+    }
+    ++_cur;
+    return true;
+}
+
+bool JsonReader::StartArray() {
+    if (Peek() != ARRAY) {
+        return Fail();
+    }
+    ++_cur;
+    _first = true;
+    return true;
+}
+
+bool JsonReader::NextElement(bool& end) {
+    SkipSpace();
+    if (_cur < _end && *_cur == ']') {
+        ++_cur;
+        _first = false;
+        end = true;
+        return true;
+    }
+    if (!_first) {
+        if (_cur == _end || *_cur != ',') {
+            return Fail();
+        }
+        ++_cur;
+    }
+    _first = false;
+    end = false;
+    return true;
+}
+
+bool JsonReader::ReadHex4(unsigned& code) {
+    if (_end - _cur < 4) {
+        return Fail();
+    }
+    code = 0;
+    for (int i = 0; i < 4; ++i, ++_cur) {
+        char c = *_cur;
+        code <<= 4;
+        if (c >= '0' && c <= '9') {
+            code |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            code |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            code |= c - 'A' + 10;
+        } else {
+            return Fail();
+        }
+    }
+    return true;
+}
+
+bool JsonReader::ReadString(const char*& data, size_t& size) {
+    if (Peek() != STRING) {
+        return Fail();
+    }
+    ++_cur;
+
+    // Decoded text is never longer than its escaped form,
+    // so it is written back over the literal itself.
+    char* out = _cur;
+    data = out;
+    while (_cur < _end) {
+        char c = *_cur++;
+        if (c == '"') {
+            size = out - data;
+            return true;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            --_cur;
+            return Fail();
+        }
+        if (c != '\\') {
+            *out++ = c;
+            continue;
+        }
+
+        if (_cur == _end) {
+            return Fail();
+        }
+        switch (*_cur++) {
+        case '"':  *out++ = '"'; break;
+        case '\\': *out++ = '\\'; break;
+        case '/':  *out++ = '/'; break;
+        case 'b':  *out++ = '\b'; break;
+        case 'f':  *out++ = '\f'; break;
+        case 'n':  *out++ = '\n'; break;
+        case 'r':  *out++ = '\r'; break;
+        case 't':  *out++ = '\t'; break;
+        case 'u': {
+            unsigned code = 0;
+            if (!ReadHex4(code)) {
+                return false;
+            }
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                // A surrogate pair.
+                unsigned low = 0;
+                if (_end - _cur < 2 || _cur[0] != '\\' || _cur[1] != 'u') {
+                    return Fail();
+                }
+                _cur += 2;
+                if (!ReadHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                    return Fail();
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            if (code < 0x80) {
+                *out++ = static_cast<char>(code);
+            } else if (code < 0x800) {
+                *out++ = static_cast<char>(0xC0 | (code >> 6));
+                *out++ = static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                *out++ = static_cast<char>(0xE0 | (code >> 12));
+                *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                *out++ = static_cast<char>(0xF0 | (code >> 18));
+                *out++ = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (code & 0x3F));
+            }
+            break;
+        }
+        default:
+            --_cur;
+            return Fail();
+        }
+    }
+    return Fail();
+}
+
+bool JsonReader::ReadNumber(const char*& data, size_t& size) {
+    if (Peek() != NUMBER) {
+        return Fail();
+    }
+
+    char* start = _cur;
+    auto is_digit = [this]() {
+        return _cur < _end && *_cur >= '0' && *_cur <= '9';
+    };
+    if (*_cur == '-') {
+        ++_cur;
+    }
+    if (!is_digit()) {
+        return Fail();
+    }
+    if (*_cur == '0') {
+        ++_cur;
+    } else {
+        while (is_digit()) {
+            ++_cur;
+        }
+    }
+    if (_cur < _end && *_cur == '.') {
+        ++_cur;
+        if (!is_digit()) {
+            return Fail();
+        }
+        while (is_digit()) {
+            ++_cur;
+        }
+    }
+    if (_cur < _end && (*_cur == 'e' || *_cur == 'E')) {
+        ++_cur;
+        if (_cur < _end && (*_cur == '+' || *_cur == '-')) {
+            ++_cur;
+        }
+        if (!is_digit()) {
+            return Fail();
+        }
+        while (is_digit()) {
+            ++_cur;
+        }
+    }
+
+    data = start;
+    size = _cur - start;
+    return true;
+}
+
+bool JsonReader::ReadBool(bool& value) {
+    if (Peek() != BOOLEAN) {
+        return Fail();
+    }
+    if (_end - _cur >= 4 && memcmp(_cur, "true", 4) == 0) {
+        _cur += 4;
+        value = true;
+        return true;
+    }
+    if (_end - _cur >= 5 && memcmp(_cur, "false", 5) == 0) {
+        _cur += 5;
+        value = false;
+        return true;
+    }
+    return Fail();
+}
+
+bool JsonReader::ReadNull() {
+    if (Peek() != NUL) {
+        return Fail();
+    }
+    if (_end - _cur >= 4 && memcmp(_cur, "null", 4) == 0) {
+        _cur += 4;
+        return true;
+    }
+    return Fail();
+}
+
+bool JsonReader::Skip() {
+    // Iterative, so that deeply nested values cannot exhaust the stack.
+    // `containers' holds '}' or ']' of every open container.
+    std::vector<char> containers;
+    const char* data = nullptr;
+    size_t size = 0;
+    bool end = false;
+    bool flag = false;
+
+    do {
+        if (!containers.empty()) {
+            bool ok = containers.back() == '}'
+                ? NextMember(data, size, end)
+                : NextElement(end);
+            if (!ok) {
+                return false;
+            }
+            if (end) {
+                containers.pop_back();
+                continue;
+            }
+        }
+
+        switch (Peek()) {
+        case OBJECT:
+            if (!StartObject()) {
+                return false;
+            }
+            containers.push_back('}');
+            break;
+        case ARRAY:
+            if (!StartArray()) {
+                return false;
+            }
+            containers.push_back(']');
+            break;
+        case STRING:
+            if (!ReadString(data, size)) {
+                return false;
+            }
+            break;
+        case NUMBER:
+            if (!ReadNumber(data, size)) {
+                return false;
+            }
+            break;
+        case BOOLEAN:
+            if (!ReadBool(flag)) {
+                return false;
+            }
+            break;
+        case NUL:
+            if (!ReadNull()) {
+                return false;
+            }
+            break;
+        default:
+            return Fail();
+        }
+    } while (!containers.empty());
+    return true;
+}
+
+// What SkipRaw stops at, all other bytes are skipped in a tight loop.
+enum RawClass : unsigned char {
+    RAW_PLAIN,
+    RAW_QUOTE,
+    RAW_OPEN,
+    RAW_CLOSE,
+    RAW_NEWLINE
+};
+
+struct RawClasses {
+    unsigned char of[256];
+
+    RawClasses() {
+        memset(of, RAW_PLAIN, sizeof(of));
+        of['"'] = RAW_QUOTE;
+        of['{'] = RAW_OPEN;
+        of['['] = RAW_OPEN;
+        of['}'] = RAW_CLOSE;
+        of[']'] = RAW_CLOSE;
+        of['\n'] = RAW_NEWLINE;
+    }
+};
+
+bool JsonReader::SkipRaw(const char*& data, size_t& size) {
+    const Type type = Peek();
+    if (type != OBJECT && type != ARRAY) {
+        return Fail();
+    }
+
+    static const RawClasses classes;
+    const unsigned char* class_of = classes.of;
+    data = _cur;
+    int depth = 0;
+    while (_cur < _end) {
+        while (_cur < _end && class_of[static_cast<unsigned char>(*_cur)] == RAW_PLAIN) {
+            ++_cur;
+        }
+        if (_cur == _end) {
+            break;
+        }
+
+        switch (class_of[static_cast<unsigned char>(*_cur++)]) {
+        case RAW_QUOTE:
+            // To the closing quote, over escaped characters.
+            while (_cur < _end && *_cur != '"') {
+                if (*_cur == '\\' && ++_cur == _end) {
+                    break;
+                }
+                ++_cur;
+            }
+            if (_cur == _end) {
+                return Fail();
+            }
+            ++_cur;
+            break;
+        case RAW_OPEN:
+            ++depth;
+            break;
+        case RAW_CLOSE:
+            if (--depth == 0) {
+                size = _cur - data;
+                return true;
+            }
+            break;
+        case RAW_NEWLINE:
+            ++_line;
+            _line_start = _cur;
+            break;
+        default:
+            break;
+        }
+    }
+    return Fail();
+}
+
+bool JsonReader::AtEnd() {
+    SkipSpace();
+    return _cur == _end;
+}
+
+std::string JsonReader::Position() const {
+    if (_error) {
+        return butil::StringPrintf("line %d, column %d",
+                _error_line, static_cast<int>(_error - _error_line_start) + 1);
+    }
+    return butil::StringPrintf("line %d, column %d",
+            _line, static_cast<int>(_cur - _line_start) + 1);
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <cstddef>
+#include <string>
+
+namespace pbconf {
+
+// A pull-style JSON tokenizer working in place on a mutable buffer.
+// It builds no tree: callers walk the document value by value and
+// string escapes are decoded into the buffer itself, so a string
+// value is just a (data, size) view of the buffer.
+// The buffer must be followed by a '\0', as std::string guarantees.
+class JsonReader final {
+public:
+    enum Type {
+        OBJECT,
+        ARRAY,
+        STRING,
+        NUMBER,
+        BOOLEAN,
+        NUL,
+        INVALID
+    };
+
+    JsonReader(char* begin, char* end)
+        : _cur(begin), _end(end), _line_start(begin) {}
+
+    // The type of the next value, after skipping whitespace.
+    Type Peek();
+
+    // Consume '{'. Then call NextMember until `end' is set,
+    // reading or skipping the member value after each key.
+    bool StartObject();
+    bool NextMember(const char*& key, size_t& key_size, bool& end);
+
+    // Consume '['. Then call NextElement until `end' is set,
+    // reading or skipping one element after each call.
+    bool StartArray();
+    bool NextElement(bool& end);
+
+    // Read a string value, decoded in place.
+    bool ReadString(const char*& data, size_t& size);
+    // Read the literal of a number value, checked against the json grammar.
+    bool ReadNumber(const char*& data, size_t& size);
+    bool ReadBool(bool& value);
+    bool ReadNull();
+
+    // Skip the next value, whatever it is.
+    bool Skip();
+
+    // Skip the next object or array, leaving its strings undecoded,
+    // into a view of its literal in the buffer. Only the nesting is
+    // checked, the literal is left for another reader to read.
+    bool SkipRaw(const char*& data, size_t& size);
+
+    // Returns True if only whitespace is left.
+    bool AtEnd();
+
+    // Describe the position of the first error, e.g. "line 3, column 7".
+    std::string Position() const;
+
+private:
+    void SkipSpace();
+    bool Fail();
+    bool ReadHex4(unsigned& code);
+
+    char* _cur;
+    char* _end;
+    int _line = 1;
+    const char* _line_start;
+    // Where the first error happened.
+    const char* _error = nullptr;
+    int _error_line = 0;
+    const char* _error_line_start = nullptr;
+    // Members or elements read in the innermost container,
+    // used to expect ',' before all but the first one.
+    bool _first = false;
+};
+
+}
+
+#endif
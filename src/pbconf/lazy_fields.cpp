@@ -0,0 +1,105 @@
+#include "lazy_fields.h"
+
+#include <algorithm>
+#include <butil/strings/stringprintf.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/message.h>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "field_path.h"
+#include "load_plan.h"
+
+namespace pbconf {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using Message = ::google::protobuf::Message;
+using string = std::string;
+
+// The `lazy' option of options.proto, if linked in.
+static const FieldDescriptor* LazyOption(const Descriptor* descriptor) {
+    const FieldDescriptor* option =
+        descriptor->file()->pool()->FindExtensionByName("pbconf.lazy");
+    if (!option || option->cpp_type() != FieldDescriptor::CPPTYPE_BOOL
+            || option->containing_type()->full_name() != "google.protobuf.FieldOptions") {
+        return nullptr;
+    }
+    return option;
+}
+
+bool LazyFields::Reset(const Message& root, string& err_msg) {
+    _fields.clear();
+    _sections.clear();
+
+    const Descriptor* descriptor = root.GetDescriptor();
+    const FieldDescriptor* option = LazyOption(descriptor);
+    std::vector<const FieldDescriptor*> fields;
+    CollectFields(descriptor, fields);
+    for (auto field : fields) {
+        const string name = FieldPath(string(), field);
+        const auto& options = field->options();
+        if (std::find(_names.begin(), _names.end(), name) == _names.end()
+                && !(option && options.GetReflection()->GetBool(options, option))) {
+            continue;
+        }
+        if (field->is_repeated() || field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+            butil::StringAppendF(&err_msg, "Not a singular message field to load lazily:%s",
+                    field->full_name().c_str());
+            return false;
+        }
+
+        Section* section = new Section();
+        // Unset, so the default instance of the field type.
+        section->prototype = &root.GetReflection()->GetMessage(root, field);
+        _sections[name].reset(section);
+        _fields.emplace_back(field, section);
+    }
+
+    for (const auto& name : _names) {
+        if (_sections.find(name) == _sections.end()) {
+            butil::StringAppendF(&err_msg, "Unknown lazy field `%s' of %s",
+                    name.c_str(), descriptor->full_name().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+void LazyFields::Defer(const FieldDescriptor* field, Converter convert) {
+    for (auto& lazy : _fields) {
+        if (lazy.first == field) {
+            lazy.second->convert = std::move(convert);
+            return;
+        }
+    }
+}
+
+const Message* LazyFields::Get(const string& name, string& err_msg) {
+    auto found = _sections.find(name);
+    if (found == _sections.end()) {
+        butil::StringAppendF(&err_msg, "Not a lazy field:%s", name.c_str());
+        return nullptr;
+    }
+
+    Section& section = *found->second;
+    std::call_once(section.once, [&section]() {
+        section.msg.reset(section.prototype->New());
+        if (section.convert && !section.convert(*section.msg, section.err_msg)) {
+            section.msg.reset();
+        }
+        // The source is not needed anymore.
+        section.convert = nullptr;
+    });
+    if (!section.msg) {
+        butil::StringAppendF(&err_msg, "Fail to load lazy field `%s':%s",
+                name.c_str(), section.err_msg.c_str());
+        return nullptr;
+    }
+    return section.msg.get();
+}
+
+}
@@ -0,0 +1,98 @@
+#ifndef LAZY_FIELDS_H
+#define LAZY_FIELDS_H
+
+#include <functional>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pbconf {
+
+// Sections of a conf converted on first access instead of at load,
+// e.g. large tables most processes never read.
+//
+// Fields of the root message marked `[(pbconf.lazy) = true]', see
+// pbconf/options.proto, or added by AddField, are left unset by loads
+// given this LazyFields. The loader keeps their source instead, in a
+// compact form: the text of the section for json and yaml files, the
+// parsed value for hocon files. Get converts a section on first access
+// and frees its source. Only singular message fields of the root
+// message can be lazy. A section is only checked when converted, so
+// a load succeeds despite errors in its lazy sections.
+//
+// One LazyFields holds the sections of one loaded conf. Loading again
+// drops them, with the messages Get returned; load a replacing conf
+// into a new LazyFields while the current one is read.
+class LazyFields final {
+public:
+    typedef std::function<bool(::google::protobuf::Message& msg, std::string& err_msg)>
+        Converter;
+
+    LazyFields() = default;
+    LazyFields(const LazyFields&) = delete;
+    LazyFields& operator=(const LazyFields&) = delete;
+
+    // Also load the root message field `name' lazily, e.g. `partners',
+    // or `(full.name)' for an extension.
+    LazyFields& AddField(const std::string& name) {
+        _names.push_back(name);
+        return *this;
+    }
+
+    // The lazy field `name' of the loaded conf, converted on first
+    // access, or an empty message if the conf does not set it.
+    // Thread-safe.
+    // Returns nullptr if `name' is not lazy or failed to convert,
+    // with err_msg filled; later calls fail the same way.
+    const ::google::protobuf::Message* Get(const std::string& name, std::string& err_msg);
+
+    // Same as above, T being the message type of the field.
+    template <typename T>
+    const T* Get(const std::string& name, std::string& err_msg) {
+        return static_cast<const T*>(Get(name, err_msg));
+    }
+
+    // Used by the loaders.
+    // Start loading a conf into `root', dropping the sections held.
+    // Returns True if success; otherwise False, with err_msg filled
+    // when a lazy field is unknown or not a singular message field.
+    bool Reset(const ::google::protobuf::Message& root, std::string& err_msg);
+
+    // Whether the root message field `field' is lazy.
+    bool IsLazy(const ::google::protobuf::FieldDescriptor* field) const {
+        for (const auto& lazy : _fields) {
+            if (lazy.first == field) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Convert the lazy field `field' through `convert' on first access.
+    void Defer(const ::google::protobuf::FieldDescriptor* field, Converter convert);
+
+private:
+    struct Section {
+        const ::google::protobuf::Message* prototype = nullptr;
+        // Null once called, or if the conf does not set the field.
+        Converter convert;
+        std::once_flag once;
+        std::unique_ptr<::google::protobuf::Message> msg;
+        std::string err_msg;
+    };
+
+    std::vector<std::string> _names;
+    // The lazy fields of the current root message type.
+    std::vector<std::pair<const ::google::protobuf::FieldDescriptor*, Section*>> _fields;
+    // By field path, see FieldPath.
+    std::unordered_map<std::string, std::unique_ptr<Section>> _sections;
+};
+
+}
+
+#endif
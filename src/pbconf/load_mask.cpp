@@ -0,0 +1,74 @@
+#include "load_mask.h"
+
+#include <algorithm>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/field_mask.pb.h>
+#include <string>
+#include <vector>
+
+#include "field_path.h"
+#include "load_plan.h"
+
+namespace pbconf {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using FieldMask = ::google::protobuf::FieldMask;
+using string = std::string;
+
+bool LoadMask::Build(const Descriptor* descriptor, const FieldMask& mask, string& err_msg) {
+    Reset(descriptor);
+    std::vector<const FieldDescriptor*> path;
+    for (const auto& field_path : mask.paths()) {
+        path.clear();
+        if (!ResolveFieldPath(descriptor, field_path, &path, err_msg)) {
+            return false;
+        }
+        Add(path, 0);
+    }
+    CollectRequired();
+    return true;
+}
+
+void LoadMask::Reset(const Descriptor* descriptor) {
+    _fields.clear();
+    CollectFields(descriptor, _fields);
+    _masked.assign(_fields.size(), false);
+    _children.clear();
+    _children.resize(_fields.size());
+    _required.clear();
+}
+
+void LoadMask::Add(const std::vector<const FieldDescriptor*>& path, size_t depth) {
+    const size_t pos = std::find(_fields.begin(), _fields.end(), path[depth]) - _fields.begin();
+    // Entries of a map field are not masked one by one.
+    if (depth + 1 == path.size() || path[depth]->is_map()) {
+        // The whole field, whatever was masked under it.
+        _masked[pos] = true;
+        _children[pos].reset();
+        return;
+    }
+    if (_masked[pos] && !_children[pos]) {
+        // Already masked whole.
+        return;
+    }
+    if (!_children[pos]) {
+        _masked[pos] = true;
+        _children[pos].reset(new LoadMask());
+        _children[pos]->Reset(path[depth]->message_type());
+    }
+    _children[pos]->Add(path, depth + 1);
+}
+
+void LoadMask::CollectRequired() {
+    for (size_t pos = 0; pos < _fields.size(); ++pos) {
+        if (_masked[pos] && _fields[pos]->is_required()) {
+            _required.push_back(pos);
+        }
+        if (_children[pos]) {
+            _children[pos]->CollectRequired();
+        }
+    }
+}
+
+}
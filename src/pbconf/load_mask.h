@@ -0,0 +1,70 @@
+#ifndef LOAD_MASK_H
+#define LOAD_MASK_H
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/field_mask.pb.h>
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace pbconf {
+
+// The fields a partial load converts, built from a FieldMask.
+// Each path of the mask, e.g. `server.port' or `routes.weight',
+// is a field path, see FieldPath, and covers the whole field it ends
+// at; a path through a repeated message field covers all elements,
+// and a path into a map field the whole map.
+// Fields outside the mask are skipped without being converted, and
+// only the required fields inside the mask are checked. A message
+// field the mask covers whole is loaded as usual, required fields
+// included.
+//
+// A mask is one node per message type it goes into, holding the
+// fields by their position in the load plans, see CollectFields.
+class LoadMask final {
+public:
+    LoadMask() = default;
+    LoadMask(const LoadMask&) = delete;
+    LoadMask& operator=(const LoadMask&) = delete;
+
+    // Build the mask of `mask' over the message type `descriptor',
+    // dropping what it held. An empty mask converts no field.
+    // Returns True if success; otherwise False, with err_msg filled
+    // when a path does not resolve.
+    bool Build(
+            const ::google::protobuf::Descriptor* descriptor,
+            const ::google::protobuf::FieldMask& mask,
+            std::string& err_msg);
+
+    // Whether the field at `pos' of the load plan is converted.
+    bool Contains(size_t pos) const {
+        return pos < _masked.size() && _masked[pos];
+    }
+
+    // The mask of the message field at `pos',
+    // nullptr if the field is converted whole or not at all.
+    const LoadMask* Child(size_t pos) const {
+        return pos < _children.size() ? _children[pos].get() : nullptr;
+    }
+
+    // Positions of the required fields the mask contains,
+    // the only ones checked.
+    const std::vector<size_t>& Required() const {
+        return _required;
+    }
+
+private:
+    void Reset(const ::google::protobuf::Descriptor* descriptor);
+    void Add(const std::vector<const ::google::protobuf::FieldDescriptor*>& path, size_t depth);
+    void CollectRequired();
+
+    std::vector<const ::google::protobuf::FieldDescriptor*> _fields;
+    std::vector<bool> _masked;
+    std::vector<std::unique_ptr<LoadMask>> _children;
+    std::vector<size_t> _required;
+};
+
+}
+
+#endif
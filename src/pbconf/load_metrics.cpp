@@ -0,0 +1,87 @@
+#include "load_metrics.h"
+
+#include <butil/time.h>
+#include <google/protobuf/message.h>
+#include <string>
+#include <vector>
+
+namespace pbconf {
+
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using Message = ::google::protobuf::Message;
+using Reflection = ::google::protobuf::Reflection;
+using string = std::string;
+
+static const char* const kFormatNames[LoadMetrics::FORMAT_COUNT] = {
+    "yaml", "json", "hocon"
+};
+
+static const char* const kPhaseNames[LoadMetrics::PHASE_COUNT] = {
+    "read", "parse", "convert"
+};
+
+// The fields set in msg and its sub-messages,
+// each element of a repeated field counting as one.
+static int64_t CountFields(const Message& msg) {
+    const Reflection* reflection = msg.GetReflection();
+    std::vector<const FieldDescriptor*> fields;
+    reflection->ListFields(msg, &fields);
+    int64_t count = 0;
+    for (const FieldDescriptor* field : fields) {
+        if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+            count += field->is_repeated() ? reflection->FieldSize(msg, field) : 1;
+            continue;
+        }
+        if (!field->is_repeated()) {
+            count += 1 + CountFields(reflection->GetMessage(msg, field));
+            continue;
+        }
+        const int size = reflection->FieldSize(msg, field);
+        for (int i = 0; i < size; ++i) {
+            count += 1 + CountFields(reflection->GetRepeatedMessage(msg, field, i));
+        }
+    }
+    return count;
+}
+
+LoadMetrics::LoadMetrics(const string& prefix)
+    : _published_us(-1),
+    _snapshot_age_s(prefix, "snapshot_age_s", SnapshotAge, this) {
+    _load.expose(prefix, "load");
+    for (int format = 0; format < FORMAT_COUNT; ++format) {
+        const string name = kFormatNames[format];
+        for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+            _phases[format][phase].expose(prefix, name + "_" + kPhaseNames[phase]);
+        }
+        _fields_set[format].expose_as(prefix, name + "_fields_set");
+        _bytes_read[format].expose_as(prefix, name + "_bytes_read");
+        _errors[format].expose_as(prefix, name + "_errors");
+    }
+}
+
+void LoadMetrics::RecordResult(Format format, bool ok, const Message& msg) {
+    if (ok) {
+        _fields_set[format] << CountFields(msg);
+    } else {
+        _errors[format] << 1;
+    }
+}
+
+void LoadMetrics::RecordPublish() {
+    _published_us.store(NowUs(), std::memory_order_relaxed);
+}
+
+int64_t LoadMetrics::NowUs() {
+    return butil::monotonic_time_us();
+}
+
+int64_t LoadMetrics::SnapshotAge(void* metrics) {
+    const int64_t published_us =
+        static_cast<LoadMetrics*>(metrics)->_published_us.load(std::memory_order_relaxed);
+    if (published_us < 0) {
+        return -1;
+    }
+    return (NowUs() - published_us) / 1000000;
+}
+
+}
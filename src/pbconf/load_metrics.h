@@ -0,0 +1,119 @@
+#ifndef LOAD_METRICS_H
+#define LOAD_METRICS_H
+
+#include <atomic>
+#include <bvar/latency_recorder.h>
+#include <bvar/passive_status.h>
+#include <bvar/reducer.h>
+#include <google/protobuf/message.h>
+#include <stdint.h>
+#include <string>
+
+namespace pbconf {
+
+// Bvars of the loads of a conf, shown by /vars of the brpc server.
+// Loads only record them when given a LoadMetrics, e.g. through
+// PbConf::SetMetrics; otherwise metrics cost a null pointer check.
+//
+// With `prefix' e.g. "app_conf", exposes:
+//   app_conf_load_latency...        each PbConf::Load, any format
+//   app_conf_<format>_<phase>_latency...
+//   app_conf_<format>_fields_set    fields in the loaded messages,
+//                                   counted after each load
+//   app_conf_<format>_bytes_read
+//   app_conf_<format>_errors        failed loads
+//   app_conf_snapshot_age_s         since the last successful
+//                                   PbConf::Load, -1 before it
+// where <format> is yaml, json or hocon, and <phase> is one of
+//   read     reading the conf file, when done apart from parsing
+//   parse    parsing it into a document tree, reading included
+//            for hocon files
+//   convert  filling the message, parsing included for json files
+//            and yaml streaming, which parse while converting
+// Names already exposed, e.g. by another LoadMetrics with the same
+// prefix, are not exposed again.
+class LoadMetrics final {
+public:
+    enum Format {
+        YAML,
+        JSON,
+        HOCON,
+        FORMAT_COUNT
+    };
+
+    enum Phase {
+        READ,
+        PARSE,
+        CONVERT,
+        PHASE_COUNT
+    };
+
+    explicit LoadMetrics(const std::string& prefix);
+
+    LoadMetrics(const LoadMetrics&) = delete;
+    LoadMetrics& operator=(const LoadMetrics&) = delete;
+
+    // All of the following are thread-safe.
+    void RecordPhase(Format format, Phase phase, int64_t elapsed_us) {
+        _phases[format][phase] << elapsed_us;
+    }
+
+    void RecordBytesRead(Format format, int64_t bytes) {
+        _bytes_read[format] << bytes;
+    }
+
+    // The end of a load by a format: counts the fields of msg if `ok',
+    // otherwise an error.
+    void RecordResult(Format format, bool ok, const ::google::protobuf::Message& msg);
+
+    // A load of the current conf by PbConf::Load.
+    void RecordLoad(int64_t elapsed_us) {
+        _load << elapsed_us;
+    }
+
+    // The current conf was just replaced by a freshly loaded one.
+    void RecordPublish();
+
+    // Monotonic time in microseconds.
+    static int64_t NowUs();
+
+private:
+    static int64_t SnapshotAge(void* metrics);
+
+    bvar::LatencyRecorder _load;
+    bvar::LatencyRecorder _phases[FORMAT_COUNT][PHASE_COUNT];
+    bvar::Adder<int64_t> _fields_set[FORMAT_COUNT];
+    bvar::Adder<int64_t> _bytes_read[FORMAT_COUNT];
+    bvar::Adder<int64_t> _errors[FORMAT_COUNT];
+
+    // NowUs of the last RecordPublish, -1 before any.
+    std::atomic<int64_t> _published_us;
+    bvar::PassiveStatus<int64_t> _snapshot_age_s;
+};
+
+// Times a phase into `metrics', if not null, when it goes out of scope.
+class ScopedPhase final {
+public:
+    ScopedPhase(LoadMetrics* metrics, LoadMetrics::Format format, LoadMetrics::Phase phase)
+        : _metrics(metrics), _format(format), _phase(phase),
+        _start_us(metrics ? LoadMetrics::NowUs() : 0) {}
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    ~ScopedPhase() {
+        if (_metrics) {
+            _metrics->RecordPhase(_format, _phase, LoadMetrics::NowUs() - _start_us);
+        }
+    }
+
+private:
+    LoadMetrics* _metrics;
+    LoadMetrics::Format _format;
+    LoadMetrics::Phase _phase;
+    int64_t _start_us;
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "load_plan.h"
+
+#include <algorithm>
+#include <cstring>
+#include <google/protobuf/descriptor.h>
+#include <string>
+#include <vector>
+
+namespace pbconf {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+
+void CollectFields(
+        const Descriptor* descriptor,
+        std::vector<const FieldDescriptor*>& fields) {
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+        fields.push_back(descriptor->field(i));
+    }
+
+    // Ask the pool for the registered extensions only,
+    // instead of probing every number of the extension ranges,
+    // which may span up to 2^29 numbers(`extensions 1000 to max').
+    std::vector<const FieldDescriptor*> extensions;
+    descriptor->file()->pool()->FindAllExtensions(descriptor, &extensions);
+    std::sort(extensions.begin(), extensions.end(),
+            [](const FieldDescriptor* lhs, const FieldDescriptor* rhs) {
+                return lhs->number() < rhs->number();
+            });
+    fields.insert(fields.end(), extensions.begin(), extensions.end());
+}
+
+static inline size_t HashName(const char* name, size_t size) {
+    // FNV-1a
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void FieldIndex::Build(const std::vector<const FieldDescriptor*>& fields) {
+    size_t capacity = 8;
+    while (capacity < fields.size() * 2) {
+        capacity <<= 1;
+    }
+    _mask = capacity - 1;
+    _slots.assign(capacity, -1);
+    _names.clear();
+
+    for (auto field : fields) {
+        const std::string& name = field->name();
+        // The first field wins if an extension shadows a name.
+        if (Find(name) >= 0) {
+            _names.push_back(&name);
+            continue;
+        }
+        size_t slot = HashName(name.data(), name.size()) & _mask;
+        while (_slots[slot] >= 0) {
+            slot = (slot + 1) & _mask;
+        }
+        _slots[slot] = static_cast<int>(_names.size());
+        _names.push_back(&name);
+    }
+}
+
+int FieldIndex::Find(const char* name, size_t size) const {
+    if (_slots.empty()) {
+        return -1;
+    }
+    size_t slot = HashName(name, size) & _mask;
+    while (_slots[slot] >= 0) {
+        const std::string& candidate = *_names[_slots[slot]];
+        if (candidate.size() == size
+                && memcmp(candidate.data(), name, size) == 0) {
+            return _slots[slot];
+        }
+        slot = (slot + 1) & _mask;
+    }
+    return -1;
+}
+
+}
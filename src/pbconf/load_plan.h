@@ -0,0 +1,186 @@
+#ifndef LOAD_PLAN_H
+#define LOAD_PLAN_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "enum_table.h"
+
+namespace pbconf {
+
+// Collect all field descriptors of the message type `descriptor',
+// including the normal and extended fields, in load order.
+void CollectFields(
+        const ::google::protobuf::Descriptor* descriptor,
+        std::vector<const ::google::protobuf::FieldDescriptor*>& fields);
+
+// Maps field names to their position in a load plan.
+// Lookups by (data, size) allocate nothing,
+// so a key can be resolved straight from the document buffer.
+class FieldIndex final {
+public:
+    void Build(
+            const std::vector<const ::google::protobuf::FieldDescriptor*>& fields);
+
+    // Returns the position of the field named `name', or -1 if unknown.
+    int Find(const char* name, size_t size) const;
+    int Find(const std::string& name) const {
+        return Find(name.data(), name.size());
+    }
+
+private:
+    std::vector<const std::string*> _names;
+    // Open addressing table of positions in _names, -1 for empty slots.
+    std::vector<int> _slots;
+    size_t _mask = 0;
+};
+
+// Which fields of a plan are present in a document map.
+// Usual messages keep the bits on the stack.
+class PresenceBitmap final {
+public:
+    explicit PresenceBitmap(size_t size) : _bits(_inline) {
+        size_t words = (size + 63) / 64;
+        if (words > kInlineWords) {
+            _heap.reset(new uint64_t[words]);
+            _bits = _heap.get();
+        }
+        memset(_bits, 0, std::max(words, kInlineWords) * sizeof(uint64_t));
+    }
+
+    void Set(size_t pos) {
+        _bits[pos / 64] |= uint64_t(1) << (pos % 64);
+    }
+
+    bool Test(size_t pos) const {
+        return (_bits[pos / 64] >> (pos % 64)) & 1;
+    }
+
+private:
+    static const size_t kInlineWords = 4;
+    uint64_t _inline[kInlineWords];
+    std::unique_ptr<uint64_t[]> _heap;
+    uint64_t* _bits;
+};
+
+template <typename NodeRef>
+struct BasicLoadPlan;
+
+// How one field of a message type is loaded.
+// `NodeRef' is the way a format passes its document node around,
+// e.g. `const YAML::Node&' or `hocon::shared_value'.
+template <typename NodeRef>
+struct BasicFieldPlan {
+    typedef bool (*Converter)(
+            NodeRef node,
+            const BasicFieldPlan& plan,
+            ::google::protobuf::Message& parent_msg,
+            std::string& err_msg);
+
+    const ::google::protobuf::FieldDescriptor* field;
+    bool required;
+    // Converts a document node into this field,
+    // resolved once from the field's cpp_type and label.
+    Converter convert;
+    // Plan of the sub-message type for message fields, nullptr otherwise.
+    const BasicLoadPlan<NodeRef>* message_plan;
+    // Lookup tables of the enum type for enum fields, nullptr otherwise.
+    const EnumTable* enum_table;
+    // Whether enum names are matched ignoring ASCII case.
+    bool ignore_enum_case;
+};
+
+// The precomputed load plan of one message type.
+// A plan is immutable once published by LoadPlanRegistry.
+template <typename NodeRef>
+struct BasicLoadPlan {
+    const ::google::protobuf::Descriptor* descriptor;
+    std::vector<BasicFieldPlan<NodeRef>> fields;
+    // Name to position in `fields'.
+    FieldIndex index;
+    // Positions of the required fields in `fields'.
+    std::vector<size_t> required;
+};
+
+// Thread-safe registry of load plans keyed by Descriptor.
+// Plans of sub-message types are built together with their parent,
+// so a load only consults the registry once for its root message.
+template <typename NodeRef>
+class LoadPlanRegistry final {
+public:
+    typedef typename BasicFieldPlan<NodeRef>::Converter Converter;
+    typedef Converter (*Resolver)(const ::google::protobuf::FieldDescriptor*);
+
+    // Plans of a registry built with `ignore_enum_case'
+    // match enum names ignoring ASCII case.
+    explicit LoadPlanRegistry(Resolver resolver, bool ignore_enum_case = false)
+        : _resolver(resolver), _ignore_enum_case(ignore_enum_case) {}
+
+    // Returns the plan of `descriptor', building it on first use.
+    // The returned plan lives as long as the registry.
+    const BasicLoadPlan<NodeRef>& Get(
+            const ::google::protobuf::Descriptor* descriptor) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return GetLocked(descriptor);
+    }
+
+private:
+    const BasicLoadPlan<NodeRef>& GetLocked(
+            const ::google::protobuf::Descriptor* descriptor) {
+        auto found = _plans.find(descriptor);
+        if (found != _plans.end()) {
+            return *found->second;
+        }
+
+        // Publish the plan before filling it,
+        // so that recursive message types resolve to it.
+        BasicLoadPlan<NodeRef>* plan = new BasicLoadPlan<NodeRef>();
+        _plans[descriptor].reset(plan);
+        plan->descriptor = descriptor;
+
+        std::vector<const ::google::protobuf::FieldDescriptor*> fields;
+        CollectFields(descriptor, fields);
+        plan->fields.reserve(fields.size());
+        for (auto field : fields) {
+            BasicFieldPlan<NodeRef> field_plan;
+            field_plan.field = field;
+            field_plan.required = field->is_required();
+            field_plan.convert = _resolver(field);
+            field_plan.message_plan = nullptr;
+            field_plan.enum_table = nullptr;
+            field_plan.ignore_enum_case = _ignore_enum_case;
+            if (field->cpp_type() ==
+                    ::google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+                field_plan.message_plan = &GetLocked(field->message_type());
+            }
+            if (field->cpp_type() ==
+                    ::google::protobuf::FieldDescriptor::CPPTYPE_ENUM) {
+                field_plan.enum_table = &EnumTable::Get(field->enum_type());
+            }
+            if (field_plan.required) {
+                plan->required.push_back(plan->fields.size());
+            }
+            plan->fields.push_back(field_plan);
+        }
+        plan->index.Build(fields);
+        return *plan;
+    }
+
+    Resolver _resolver;
+    bool _ignore_enum_case;
+    std::mutex _mutex;
+    std::unordered_map<const ::google::protobuf::Descriptor*,
+        std::unique_ptr<BasicLoadPlan<NodeRef>>> _plans;
+};
+
+}
+
+#endif
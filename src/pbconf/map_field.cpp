@@ -0,0 +1,75 @@
+#include "map_field.h"
+
+#include <butil/strings/stringprintf.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <string>
+#include <utility>
+
+namespace pbconf {
+
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using Message = ::google::protobuf::Message;
+using Reflection = ::google::protobuf::Reflection;
+using string = std::string;
+
+bool SetMapKey(Message& entry, const char* data, size_t size, string& err_msg) {
+    const FieldDescriptor* field = entry.GetDescriptor()->map_key();
+    const Reflection* reflection = entry.GetReflection();
+    bool ok = false;
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32: {
+        int32_t value{0};
+        ok = ParseMapKey(data, size, value);
+        if (ok) {
+            reflection->SetInt32(&entry, field, value);
+        }
+        break;
+    }
+    case FieldDescriptor::CPPTYPE_INT64: {
+        int64_t value{0};
+        ok = ParseMapKey(data, size, value);
+        if (ok) {
+            reflection->SetInt64(&entry, field, value);
+        }
+        break;
+    }
+    case FieldDescriptor::CPPTYPE_UINT32: {
+        uint32_t value{0};
+        ok = ParseMapKey(data, size, value);
+        if (ok) {
+            reflection->SetUInt32(&entry, field, value);
+        }
+        break;
+    }
+    case FieldDescriptor::CPPTYPE_UINT64: {
+        uint64_t value{0};
+        ok = ParseMapKey(data, size, value);
+        if (ok) {
+            reflection->SetUInt64(&entry, field, value);
+        }
+        break;
+    }
+    case FieldDescriptor::CPPTYPE_BOOL: {
+        bool value{false};
+        ok = ParseMapKey(data, size, value);
+        if (ok) {
+            reflection->SetBool(&entry, field, value);
+        }
+        break;
+    }
+    case FieldDescriptor::CPPTYPE_STRING:
+        reflection->SetString(&entry, field, string(data, size));
+        ok = true;
+        break;
+    default:
+        break;
+    }
+    if (!ok) {
+        butil::StringAppendF(&err_msg, "Expect %s value at:%s",
+                field->cpp_type_name(), field->full_name().c_str());
+    }
+    return ok;
+}
+
+}
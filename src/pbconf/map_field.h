@@ -0,0 +1,74 @@
+#ifndef MAP_FIELD_H
+#define MAP_FIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <string>
+
+#include "number_conv.h"
+
+namespace pbconf {
+
+// Map fields are written as maps in conf files, e.g.
+// `backends: {a: {...}, b: {...}}' for `map<string, Backend> backends',
+// and still as the list of their entries, `[{key: a, value: {...}}]',
+// which is how protobuf describes them.
+//
+// Reflection has no public access to the maps themselves, so the
+// reflection loaders add one entry per key to the repeated field that
+// protobuf keeps a map in until it is accessed, with room reserved for
+// all keys at once. Generated loaders insert into the Map<K, V> itself.
+
+// Position of the value in the load plan of a map entry,
+// which declares its key and then its value, see CollectFields.
+static const size_t kMapValuePos = 1;
+
+// Parse the text of a map key, the same in all formats: JSON and HOCON
+// keys are strings. Integer keys are decimal, bool keys `true' or `false'.
+inline bool ParseMapKey(const char* data, size_t size, int32_t& value) {
+    return ParseNumber(data, size, value);
+}
+
+inline bool ParseMapKey(const char* data, size_t size, int64_t& value) {
+    return ParseNumber(data, size, value);
+}
+
+inline bool ParseMapKey(const char* data, size_t size, uint32_t& value) {
+    return ParseNumber(data, size, value);
+}
+
+inline bool ParseMapKey(const char* data, size_t size, uint64_t& value) {
+    return ParseNumber(data, size, value);
+}
+
+inline bool ParseMapKey(const char* data, size_t size, bool& value) {
+    if (size == 4 && memcmp(data, "true", 4) == 0) {
+        value = true;
+        return true;
+    }
+    if (size == 5 && memcmp(data, "false", 5) == 0) {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+inline bool ParseMapKey(const char* data, size_t size, std::string& value) {
+    value.assign(data, size);
+    return true;
+}
+
+// Set the key of the map entry `entry' from the text [data, data + size).
+// Returns True if success; otherwise False, with err_msg filled.
+bool SetMapKey(
+        ::google::protobuf::Message& entry,
+        const char* data,
+        size_t size,
+        std::string& err_msg);
+
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "message_allocator.h"
+
+#include <google/protobuf/arena.h>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+namespace pbconf {
+
+using Arena = ::google::protobuf::Arena;
+using Message = ::google::protobuf::Message;
+
+// The conf replaced by each reload, and a spare.
+static const size_t kMaxFree = 2;
+
+// Arenas smaller than this keep the default block sizes.
+static const size_t kMinArenaSizeHint = 8192;
+
+struct MessageAllocator::FreeList {
+    std::mutex mutex;
+    // The allocator is gone, released messages are freed.
+    bool closed = false;
+    // Each with the arena it lives on, null for the heap.
+    std::vector<std::pair<Message*, std::shared_ptr<Arena>>> messages;
+
+    // Heap messages are deleted, arena ones go with their arena.
+    void Clear() {
+        for (auto& free : messages) {
+            if (!free.second) {
+                delete free.first;
+            }
+        }
+        messages.clear();
+    }
+};
+
+// The deleter of the messages handed out with reuse. It runs once the
+// last holder released the message, after all of their accesses, and
+// hands the message over under the mutex of the free list, which New
+// takes before clearing it.
+struct MessageAllocator::Recycle {
+    std::shared_ptr<FreeList> free_list;
+    std::shared_ptr<Arena> arena;
+
+    void operator()(Message* msg) const {
+        {
+            std::lock_guard<std::mutex> guard(free_list->mutex);
+            if (!free_list->closed && free_list->messages.size() < kMaxFree) {
+                free_list->messages.emplace_back(msg, arena);
+                return;
+            }
+        }
+        // An arena message goes with the arena, once the last of its
+        // messages and deleters releases it.
+        if (!arena) {
+            delete msg;
+        }
+    }
+};
+
+MessageAllocator::MessageAllocator(const Message& prototype)
+    : _prototype(&prototype), _free_list(std::make_shared<FreeList>()) {}
+
+MessageAllocator::~MessageAllocator() {
+    std::lock_guard<std::mutex> guard(_free_list->mutex);
+    _free_list->closed = true;
+    _free_list->Clear();
+}
+
+std::shared_ptr<Message> MessageAllocator::New() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (!_reuse) {
+        if (!_arena) {
+            return std::shared_ptr<Message>(_prototype->New());
+        }
+        std::shared_ptr<Arena> arena = NewArena();
+        // The message shares the ownership of its arena.
+        return std::shared_ptr<Message>(arena, _prototype->New(arena.get()));
+    }
+
+    Message* msg = nullptr;
+    std::shared_ptr<Arena> arena;
+    {
+        std::lock_guard<std::mutex> free_guard(_free_list->mutex);
+        if (!_free_list->messages.empty()) {
+            msg = _free_list->messages.back().first;
+            arena = std::move(_free_list->messages.back().second);
+            _free_list->messages.pop_back();
+        }
+    }
+    if (msg) {
+        msg->Clear();
+    } else if (_arena) {
+        arena = NewArena();
+        msg = _prototype->New(arena.get());
+    } else {
+        msg = _prototype->New();
+    }
+    return std::shared_ptr<Message>(msg, Recycle{_free_list, std::move(arena)});
+}
+
+std::shared_ptr<Arena> MessageAllocator::NewArena() {
+    // Size the first block after the last load, as long as its message
+    // is around to tell. SpaceUsed leaves out the destructors an arena
+    // keeps for strings and the like, so go by what it allocated.
+    std::shared_ptr<Arena> last = _last_arena.lock();
+    if (last) {
+        _arena_size_hint = last->SpaceAllocated();
+    }
+
+    ::google::protobuf::ArenaOptions options;
+    if (_arena_size_hint >= kMinArenaSizeHint) {
+        options.start_block_size = _arena_size_hint;
+    }
+    std::shared_ptr<Arena> arena(new Arena(options));
+    _last_arena = arena;
+    return arena;
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef MESSAGE_ALLOCATOR_H
+#define MESSAGE_ALLOCATOR_H
+
+#include <google/protobuf/arena.h>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+
+namespace pbconf {
+
+// Hands out the messages a conf is loaded into, again and again,
+// without churning the heap allocator on every reload.
+//
+// With arenas, each message is built on an arena of its own, whose
+// first block is sized after the arena of the previous message.
+// A load then mostly takes one large block instead of an allocation
+// per sub-message, string and repeated field, and freeing the message
+// returns its blocks at once. The first block does not shrink while
+// the conf does, a conf that got much smaller keeps larger blocks.
+//
+// With reuse, a message released by all its holders goes back on a
+// free list, to be cleared and handed out again. Clearing keeps the
+// capacity of its repeated fields, strings and sub-messages for the
+// next load. Reused arena messages stay on their arena. Messages may
+// outlive the allocator, they are freed when released then.
+class MessageAllocator final {
+public:
+    explicit MessageAllocator(const ::google::protobuf::Message& prototype);
+    ~MessageAllocator();
+
+    MessageAllocator(const MessageAllocator&) = delete;
+    MessageAllocator& operator=(const MessageAllocator&) = delete;
+
+    MessageAllocator& SetArena(bool arena) {
+        _arena = arena;
+        return *this;
+    }
+
+    MessageAllocator& SetReuse(bool reuse) {
+        _reuse = reuse;
+        return *this;
+    }
+
+    // An empty message of the prototype's type. Thread-safe.
+    std::shared_ptr<::google::protobuf::Message> New();
+
+    // The first block size of the next arena, 0 before any.
+    size_t ArenaSizeHint() const {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return _arena_size_hint;
+    }
+
+private:
+    // Released messages, shared with the deleters of the messages
+    // handed out, which put them back on it.
+    struct FreeList;
+    struct Recycle;
+
+    std::shared_ptr<::google::protobuf::Arena> NewArena();
+
+    const ::google::protobuf::Message* _prototype;
+    bool _arena = false;
+    bool _reuse = false;
+
+    mutable std::mutex _mutex;
+    size_t _arena_size_hint = 0;
+    // The arena of the last message handed out.
+    std::weak_ptr<::google::protobuf::Arena> _last_arena;
+    std::shared_ptr<FreeList> _free_list;
+};
+
+}
+
+#endif
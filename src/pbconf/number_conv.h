@@ -0,0 +1,280 @@
+#ifndef NUMBER_CONV_H
+#define NUMBER_CONV_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale.h>
+#include <stdlib.h>
+#include <string>
+#include <type_traits>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+namespace pbconf {
+
+// Numeric conversions shared by the conf formats.
+// None of them throws, out of range values are rejected, and only
+// float literals longer than 63 characters need an allocation.
+
+// Convert the integer `from' into T if it fits.
+template <typename T, typename V>
+inline typename std::enable_if<std::is_integral<T>::value
+        && std::is_integral<V>::value, bool>::type
+CastNumber(V from, T& value) {
+    if (std::is_signed<V>::value && from < 0) {
+        if (std::is_unsigned<T>::value
+                || static_cast<int64_t>(from)
+                    < static_cast<int64_t>(std::numeric_limits<T>::min())) {
+            return false;
+        }
+    } else if (static_cast<uint64_t>(from)
+            > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+        return false;
+    }
+    value = static_cast<T>(from);
+    return true;
+}
+
+// Convert the number `from' into the floating point T if it fits.
+template <typename T, typename V>
+inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+CastNumber(V from, T& value) {
+    if (std::is_floating_point<V>::value
+            && (from > std::numeric_limits<T>::max()
+                || from < -std::numeric_limits<T>::max())) {
+        return false;
+    }
+    value = static_cast<T>(from);
+    return true;
+}
+
+// Parse the decimal integer literal [data, data + size) as T.
+// Fractions and exponents are rejected, like boost::lexical_cast does.
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, bool>::type
+ParseNumber(const char* data, size_t size, T& value) {
+    const char* end = data + size;
+    bool negative = false;
+    if (data < end && *data == '-') {
+        if (std::is_unsigned<T>::value) {
+            return false;
+        }
+        negative = true;
+        ++data;
+    } else if (data < end && *data == '+') {
+        ++data;
+    }
+    if (data == end) {
+        return false;
+    }
+
+    // Accumulate towards the sign, so that the minimum value fits.
+    T result = 0;
+    for (; data < end; ++data) {
+        if (*data < '0' || *data > '9') {
+            return false;
+        }
+        T digit = *data - '0';
+        if (negative) {
+            if (result < (std::numeric_limits<T>::min() + digit) / 10) {
+                return false;
+            }
+            result = result * 10 - digit;
+        } else {
+            if (result > (std::numeric_limits<T>::max() - digit) / 10) {
+                return false;
+            }
+            result = result * 10 + digit;
+        }
+    }
+    value = result;
+    return true;
+}
+
+// The "C" locale, where `.' is the decimal point whatever LC_NUMERIC is.
+inline locale_t CLocale() {
+    static const locale_t locale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+    return locale;
+}
+
+// Exact powers of ten of T: 10^22 for double, 10^10 for float.
+template <typename T>
+struct ExactPowers;
+
+template <>
+struct ExactPowers<double> {
+    static const int kMaxExponent = 22;
+    static const uint64_t kMaxMantissa = uint64_t(1) << 53;
+    static double Get(int exponent) {
+        static const double kPowers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        return kPowers[exponent];
+    }
+    static double Fallback(const char* literal, char** end) {
+        return strtod_l(literal, end, CLocale());
+    }
+};
+
+template <>
+struct ExactPowers<float> {
+    static const int kMaxExponent = 10;
+    static const uint64_t kMaxMantissa = uint64_t(1) << 24;
+    static float Get(int exponent) {
+        static const float kPowers[] = {
+            1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+        };
+        return kPowers[exponent];
+    }
+    static float Fallback(const char* literal, char** end) {
+        return strtof_l(literal, end, CLocale());
+    }
+};
+
+// Returns True if [data, data + size) is a plain decimal literal:
+// an optional sign, digits with an optional point, at least one digit,
+// and an optional exponent. No spaces, hex, `inf' or `nan'.
+inline bool IsDecimalLiteral(const char* data, size_t size) {
+    const char* p = data;
+    const char* end = data + size;
+    if (p < end && (*p == '-' || *p == '+')) {
+        ++p;
+    }
+    bool any_digit = false;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        any_digit = true;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            any_digit = true;
+        }
+    }
+    if (!any_digit) {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p < end && (*p == '-' || *p == '+')) {
+            ++p;
+        }
+        const char* exp_digits = p;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        }
+        if (p == exp_digits) {
+            return false;
+        }
+    }
+    return p == end;
+}
+
+// Parse the decimal literal [data, data + size) as T, correctly rounded.
+// Literals whose digits and exponent are exactly representable,
+// which covers nearly all hand-written conf values, take Clinger's
+// fast path: one exact multiplication or division.
+// Other plain decimal literals, see IsDecimalLiteral, fall back to
+// strtod/strtof in the "C" locale, so that both paths accept the same.
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+ParseNumber(const char* data, size_t size, T& value) {
+    const char* p = data;
+    const char* end = data + size;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any_digit = false;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        any_digit = true;
+        if (mantissa || *p != '0') {
+            mantissa = mantissa * 10 + (*p - '0');
+            ++digits;
+        }
+        if (digits > 19) {
+            break;
+        }
+    }
+    if (p < end && *p == '.' && digits <= 19) {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            any_digit = true;
+            if (mantissa || *p != '0') {
+                mantissa = mantissa * 10 + (*p - '0');
+                ++digits;
+            }
+            --exponent;
+            if (digits > 19) {
+                break;
+            }
+        }
+    }
+    if (any_digit && digits <= 19 && p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool exp_negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            exp_negative = *p == '-';
+            ++p;
+        }
+        const char* exp_digits = p;
+        int exp_value = 0;
+        for (; p < end && *p >= '0' && *p <= '9' && exp_value < 10000; ++p) {
+            exp_value = exp_value * 10 + (*p - '0');
+        }
+        if (p == exp_digits) {
+            return false;
+        }
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+
+    if (any_digit && p == end && digits <= 19
+            && mantissa <= ExactPowers<T>::kMaxMantissa
+            && exponent >= -ExactPowers<T>::kMaxExponent
+            && exponent <= ExactPowers<T>::kMaxExponent) {
+        T result = static_cast<T>(mantissa);
+        if (exponent < 0) {
+            result /= ExactPowers<T>::Get(-exponent);
+        } else {
+            result *= ExactPowers<T>::Get(exponent);
+        }
+        value = negative ? -result : result;
+        return true;
+    }
+
+    if (!IsDecimalLiteral(data, size)) {
+        return false;
+    }
+
+    // strto* needs a terminated literal.
+    char buf[64];
+    std::string long_literal;
+    const char* literal = buf;
+    if (size < sizeof(buf)) {
+        memcpy(buf, data, size);
+        buf[size] = '\0';
+    } else {
+        long_literal.assign(data, size);
+        literal = long_literal.c_str();
+    }
+
+    char* parsed_end = nullptr;
+    errno = 0;
+    T result = ExactPowers<T>::Fallback(literal, &parsed_end);
+    if (parsed_end != literal + size || errno == ERANGE) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+}
+
+#endif
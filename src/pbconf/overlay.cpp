@@ -0,0 +1,488 @@
+#include "overlay.h"
+
+#include <boost/exception/diagnostic_information.hpp>
+#include <algorithm>
+#include <bthread/bthread.h>
+#include <butil/file_util.h>
+#include <butil/files/file_enumerator.h>
+#include <butil/files/file_path.h>
+#include <butil/strings/string_util.h>
+#include <butil/strings/stringprintf.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <hocon/config.hpp>
+#include <hocon/config_list.hpp>
+#include <hocon/config_object.hpp>
+#include <hocon/config_parse_options.hpp>
+#include <hocon/config_syntax.hpp>
+#include <hocon/config_value.hpp>
+#include <hocon/types.hpp>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+#include "field_path.h"
+#include "include_cache.h"
+#include "json_reader.h"
+#include "load_metrics.h"
+#include "load_plan.h"
+#include "yaml_conf.h"
+
+namespace pbconf {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using Message = ::google::protobuf::Message;
+using Node = YAML::Node;
+using string = std::string;
+
+using shared_value = ::hocon::shared_value;
+
+namespace {
+
+// Begin parse
+// Every format is parsed into a YAML::Node document,
+// so that documents of any format merge the same way.
+
+bool JsonToNode(JsonReader& reader, Node& out) {
+    switch (reader.Peek()) {
+    case JsonReader::OBJECT: {
+        if (!reader.StartObject()) {
+            return false;
+        }
+        out = Node(YAML::NodeType::Map);
+        const char* key = nullptr;
+        size_t key_size = 0;
+        bool end = false;
+        while (reader.NextMember(key, key_size, end) && !end) {
+            Node value;
+            const string name(key, key_size);
+            if (!JsonToNode(reader, value)) {
+                return false;
+            }
+            out.force_insert(name, value);
+        }
+        return end;
+    }
+    case JsonReader::ARRAY: {
+        if (!reader.StartArray()) {
+            return false;
+        }
+        out = Node(YAML::NodeType::Sequence);
+        bool end = false;
+        while (reader.NextElement(end) && !end) {
+            Node value;
+            if (!JsonToNode(reader, value)) {
+                return false;
+            }
+            out.push_back(value);
+        }
+        return end;
+    }
+    case JsonReader::STRING:
+    case JsonReader::NUMBER: {
+        const char* data = nullptr;
+        size_t size = 0;
+        bool ok = reader.Peek() == JsonReader::STRING
+            ? reader.ReadString(data, size)
+            : reader.ReadNumber(data, size);
+        if (!ok) {
+            return false;
+        }
+        out = Node(string(data, size));
+        return true;
+    }
+    case JsonReader::BOOLEAN: {
+        bool value = false;
+        if (!reader.ReadBool(value)) {
+            return false;
+        }
+        out = Node(value ? "true" : "false");
+        return true;
+    }
+    case JsonReader::NUL:
+        out = Node(YAML::NodeType::Null);
+        return reader.ReadNull();
+    default:
+        return false;
+    }
+}
+
+bool ParseJson(const string& filename, Node& root, string& err_msg) {
+    string content;
+    if (!butil::ReadFileToString(butil::FilePath(filename), &content)) {
+        butil::StringAppendF(&err_msg, "Fail to read file:%s", filename.c_str());
+        return false;
+    }
+    JsonReader reader(&content[0], &content[0] + content.size());
+    if (!JsonToNode(reader, root)) {
+        butil::StringAppendF(&err_msg, "Invalid json at %s of %s",
+                reader.Position().c_str(), filename.c_str());
+        return false;
+    }
+    if (!reader.AtEnd()) {
+        butil::StringAppendF(&err_msg, "Unexpected content at %s of %s",
+                reader.Position().c_str(), filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+Node HoconToNode(const shared_value& value) {
+    if (!value) {
+        return Node(YAML::NodeType::Null);
+    }
+    switch (value->value_type()) {
+    case ::hocon::config_value::type::OBJECT: {
+        auto object = std::static_pointer_cast<const ::hocon::config_object>(value);
+        Node out(YAML::NodeType::Map);
+        for (auto citr = object->begin(); citr != object->end(); ++citr) {
+            out.force_insert(citr->first, HoconToNode(citr->second));
+        }
+        return out;
+    }
+    case ::hocon::config_value::type::LIST: {
+        auto list = std::static_pointer_cast<const ::hocon::config_list>(value);
+        Node out(YAML::NodeType::Sequence);
+        for (auto citr = list->begin(); citr != list->end(); ++citr) {
+            out.push_back(HoconToNode(*citr));
+        }
+        return out;
+    }
+    case ::hocon::config_value::type::CONFIG_NULL:
+        return Node(YAML::NodeType::Null);
+    default:
+        return Node(value->transform_to_string());
+    }
+}
+
+bool ParseHocon(const string& filename, IncludeCache& include_cache, Node& root,
+        string& err_msg) {
+    // The setters return a modified copy.
+    const hocon::config_parse_options option = include_cache.Options(filename,
+            hocon::config_parse_options()
+            .set_syntax(hocon::config_syntax::CONF)
+            .set_allow_missing(true));
+    hocon::shared_config conf = hocon::config::parse_file_any_syntax(filename, option);
+    root = HoconToNode(conf->root());
+    return true;
+}
+
+struct ParseTask {
+    const string* filename;
+    IncludeCache* include_cache;
+    LoadMetrics* metrics;
+    Node root;
+    bool ok = false;
+    string err_msg;
+};
+
+void* Parse(void* arg) {
+    ParseTask* task = static_cast<ParseTask*>(arg);
+    const string& filename = *task->filename;
+    LoadMetrics::Format format = LoadMetrics::YAML;
+    if (EndsWith(filename, ".json", true)) {
+        format = LoadMetrics::JSON;
+    } else if (EndsWith(filename, ".conf", true)) {
+        format = LoadMetrics::HOCON;
+    } else if (!EndsWith(filename, ".yml", true)) {
+        butil::StringAppendF(&task->err_msg, "Unknown conf format:%s", filename.c_str());
+        return nullptr;
+    }
+
+    int64_t size = 0;
+    if (task->metrics && butil::GetFileSize(butil::FilePath(filename), &size)) {
+        task->metrics->RecordBytesRead(format, size);
+    }
+    // Including reading the file.
+    ScopedPhase parse(task->metrics, format, LoadMetrics::PARSE);
+    try {
+        if (format == LoadMetrics::YAML) {
+            task->root = YAML::LoadFile(filename);
+            task->ok = true;
+        } else if (format == LoadMetrics::JSON) {
+            task->ok = ParseJson(filename, task->root, task->err_msg);
+        } else {
+            task->ok = ParseHocon(filename, *task->include_cache, task->root, task->err_msg);
+        }
+    } catch (...) {
+        task->err_msg = boost::current_exception_diagnostic_information();
+        task->ok = false;
+    }
+    return nullptr;
+}
+
+// Parse all files, on a bthread each when there are several.
+void ParseAll(std::vector<ParseTask>& tasks) {
+    if (tasks.size() == 1) {
+        Parse(&tasks[0]);
+        return;
+    }
+    std::vector<bthread_t> tids(tasks.size(), INVALID_BTHREAD);
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        if (bthread_start_background(&tids[i], nullptr, Parse, &tasks[i]) != 0) {
+            tids[i] = INVALID_BTHREAD;
+            Parse(&tasks[i]);
+        }
+    }
+    for (bthread_t tid : tids) {
+        if (tid != INVALID_BTHREAD) {
+            bthread_join(tid, nullptr);
+        }
+    }
+}
+// End parse
+
+// Begin merge
+// How the keys of a message type merge, built once per type and Load.
+struct MergePlan {
+    std::vector<const FieldDescriptor*> fields;
+    FieldIndex index;
+    // Parallel to `fields'.
+    std::vector<bool> append;
+};
+
+class Merger {
+public:
+    explicit Merger(const std::unordered_set<const FieldDescriptor*>* appended)
+        : _appended(appended) {}
+
+    // Merge `over' onto `base', both maps of `descriptor'.
+    // Neither of them is modified, but for the sequences of `base'
+    // this merger appended into: merged maps are new ones,
+    // sharing the values that are taken as they are.
+    Node MergeMap(const Node& base, const Node& over, const Descriptor* descriptor);
+
+private:
+    const MergePlan& PlanOf(const Descriptor* descriptor);
+
+    Node MergeValue(const Node& base, const Node& over, const FieldDescriptor* field,
+            bool append);
+
+    // Whether `node' is a sequence this merger appended into.
+    bool Owns(const Node& node) const;
+
+    const std::unordered_set<const FieldDescriptor*>* _appended;
+    // The sequences appended into, which later overlays append to
+    // in place instead of copying them once more.
+    std::vector<Node> _sequences;
+    std::unordered_map<const Descriptor*, std::unique_ptr<MergePlan>> _plans;
+};
+
+const MergePlan& Merger::PlanOf(const Descriptor* descriptor) {
+    std::unique_ptr<MergePlan>& plan = _plans[descriptor];
+    if (!plan) {
+        plan.reset(new MergePlan());
+        CollectFields(descriptor, plan->fields);
+        plan->index.Build(plan->fields);
+        for (const FieldDescriptor* field : plan->fields) {
+            plan->append.push_back(_appended->count(field) != 0);
+        }
+    }
+    return *plan;
+}
+
+bool Merger::Owns(const Node& node) const {
+    for (const Node& sequence : _sequences) {
+        if (sequence.is(node)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Node Merger::MergeValue(
+        const Node& base,
+        const Node& over,
+        const FieldDescriptor* field,
+        bool append) {
+    if (!field) {
+        return over;
+    }
+    if (field->is_repeated()) {
+        if (!append || !base.IsSequence() || !over.IsSequence()) {
+            return over;
+        }
+        // Not assigned to, which would change the node `base' is.
+        Node merged = Owns(base) ? base : Node(YAML::NodeType::Sequence);
+        if (!merged.is(base)) {
+            for (auto citr = base.begin(); citr != base.end(); ++citr) {
+                merged.push_back(*citr);
+            }
+            _sequences.push_back(merged);
+        }
+        for (auto citr = over.begin(); citr != over.end(); ++citr) {
+            merged.push_back(*citr);
+        }
+        return merged;
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE
+            && base.IsMap() && over.IsMap()) {
+        return MergeMap(base, over, field->message_type());
+    }
+    return over;
+}
+
+Node Merger::MergeMap(const Node& base, const Node& over, const Descriptor* descriptor) {
+    const MergePlan& plan = PlanOf(descriptor);
+
+    // The keys of `over', which win over the same keys of `base'.
+    std::unordered_map<string, Node> overrides;
+    for (auto citr = over.begin(); citr != over.end(); ++citr) {
+        const auto entry = *citr;
+        if (entry.first.IsScalar()) {
+            overrides[entry.first.Scalar()] = entry.second;
+        }
+    }
+
+    // Keys of `base' first, in order, then the new keys of `over'.
+    Node merged(YAML::NodeType::Map);
+    std::unordered_set<string> taken;
+    for (auto citr = base.begin(); citr != base.end(); ++citr) {
+        const auto entry = *citr;
+        if (!entry.first.IsScalar()) {
+            continue;
+        }
+        const string& key = entry.first.Scalar();
+        auto found = overrides.find(key);
+        if (found == overrides.end()) {
+            merged.force_insert(key, entry.second);
+            continue;
+        }
+        taken.insert(key);
+        // An explicit null removes the value below.
+        if (found->second.IsNull()) {
+            continue;
+        }
+        const int pos = plan.index.Find(key);
+        merged.force_insert(key, pos < 0
+                ? found->second
+                : MergeValue(entry.second, found->second, plan.fields[pos],
+                    plan.append[pos]));
+    }
+    for (auto citr = over.begin(); citr != over.end(); ++citr) {
+        const auto entry = *citr;
+        if (!entry.first.IsScalar() || entry.second.IsNull()
+                || taken.count(entry.first.Scalar()) != 0) {
+            continue;
+        }
+        merged.force_insert(entry.first.Scalar(), entry.second);
+    }
+    return merged;
+}
+// End merge
+
+}
+
+bool ListConfFiles(const string& dirname, std::vector<string>* filenames, string& err_msg) {
+    if (!butil::DirectoryExists(butil::FilePath(dirname))) {
+        butil::StringAppendF(&err_msg, "Not a directory:%s", dirname.c_str());
+        return false;
+    }
+
+    std::vector<string> listed;
+    butil::FileEnumerator files(butil::FilePath(dirname), false, butil::FileEnumerator::FILES);
+    for (butil::FilePath path = files.Next(); !path.empty(); path = files.Next()) {
+        const string name = path.BaseName().value();
+        if (name.empty() || name[0] == '.') {
+            continue;
+        }
+        if (EndsWith(name, ".yml", true) || EndsWith(name, ".json", true)
+                || EndsWith(name, ".conf", true)) {
+            listed.push_back(path.value());
+        }
+    }
+    std::sort(listed.begin(), listed.end());
+    filenames->insert(filenames->end(), listed.begin(), listed.end());
+    return true;
+}
+
+bool ConfOverlay::Load(Message& msg) {
+    const bool ok = LoadFiles(msg);
+    if (_metrics) {
+        _metrics->RecordResult(LoadMetrics::YAML, ok, msg);
+    }
+    return ok;
+}
+
+bool ConfOverlay::LoadFiles(Message& msg) {
+    _error_msg.clear();
+    std::vector<string> filenames;
+    for (const Source& source : _sources) {
+        if (!source.directory) {
+            filenames.push_back(source.path);
+        } else if (!ListConfFiles(source.path, &filenames, _error_msg)) {
+            return false;
+        }
+    }
+    if (filenames.empty()) {
+        _error_msg = "No conf file to load";
+        return false;
+    }
+
+    const Descriptor* descriptor = msg.GetDescriptor();
+    std::unordered_set<const FieldDescriptor*> appended;
+    for (const auto& rule : _rules) {
+        std::vector<const FieldDescriptor*> fields;
+        if (!ResolveFieldPath(descriptor, rule.first, &fields, _error_msg)) {
+            return false;
+        }
+        if (fields.empty() || !fields.back()->is_repeated()) {
+            butil::StringAppendF(&_error_msg, "Not a repeated field in merge rule:%s",
+                    rule.first.c_str());
+            return false;
+        }
+        if (rule.second == APPEND) {
+            appended.insert(fields.back());
+        } else {
+            appended.erase(fields.back());
+        }
+    }
+
+    // Files included by several conf files are parsed once per Load at least.
+    IncludeCache load_cache;
+    std::vector<ParseTask> tasks(filenames.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        tasks[i].filename = &filenames[i];
+        tasks[i].include_cache = _include_cache ? _include_cache : &load_cache;
+        tasks[i].metrics = _metrics;
+    }
+    ParseAll(tasks);
+
+    Merger merger(&appended);
+    Node merged;
+    for (ParseTask& task : tasks) {
+        if (!task.ok) {
+            _error_msg = task.err_msg;
+            return false;
+        }
+        // An empty file overrides nothing.
+        if (task.root.IsNull()) {
+            continue;
+        }
+        if (!task.root.IsMap()) {
+            butil::StringAppendF(&_error_msg, "Expect a map at the root of %s",
+                    task.filename->c_str());
+            return false;
+        }
+        merged = merged.IsMap() ? merger.MergeMap(merged, task.root, descriptor) : task.root;
+    }
+    if (!merged.IsMap()) {
+        merged = Node(YAML::NodeType::Map);
+    }
+
+    return YamlConf()
+        .SetIgnoreEnumCase(_ignore_enum_case)
+        .SetUseGenerated(_use_generated)
+        .SetParallel(_parallel)
+        .SetLazyFields(_lazy)
+        .SetLoadMask(_mask)
+        .SetMetrics(_metrics)
+        .LoadDocument(merged, msg, _error_msg);
+}
+
+}
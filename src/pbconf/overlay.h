@@ -0,0 +1,158 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <google/protobuf/message.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pbconf {
+
+class IncludeCache;
+class LazyFields;
+class LoadMask;
+class LoadMetrics;
+
+// Loads a stack of conf files, e.g. a base conf plus environment,
+// region and host overrides, into one message.
+//
+// The files may be any mix of yml, json and conf, told apart by
+// their extension as PbConf does, and directories of such files,
+// e.g. a conf.d of fragments. They are parsed concurrently, one
+// bthread each, merged as documents in order, later files over earlier
+// ones, and the merged document is converted once. So required fields
+// only need to be present in the merged document, not in every file.
+//
+// Merging follows the message type:
+//   - a singular message field merges key by key with the one below;
+//   - a repeated field replaces the one below, or is appended to it
+//     when its merge rule is APPEND;
+//   - any other value replaces the one below;
+//   - an explicit null, e.g. `port: ~', removes the value below.
+class ConfOverlay final {
+public:
+    enum MergeRule {
+        REPLACE,
+        APPEND
+    };
+
+    ConfOverlay& SetFilenames(const std::vector<std::string>& filenames) {
+        _sources.clear();
+        for (const auto& filename : filenames) {
+            AddFilename(filename);
+        }
+        return *this;
+    }
+
+    // Add a file over the ones added before.
+    ConfOverlay& AddFilename(const std::string& filename) {
+        _sources.push_back({filename, false});
+        return *this;
+    }
+
+    // Add the conf files of directory `dirname', e.g. `conf/conf.d',
+    // over the ones added before, in lexical order of their names.
+    // Only the files named *.yml, *.json or *.conf are loaded, hidden
+    // files aside; subdirectories are not. The directory is listed
+    // again on each Load.
+    ConfOverlay& AddDirectory(const std::string& dirname) {
+        _sources.push_back({dirname, true});
+        return *this;
+    }
+
+    // How the repeated field at `path', e.g. `endpoints' or
+    // `cluster.servers', merges with the files below.
+    // The rule holds for the field wherever its message type is met.
+    // Rules are checked against the message type by Load.
+    ConfOverlay& SetMergeRule(const std::string& path, MergeRule rule) {
+        _rules.emplace_back(path, rule);
+        return *this;
+    }
+
+    // See YamlConf::SetIgnoreEnumCase.
+    ConfOverlay& SetIgnoreEnumCase(bool ignore_enum_case) {
+        _ignore_enum_case = ignore_enum_case;
+        return *this;
+    }
+
+    // See YamlConf::SetUseGenerated.
+    ConfOverlay& SetUseGenerated(bool use_generated) {
+        _use_generated = use_generated;
+        return *this;
+    }
+
+    // See YamlConf::SetParallel.
+    ConfOverlay& SetParallel(bool parallel) {
+        _parallel = parallel;
+        return *this;
+    }
+
+    // Parse the files the hocon conf files include through `cache',
+    // shared with other loads, see IncludeCache. Otherwise each Load
+    // still parses a file included by several conf files only once.
+    // `cache' must outlive the loads.
+    ConfOverlay& SetIncludeCache(IncludeCache* cache) {
+        _include_cache = cache;
+        return *this;
+    }
+
+    // Convert the merged document as YamlConf does with these,
+    // see YamlConf::SetLazyFields and YamlConf::SetLoadMask.
+    ConfOverlay& SetLazyFields(LazyFields* lazy) {
+        _lazy = lazy;
+        return *this;
+    }
+
+    ConfOverlay& SetLoadMask(const LoadMask* mask) {
+        _mask = mask;
+        return *this;
+    }
+
+    // Record each Load into `metrics', see LoadMetrics: the parse phase
+    // and size of each conf file under its format, then the conversion
+    // and result of the merged document under yaml, which converts it.
+    // The metrics must outlive the loads.
+    ConfOverlay& SetMetrics(LoadMetrics* metrics) {
+        _metrics = metrics;
+        return *this;
+    }
+
+    // Load the merged conf files into msg.
+    // Returns True if success; otherwise False.
+    bool Load(::google::protobuf::Message& msg);
+
+    std::string ErrorMessage() const {
+        return _error_msg;
+    }
+private:
+    bool LoadFiles(::google::protobuf::Message& msg);
+
+    // A conf file, or a directory of conf files.
+    struct Source {
+        std::string path;
+        bool directory;
+    };
+
+    std::vector<Source> _sources;
+    std::vector<std::pair<std::string, MergeRule>> _rules;
+    std::string _error_msg;
+    bool _ignore_enum_case = false;
+    bool _use_generated = true;
+    bool _parallel = false;
+    IncludeCache* _include_cache = nullptr;
+    LazyFields* _lazy = nullptr;
+    const LoadMask* _mask = nullptr;
+    LoadMetrics* _metrics = nullptr;
+};
+
+// Append the conf files of directory `dirname' to `filenames',
+// in the order ConfOverlay::AddDirectory loads them.
+// Returns True if success; otherwise False, with err_msg filled.
+bool ListConfFiles(
+        const std::string& dirname,
+        std::vector<std::string>* filenames,
+        std::string& err_msg);
+
+}
+
+#endif
@@ -1,47 +1,287 @@
 #include "pbconf.h"
 
 #include <algorithm>
+#include <atomic>
 #include <butil/file_util.h>
 #include <butil/files/file_path.h>
 #include <butil/strings/string_util.h>
+#include <butil/strings/stringprintf.h>
+#include <chrono>
 #include <google/protobuf/message.h>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "yaml_conf.h"
 #include "json_conf.h"
 #include "hocon_conf.h"
+#include "load_mask.h"
+#include "load_metrics.h"
+#include "overlay.h"
+#include "snapshot_cache.h"
 
 namespace pbconf {
 
-bool PbConf::Load(::google::protobuf::Message& msg) {
+using Clock = std::chrono::steady_clock;
+
+static int64_t ElapsedUs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - start).count();
+}
+
+std::string PbConf::Filename() const {
+    if (!_filename.empty()) {
+        return _filename;
+    }
+
     std::vector<std::string> ordered_filenames = {
-        "conf/application.yml", "conf/application.json", "conf/application.conf"
+        "conf/application.yml", "conf/application.json", "conf/application.conf",
+        "conf/conf.d"
     };
 
     auto file_exists = [](const std::string& filename) {
         return butil::PathExists(butil::FilePath(filename));
     };
 
+    auto best_choice = std::find_if(std::begin(ordered_filenames),
+            std::end(ordered_filenames), file_exists);
+    if (best_choice == std::end(ordered_filenames)) {
+        return std::string();
+    }
+    return *best_choice;
+}
+
+// Record a load of the current conf started at `start_us'.
+static void RecordLoad(LoadMetrics* metrics, int64_t start_us, bool ok) {
+    if (!metrics) {
+        return;
+    }
+    metrics->RecordLoad(LoadMetrics::NowUs() - start_us);
+    if (ok) {
+        metrics->RecordPublish();
+    }
+}
+
+bool PbConf::Load(::google::protobuf::Message& msg) {
+    if (_filename.empty()) {
+        _filename = Filename();
+        if (_filename.empty()) {
+            return false;
+        }
+    }
+
+    const int64_t start_us = _metrics ? LoadMetrics::NowUs() : 0;
+    // The snapshot cache would hold the conf without its lazy fields.
+    const bool ok = _lazy
+        ? LoadFile(_filename, msg, _lazy, nullptr, _error_msg)
+        : LoadCached(_filename, msg, _error_msg);
+    RecordLoad(_metrics, start_us, ok);
+    return ok;
+}
+
+bool PbConf::Load(
+        ::google::protobuf::Message& msg,
+        const ::google::protobuf::FieldMask& mask) {
     if (_filename.empty()) {
-        auto best_choice = std::find_if(std::begin(ordered_filenames),
-                std::end(ordered_filenames), file_exists);
-        if (best_choice == std::end(ordered_filenames)) {
+        _filename = Filename();
+        if (_filename.empty()) {
             return false;
         }
-        _filename = *best_choice;
     }
 
-    if (EndsWith(_filename, ".yml", true)) {
-        return YamlConf().Load(_filename, msg, _error_msg);
+    LoadMask load_mask;
+    if (!load_mask.Build(msg.GetDescriptor(), mask, _error_msg)) {
+        return false;
+    }
+    const int64_t start_us = _metrics ? LoadMetrics::NowUs() : 0;
+    // The snapshot cache holds whole confs.
+    const bool ok = LoadFile(_filename, msg, _lazy, &load_mask, _error_msg);
+    RecordLoad(_metrics, start_us, ok);
+    return ok;
+}
+
+bool PbConf::Load(IncrementalState& state) {
+    if (_filename.empty()) {
+        _filename = Filename();
+        if (_filename.empty()) {
+            return false;
+        }
+    }
+
+    if (EndsWith(_filename, ".yml", true) && !_streaming) {
+        const int64_t start_us = _metrics ? LoadMetrics::NowUs() : 0;
+        const bool ok = YamlConf()
+            .SetIgnoreEnumCase(_ignore_enum_case)
+            .SetUseGenerated(_use_generated)
+            .SetParallel(_parallel)
+            .SetMetrics(_metrics)
+            .Load(_filename, state, _error_msg);
+        RecordLoad(_metrics, start_us, ok);
+        return ok;
+    }
+
+    std::shared_ptr<::google::protobuf::Message> msg = state.NewMessage();
+    const int64_t start_us = _metrics ? LoadMetrics::NowUs() : 0;
+    const bool ok = LoadCached(_filename, *msg, _error_msg);
+    RecordLoad(_metrics, start_us, ok);
+    if (!ok) {
+        return false;
+    }
+    std::vector<std::string> changed_paths;
+    if (state._current) {
+        IncrementalState::Diff(*state._current, *msg, &changed_paths);
+    } else {
+        std::vector<const ::google::protobuf::FieldDescriptor*> fields;
+        msg->GetReflection()->ListFields(*msg, &fields);
+        for (auto field : fields) {
+            changed_paths.push_back(FieldPath(std::string(), field));
+        }
+    }
+    state._current = std::move(msg);
+    state._hashes.reset();
+    state._changed_paths.swap(changed_paths);
+    return true;
+}
+
+bool PbConf::LoadAll(std::vector<LoadTask>& tasks, LoadAllStats* stats) const {
+    const Clock::time_point start = Clock::now();
+    const size_t concurrency = std::min(tasks.size(), static_cast<size_t>(
+                _concurrency > 0 ? _concurrency
+                : std::max(std::thread::hardware_concurrency(), 1u)));
+
+    // Each thread takes the next task until none is left.
+    std::atomic<size_t> next(0);
+    std::mutex progress_mutex;
+    size_t done = 0;
+    auto run = [&]() {
+        for (size_t i = next++; i < tasks.size(); i = next++) {
+            LoadTask& task = tasks[i];
+            const Clock::time_point task_start = Clock::now();
+            task.error_msg.clear();
+            if (task.msg) {
+                task.ok = LoadCached(task.filename, *task.msg, task.error_msg);
+            } else {
+                task.ok = false;
+                task.error_msg = "No message to load into";
+            }
+            task.elapsed_us = ElapsedUs(task_start);
+            std::lock_guard<std::mutex> guard(progress_mutex);
+            ++done;
+            if (_progress) {
+                _progress(task, done, tasks.size());
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < concurrency; ++i) {
+        threads.emplace_back(run);
+    }
+    run();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    LoadAllStats summary;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        ++(tasks[i].ok ? summary.loaded : summary.failed);
+        summary.total_us += tasks[i].elapsed_us;
+        if (summary.slowest < 0 || tasks[i].elapsed_us > tasks[summary.slowest].elapsed_us) {
+            summary.slowest = i;
+        }
+    }
+    summary.elapsed_us = ElapsedUs(start);
+    if (stats) {
+        *stats = summary;
+    }
+    return summary.failed == 0;
+}
+
+bool PbConf::LoadCached(
+        const std::string& filename,
+        ::google::protobuf::Message& msg,
+        std::string& err_msg) const {
+    if (!_snapshot_cache) {
+        return LoadFile(filename, msg, nullptr, nullptr, err_msg);
+    }
+
+    // Only the enum case option changes what a conf file loads as.
+    SnapshotCache cache(filename, _ignore_enum_case ? 1 : 0);
+    if (cache.Load(msg)) {
+        return true;
+    }
+    // The snapshot holds the conf file alone, not what msg held before.
+    if (msg.ByteSizeLong() == 0) {
+        if (!LoadFile(filename, msg, nullptr, nullptr, err_msg)) {
+            return false;
+        }
+        cache.Store(msg);
+        return true;
+    }
+    std::unique_ptr<::google::protobuf::Message> loaded(msg.New());
+    if (!LoadFile(filename, *loaded, nullptr, nullptr, err_msg)) {
+        return false;
+    }
+    cache.Store(*loaded);
+    msg.MergeFrom(*loaded);
+    return true;
+}
+
+bool PbConf::LoadFile(
+        const std::string& filename,
+        ::google::protobuf::Message& msg,
+        LazyFields* lazy,
+        const LoadMask* mask,
+        std::string& err_msg) const {
+    if (butil::DirectoryExists(butil::FilePath(filename))) {
+        ConfOverlay overlay;
+        overlay.AddDirectory(filename)
+            .SetIgnoreEnumCase(_ignore_enum_case)
+            .SetUseGenerated(_use_generated)
+            .SetParallel(_parallel)
+            .SetIncludeCache(_include_cache)
+            .SetLazyFields(lazy)
+            .SetLoadMask(mask)
+            .SetMetrics(_metrics);
+        if (!overlay.Load(msg)) {
+            err_msg += overlay.ErrorMessage();
+            return false;
+        }
+        return true;
+    }
+    if (EndsWith(filename, ".yml", true)) {
+        // The streaming mode fails with lazy fields.
+        return YamlConf()
+            .SetStreaming(_streaming && !lazy)
+            .SetIgnoreEnumCase(_ignore_enum_case)
+            .SetUseGenerated(_use_generated)
+            .SetParallel(_parallel)
+            .SetLazyFields(lazy)
+            .SetLoadMask(mask)
+            .SetMetrics(_metrics)
+            .Load(filename, msg, err_msg);
     }
-    if (EndsWith(_filename, ".json", true)) {
-        return JsonConf().Load(_filename, msg, _error_msg);
+    if (EndsWith(filename, ".json", true)) {
+        return JsonConf()
+            .SetIgnoreEnumCase(_ignore_enum_case)
+            .SetUseGenerated(_use_generated)
+            .SetLazyFields(lazy)
+            .SetLoadMask(mask)
+            .SetMetrics(_metrics)
+            .Load(filename, msg, err_msg);
     }
-    if (EndsWith(_filename, ".conf", true)) {
-        return HoconConf().Load(_filename, msg, _error_msg);
+    if (EndsWith(filename, ".conf", true)) {
+        return HoconConf()
+            .SetIgnoreEnumCase(_ignore_enum_case)
+            .SetIncludeCache(_include_cache)
+            .SetLazyFields(lazy)
+            .SetLoadMask(mask)
+            .SetMetrics(_metrics)
+            .Load(filename, msg, err_msg);
     }
 
+    butil::StringAppendF(&err_msg, "Unknown conf format:%s", filename.c_str());
     return false;
 }
 
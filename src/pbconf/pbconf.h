@@ -1,11 +1,47 @@
 #ifndef PBCONF_H
 #define PBCONF_H
 
+#include <functional>
+#include <google/protobuf/field_mask.pb.h>
 #include <google/protobuf/message.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "incremental_state.h"
 
 namespace pbconf {
 
+class IncludeCache;
+class LazyFields;
+class LoadMask;
+class LoadMetrics;
+
+// One conf file of PbConf::LoadAll.
+struct LoadTask {
+    std::string filename;
+    ::google::protobuf::Message* msg = nullptr;
+
+    // Filled by LoadAll.
+    bool ok = false;
+    std::string error_msg;
+    // Time spent loading this file.
+    int64_t elapsed_us = 0;
+};
+
+struct LoadAllStats {
+    size_t loaded = 0;
+    size_t failed = 0;
+    // Wall time of the whole LoadAll.
+    int64_t elapsed_us = 0;
+    // Sum of the time spent on each file.
+    int64_t total_us = 0;
+    // Index of the slowest task, or -1 when there is none.
+    int64_t slowest = -1;
+};
+
 class PbConf final {
 public:
     // We can set the filename explicitly.
@@ -14,22 +50,170 @@ public:
     // application.yml(yaml format)
     //     > application.json(json format)
     //         > application.conf(hocon format)
+    //             > conf.d(directory)
+    // A directory is loaded in directory mode: all its conf files,
+    // read and parsed concurrently, merged in lexical order of their
+    // names, see ConfOverlay::AddDirectory. Streaming does not apply.
     PbConf& SetFilename(const std::string& filename) {
         _filename = filename;
         return *this;
     }
 
+    // Load yaml conf files in streaming mode, see YamlConf::SetStreaming.
+    // Json conf files are always read as a stream. Loads with lazy
+    // fields read yaml conf files in tree mode instead.
+    PbConf& SetStreaming(bool streaming) {
+        _streaming = streaming;
+        return *this;
+    }
+
+    // Match enum names ignoring ASCII case in all formats,
+    // see YamlConf::SetIgnoreEnumCase. Enum values are resolved without
+    // allocating, except in hocon where each name is copied into a
+    // std::string, see HoconConf::SetIgnoreEnumCase.
+    PbConf& SetIgnoreEnumCase(bool ignore_enum_case) {
+        _ignore_enum_case = ignore_enum_case;
+        return *this;
+    }
+
+    // Whether yaml and json conf files are loaded through the loaders
+    // generated by protoc-gen-pbconf, see YamlConf::SetUseGenerated.
+    // Hocon conf files and yaml streaming always use Reflection.
+    PbConf& SetUseGenerated(bool use_generated) {
+        _use_generated = use_generated;
+        return *this;
+    }
+
+    // Convert long lists of messages of yaml conf files in parallel,
+    // see YamlConf::SetParallel.
+    PbConf& SetParallel(bool parallel) {
+        _parallel = parallel;
+        return *this;
+    }
+
+    // Cache a binary snapshot of the loaded conf next to the conf file,
+    // as `<filename>.pbcache', see SnapshotCache. Later loads of an
+    // unchanged conf file parse the snapshot instead.
+    PbConf& SetSnapshotCache(bool snapshot_cache) {
+        _snapshot_cache = snapshot_cache;
+        return *this;
+    }
+
+    // Parse the files hocon conf files include through `cache', shared
+    // by all the conf files and loads using it, see IncludeCache.
+    // Directory mode parses a file its conf files include only once per
+    // load, even without a cache. `cache' must outlive this PbConf and
+    // its copies.
+    PbConf& SetIncludeCache(IncludeCache* cache) {
+        _include_cache = cache;
+        return *this;
+    }
+
+    // Leave the lazy fields of the root message to `lazy', to be
+    // converted on first access, see LazyFields. Only applies to Load
+    // into a message, without the snapshot cache; LoadAll and Load
+    // into an IncrementalState convert all fields. Yaml conf files are
+    // then read in tree mode, the streaming mode having no lazy fields.
+    // `lazy' must outlive this PbConf and its copies.
+    PbConf& SetLazyFields(LazyFields* lazy) {
+        _lazy = lazy;
+        return *this;
+    }
+
+    // Record each Load, with the phases, size and result of
+    // the conf files loaded, into `metrics', see LoadMetrics.
+    // LoadAll only records the conf files it loads.
+    // The metrics must outlive this PbConf and its copies.
+    PbConf& SetMetrics(LoadMetrics* metrics) {
+        _metrics = metrics;
+        return *this;
+    }
+
+    // Threads LoadAll runs on, the hardware concurrency by default.
+    PbConf& SetConcurrency(int concurrency) {
+        _concurrency = concurrency;
+        return *this;
+    }
+
+    // Called after each file of LoadAll with the task and the number
+    // of files done so far, one call at a time. It runs on the loading
+    // threads, so it had better be quick.
+    typedef std::function<void(const LoadTask& task, size_t done, size_t total)>
+        ProgressCallback;
+    PbConf& SetProgressCallback(ProgressCallback progress) {
+        _progress = std::move(progress);
+        return *this;
+    }
+
     // Load conf into the specified ProtoBuf msg,
     // then, we can use conf value at ease.
+    // A msg created on an Arena, e.g. by Arena::CreateMessage,
+    // gets its whole message tree built on that arena,
+    // see also MessageAllocator.
     // Returns True if success; otherwise False.
     bool Load(::google::protobuf::Message& msg);
 
+    // Load only the fields of `mask' into msg, e.g. the few sections
+    // of a shared conf a process reads. Fields outside the mask are
+    // skipped without being converted, nor built in streaming mode,
+    // and only the required fields inside the mask are checked,
+    // see LoadMask. Loads through Reflection, without the snapshot
+    // cache; lazy fields in the mask are converted whole.
+    // Returns True if success; otherwise False, also when a path of
+    // the mask is not a field path of msg.
+    bool Load(::google::protobuf::Message& msg, const ::google::protobuf::FieldMask& mask);
+
+    // Load conf into a new message of `state', see IncrementalState.
+    // Yaml conf files in tree mode only convert the subtrees changed
+    // since the last load, see YamlConf::Load. Other conf files are
+    // loaded as a whole and compared with the last message.
+    // Returns True if success; otherwise False, with `state' unchanged.
+    bool Load(IncrementalState& state);
+
+    // Load each task's file into its msg, concurrently on up to
+    // SetConcurrency threads, with the options of this PbConf.
+    // The filename set by SetFilename is not used. Each task gets its
+    // own status and error message; `stats', if not null, sums them up.
+    // Returns True if all files loaded; otherwise False.
+    bool LoadAll(std::vector<LoadTask>& tasks, LoadAllStats* stats = nullptr) const;
+
+    // The conf file Load reads: the filename set explicitly,
+    // otherwise the first default file that exists.
+    // Returns empty if there is none.
+    std::string Filename() const;
+
     std::string ErrorMessage() const {
         return _error_msg;
     }
 private:
+    friend class PbConfWatcher;
+
+    // Load the conf file named `filename', through the snapshot cache
+    // if enabled. Only reads the options, so calls may run concurrently.
+    bool LoadCached(
+            const std::string& filename,
+            ::google::protobuf::Message& msg,
+            std::string& err_msg) const;
+
+    bool LoadFile(
+            const std::string& filename,
+            ::google::protobuf::Message& msg,
+            LazyFields* lazy,
+            const LoadMask* mask,
+            std::string& err_msg) const;
+
     std::string _filename;
     std::string _error_msg;
+    bool _streaming = false;
+    bool _ignore_enum_case = false;
+    bool _use_generated = true;
+    bool _snapshot_cache = false;
+    bool _parallel = false;
+    int _concurrency = 0;
+    ProgressCallback _progress;
+    IncludeCache* _include_cache = nullptr;
+    LazyFields* _lazy = nullptr;
+    LoadMetrics* _metrics = nullptr;
 };
 
 }
@@ -0,0 +1,318 @@
+#include "pbconf_watcher.h"
+
+#include <algorithm>
+#include <butil/file_util.h>
+#include <butil/files/file_path.h>
+#include <butil/third_party/murmurhash3/murmurhash3.h>
+#include <chrono>
+#include <errno.h>
+#include <google/protobuf/message.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+#include "overlay.h"
+
+namespace pbconf {
+
+using Message = ::google::protobuf::Message;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const uint32_t kHashSeed = 0x70626366;
+
+// The conf file itself, or the file its symlink points to:
+// written in place, replaced, or removed once a symlink moved away.
+const uint32_t kFileEvents = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB
+    | IN_DELETE_SELF | IN_MOVE_SELF;
+// Entries of the parent directory: the conf file renamed over,
+// or a symlink the conf file goes through swapped.
+const uint32_t kDirEvents = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO
+    | IN_MOVED_FROM | IN_DELETE | IN_ATTRIB;
+
+// A conf.d directory is watched as well for its fragments
+// written in place, added, renamed over or removed.
+uint32_t WatchedEvents(const std::string& filename) {
+    return butil::DirectoryExists(butil::FilePath(filename))
+        ? kFileEvents | kDirEvents : kFileEvents;
+}
+
+// The files a conf.d directory is made of, or the conf file alone.
+bool ListFiles(const std::string& filename, std::vector<std::string>* files) {
+    if (!butil::DirectoryExists(butil::FilePath(filename))) {
+        files->assign(1, filename);
+        return true;
+    }
+    std::string err_msg;
+    return ListConfFiles(filename, files, err_msg);
+}
+
+// The hash of the conf file, or of the names and contents of
+// the fragments of a conf.d directory, and of the files they include.
+// Included files may be missing, which hocon allows.
+bool HashFile(
+        const std::string& filename,
+        const std::vector<std::string>& includes,
+        uint64_t out[2]) {
+    std::string content;
+    if (butil::DirectoryExists(butil::FilePath(filename))) {
+        std::vector<std::string> fragments;
+        if (!ListFiles(filename, &fragments)) {
+            return false;
+        }
+        std::string fragment;
+        for (const auto& name : fragments) {
+            if (!butil::ReadFileToString(butil::FilePath(name), &fragment)) {
+                return false;
+            }
+            content.append(name).append(1, '\0').append(fragment).append(1, '\0');
+        }
+    } else if (!butil::ReadFileToString(butil::FilePath(filename), &content)) {
+        return false;
+    }
+    std::string included;
+    for (const auto& name : includes) {
+        content.append(name);
+        if (butil::ReadFileToString(butil::FilePath(name), &included)) {
+            content.append(1, '\0').append(included);
+        }
+        content.append(1, '\0');
+    }
+    if (content.size() > INT_MAX) {
+        return false;
+    }
+    MurmurHash3_x64_128(content.data(), static_cast<int>(content.size()), kHashSeed, out);
+    return true;
+}
+
+// Whether an event of a directory may concern the files named `names'.
+// Entries named `..*' are those Kubernetes swaps for ConfigMaps.
+bool Concerns(const struct inotify_event* event, const std::unordered_set<std::string>& names) {
+    if (event->len == 0) {
+        return true;
+    }
+    const char* name = event->name;
+    return names.count(name) != 0 || strncmp(name, "..", 2) == 0;
+}
+
+}
+
+bool PbConfWatcher::Start(const Message& prototype) {
+    Stop();
+
+    _filename = _conf.Filename();
+    if (_filename.empty()) {
+        SetErrorMessage("No conf file found");
+        return false;
+    }
+    _conf.SetFilename(_filename);
+    // The cache tells what the conf files include.
+    if (!_conf._include_cache) {
+        _include_cache.reset(new IncludeCache());
+        _conf.SetIncludeCache(_include_cache.get());
+    }
+    _state.reset(new IncrementalState(prototype));
+    _state->SetAllocator(_allocator);
+
+    // Watch before the first load, so that no edit goes unnoticed.
+    _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    _stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    const butil::FilePath path(_filename);
+    const std::string dirname = path.DirName().value();
+    const int dir_wd = _inotify_fd < 0 ? -1
+        : inotify_add_watch(_inotify_fd, dirname.c_str(), kDirEvents);
+    if (_inotify_fd < 0 || _stop_fd < 0 || dir_wd < 0) {
+        SetErrorMessage(std::string("Fail to watch ") + dirname + ":" + strerror(errno));
+        Stop();
+        return false;
+    }
+    _dir_names[dir_wd].insert(path.BaseName().value());
+    _file_wd = inotify_add_watch(_inotify_fd, _filename.c_str(), WatchedEvents(_filename));
+
+    // The files included are only known after the first load,
+    // which then checks them again, see WatchIncludes.
+    HashFile(_filename, _includes, _content_hash);
+    std::string err_msg;
+    if (!LoadFresh(err_msg)) {
+        SetErrorMessage(err_msg);
+        Stop();
+        return false;
+    }
+    SetErrorMessage(std::string());
+
+    _thread = std::thread(&PbConfWatcher::Run, this);
+    return true;
+}
+
+void PbConfWatcher::Stop() {
+    if (_thread.joinable()) {
+        uint64_t one = 1;
+        while (write(_stop_fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+        }
+        _thread.join();
+    }
+    if (_inotify_fd >= 0) {
+        close(_inotify_fd);
+        _inotify_fd = -1;
+    }
+    if (_stop_fd >= 0) {
+        close(_stop_fd);
+        _stop_fd = -1;
+    }
+    _file_wd = -1;
+    _dir_names.clear();
+    _include_wds.clear();
+    _includes.clear();
+    _recheck = false;
+}
+
+void PbConfWatcher::Run() {
+    alignas(struct inotify_event) char buf[4096];
+    bool pending = false;
+    Clock::time_point deadline;
+
+    while (true) {
+        if (_recheck) {
+            _recheck = false;
+            pending = true;
+            deadline = Clock::now() + std::chrono::milliseconds(_debounce_ms);
+        }
+        int timeout_ms = -1;
+        if (pending) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - Clock::now()).count();
+            timeout_ms = left > 0 ? static_cast<int>(left) : 0;
+        }
+
+        struct pollfd fds[2] = {{_inotify_fd, POLLIN, 0}, {_stop_fd, POLLIN, 0}};
+        int n = poll(fds, 2, timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            SetErrorMessage(std::string("Fail to poll:") + strerror(errno));
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+
+        if (fds[0].revents != 0) {
+            ssize_t len;
+            while ((len = read(_inotify_fd, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + len;) {
+                    auto* event = reinterpret_cast<struct inotify_event*>(p);
+                    auto dir = _dir_names.find(event->wd);
+                    if (event->wd == _file_wd || _include_wds.count(event->wd) != 0
+                            || (dir != _dir_names.end() && Concerns(event, dir->second))) {
+                        // Every further event restarts the debounce.
+                        pending = true;
+                        deadline = Clock::now() + std::chrono::milliseconds(_debounce_ms);
+                    }
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            continue;
+        }
+
+        if (pending && Clock::now() >= deadline) {
+            pending = false;
+            // The path may lead to another file by now, follow it again.
+            int wd = inotify_add_watch(_inotify_fd, _filename.c_str(), WatchedEvents(_filename));
+            if (wd != _file_wd && _file_wd >= 0) {
+                inotify_rm_watch(_inotify_fd, _file_wd);
+            }
+            _file_wd = wd;
+            Reload();
+        }
+    }
+}
+
+void PbConfWatcher::Reload() {
+    uint64_t content_hash[2];
+    // Missing in the middle of a swap, the next event brings it back.
+    if (!HashFile(_filename, _includes, content_hash)) {
+        return;
+    }
+    if (memcmp(content_hash, _content_hash, sizeof(content_hash)) == 0) {
+        return;
+    }
+    // Remember broken content as well, not to parse it again and again.
+    memcpy(_content_hash, content_hash, sizeof(content_hash));
+
+    std::string err_msg;
+    if (!LoadFresh(err_msg)) {
+        SetErrorMessage(err_msg);
+        return;
+    }
+    SetErrorMessage(std::string());
+    if (_callback) {
+        _callback(Get());
+    }
+    if (_notifier && !_state->ChangedPaths().empty()) {
+        _notifier->Notify(Get(), _state->ChangedPaths());
+    }
+}
+
+bool PbConfWatcher::LoadFresh(std::string& err_msg) {
+    PbConf conf = _conf;
+    const bool ok = conf.Load(*_state);
+    // Even a failed load tells what is included, to follow the fix.
+    WatchIncludes();
+    if (!ok) {
+        err_msg = conf.ErrorMessage();
+        return false;
+    }
+    std::atomic_store(&_current, _state->Current());
+    return true;
+}
+
+void PbConfWatcher::WatchIncludes() {
+    std::vector<std::string> files;
+    if (!ListFiles(_filename, &files)) {
+        return;
+    }
+    std::vector<std::string> includes;
+    for (const auto& file : files) {
+        std::vector<std::string> included = _conf._include_cache->Includes(file);
+        includes.insert(includes.end(), included.begin(), included.end());
+    }
+    std::sort(includes.begin(), includes.end());
+    includes.erase(std::unique(includes.begin(), includes.end()), includes.end());
+
+    // Watched again each time, as they may be other files by now.
+    // Watches are only added to, the conf file may share them.
+    for (const auto& include : includes) {
+        const butil::FilePath path(include);
+        const int dir_wd = inotify_add_watch(_inotify_fd, path.DirName().value().c_str(),
+                kDirEvents | IN_MASK_ADD);
+        if (dir_wd >= 0) {
+            _dir_names[dir_wd].insert(path.BaseName().value());
+        }
+        const int wd = inotify_add_watch(_inotify_fd, include.c_str(), kFileEvents | IN_MASK_ADD);
+        if (wd >= 0) {
+            _include_wds.insert(wd);
+        }
+    }
+
+    // The content hash covered other files, and the new ones may have
+    // changed before they were watched: check them once more.
+    if (includes != _includes) {
+        _includes.swap(includes);
+        _recheck = true;
+    }
+}
+
+void PbConfWatcher::SetErrorMessage(const std::string& err_msg) {
+    std::lock_guard<std::mutex> guard(_error_mutex);
+    _error_msg = err_msg;
+}
+
+}
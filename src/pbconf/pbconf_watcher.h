@@ -0,0 +1,144 @@
+#ifndef PBCONF_WATCHER_H
+#define PBCONF_WATCHER_H
+
+#include <atomic>
+#include <functional>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "change_notifier.h"
+#include "include_cache.h"
+#include "incremental_state.h"
+#include "message_allocator.h"
+#include "pbconf.h"
+
+namespace pbconf {
+
+// Keeps a conf loaded by PbConf up to date with its conf file.
+//
+// One background thread follows the conf file and its parent directory
+// through inotify, so that edits in place, renames over the file and
+// symlink swaps as done for Kubernetes ConfigMaps are all noticed.
+// Bursts of events are debounced, and the conf file is only loaded
+// again when its content changed. Each reload fills a fresh message,
+// which is published only if the whole load succeeded.
+// Yaml conf files are reloaded incrementally, see IncrementalState.
+// A conf.d directory is followed with its fragments, see PbConf.
+// The files hocon conf files include are followed as well, as the
+// IncludeCache the conf files are parsed through tells them, the one
+// of the PbConf if set, otherwise one of the watcher's own.
+class PbConfWatcher final {
+public:
+    typedef std::function<void(const std::shared_ptr<const ::google::protobuf::Message>&)>
+        Callback;
+
+    // `conf' gives the filename and the load options.
+    explicit PbConfWatcher(const PbConf& conf) : _conf(conf) {
+    }
+
+    PbConfWatcher(const PbConfWatcher&) = delete;
+    PbConfWatcher& operator=(const PbConfWatcher&) = delete;
+
+    ~PbConfWatcher() {
+        Stop();
+    }
+
+    // Wait for the conf file to be quiet for `debounce_ms'
+    // before loading it again. Defaults to 100ms.
+    PbConfWatcher& SetDebounceMs(int debounce_ms) {
+        _debounce_ms = debounce_ms;
+        return *this;
+    }
+
+    // Called on the background thread with each newly published conf.
+    PbConfWatcher& SetCallback(Callback callback) {
+        _callback = std::move(callback);
+        return *this;
+    }
+
+    // Notify `notifier' of the paths each reload changed,
+    // after the callback. The notifier must outlive the watcher.
+    PbConfWatcher& SetChangeNotifier(ChangeNotifier* notifier) {
+        _notifier = notifier;
+        return *this;
+    }
+
+    // Take the messages reloads fill from `allocator',
+    // see MessageAllocator. The allocator must outlive the watcher.
+    PbConfWatcher& SetMessageAllocator(MessageAllocator* allocator) {
+        _allocator = allocator;
+        return *this;
+    }
+
+    // Load the conf into a new message of the prototype's type,
+    // then start watching the conf file.
+    // Returns True if success; otherwise False.
+    bool Start(const ::google::protobuf::Message& prototype);
+
+    // Stop watching, the last published conf stays available.
+    void Stop();
+
+    // The last successfully loaded conf, nullptr before Start.
+    std::shared_ptr<const ::google::protobuf::Message> Get() const {
+        return std::atomic_load(&_current);
+    }
+
+    // Why the last load failed, empty if it succeeded.
+    std::string ErrorMessage() const {
+        std::lock_guard<std::mutex> guard(_error_mutex);
+        return _error_msg;
+    }
+
+private:
+    void Run();
+    // Load the conf file again if its content changed.
+    void Reload();
+    // Load the conf file into a fresh message and publish it.
+    bool LoadFresh(std::string& err_msg);
+    // Follow the files the last load included.
+    void WatchIncludes();
+    void SetErrorMessage(const std::string& err_msg);
+
+    PbConf _conf;
+    std::string _filename;
+    int _debounce_ms = 100;
+    Callback _callback;
+    ChangeNotifier* _notifier = nullptr;
+    MessageAllocator* _allocator = nullptr;
+    // Reloads only convert what changed since the last load.
+    std::unique_ptr<IncrementalState> _state;
+
+    std::shared_ptr<const ::google::protobuf::Message> _current;
+    // Of the conf file and the files in _includes.
+    uint64_t _content_hash[2] = {0, 0};
+
+    // Used when the PbConf has no IncludeCache.
+    std::unique_ptr<IncludeCache> _include_cache;
+    // The files the conf files included at the last load.
+    std::vector<std::string> _includes;
+    // Set when _includes changed, to check them once they are watched.
+    bool _recheck = false;
+
+    mutable std::mutex _error_mutex;
+    std::string _error_msg;
+
+    int _inotify_fd = -1;
+    int _stop_fd = -1;
+    int _file_wd = -1;
+    // The directories watched, with the names of their entries followed.
+    std::unordered_map<int, std::unordered_set<std::string>> _dir_names;
+    // The included files watched.
+    std::unordered_set<int> _include_wds;
+    std::thread _thread;
+};
+
+}
+
+#endif
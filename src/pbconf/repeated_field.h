@@ -0,0 +1,78 @@
+#ifndef REPEATED_FIELD_H
+#define REPEATED_FIELD_H
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/repeated_field.h>
+#include <string>
+
+namespace pbconf {
+
+// Typed access to the repeated field `field' of `msg',
+// so that a list is filled in one pass: reserve once,
+// then append without a reflection call per element.
+// MutableRepeatedFieldRef has no Reserve(), hence the typed accessors,
+// which protobuf still supports but marks as deprecated.
+template <typename T>
+struct RepeatedOf {
+    typedef ::google::protobuf::RepeatedField<T> Type;
+
+    static Type* Mutable(
+            ::google::protobuf::Message& msg,
+            const ::google::protobuf::FieldDescriptor* field) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+        return msg.GetReflection()->MutableRepeatedField<T>(&msg, field);
+#pragma GCC diagnostic pop
+    }
+};
+
+template <>
+struct RepeatedOf<std::string> {
+    typedef ::google::protobuf::RepeatedPtrField<std::string> Type;
+
+    static Type* Mutable(
+            ::google::protobuf::Message& msg,
+            const ::google::protobuf::FieldDescriptor* field) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+        return msg.GetReflection()->MutableRepeatedPtrField<std::string>(
+                &msg, field);
+#pragma GCC diagnostic pop
+    }
+};
+
+// Messages, including the entries of map fields, which protobuf keeps
+// in a repeated field until the map is accessed. Elements are added
+// through Reflection::AddMessage(), which knows their type.
+template <>
+struct RepeatedOf<::google::protobuf::Message> {
+    typedef ::google::protobuf::RepeatedPtrField<::google::protobuf::Message> Type;
+
+    static Type* Mutable(
+            ::google::protobuf::Message& msg,
+            const ::google::protobuf::FieldDescriptor* field) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+        return msg.GetReflection()->MutableRepeatedPtrField<::google::protobuf::Message>(
+                &msg, field);
+#pragma GCC diagnostic pop
+    }
+};
+
+// Returns the repeated field with room for `size' more elements.
+template <typename T>
+inline typename RepeatedOf<T>::Type* MutableRepeated(
+        ::google::protobuf::Message& msg,
+        const ::google::protobuf::FieldDescriptor* field,
+        size_t size = 0) {
+    typename RepeatedOf<T>::Type* values = RepeatedOf<T>::Mutable(msg, field);
+    if (size > 0) {
+        values->Reserve(values->size() + static_cast<int>(size));
+    }
+    return values;
+}
+
+}
+
+#endif
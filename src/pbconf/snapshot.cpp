@@ -0,0 +1,51 @@
+#include "snapshot.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pbconf {
+
+namespace {
+
+class Releaser final {
+public:
+    Releaser() {
+        std::thread(&Releaser::Run, this).detach();
+    }
+
+    void Push(std::shared_ptr<const void> ptr) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _pending.push_back(std::move(ptr));
+        _cond.notify_one();
+    }
+
+private:
+    void Run() {
+        std::vector<std::shared_ptr<const void>> releasing;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cond.wait(lock, [this] { return !_pending.empty(); });
+                releasing.swap(_pending);
+            }
+            releasing.clear();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::vector<std::shared_ptr<const void>> _pending;
+};
+
+}
+
+void ReleaseInBackground(std::shared_ptr<const void> ptr) {
+    // Never destroyed, the thread runs as long as the process.
+    static Releaser* releaser = new Releaser();
+    releaser->Push(std::move(ptr));
+}
+
+}
@@ -0,0 +1,133 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <butil/containers/doubly_buffered_data.h>
+#include <memory>
+#include <stddef.h>
+
+#include "message_allocator.h"
+#include "pbconf.h"
+#include "pbconf_watcher.h"
+
+namespace pbconf {
+
+// Release `ptr' on the background thread shared by all snapshots,
+// so that the last reader of a conf never pays for freeing it.
+void ReleaseInBackground(std::shared_ptr<const void> ptr);
+
+// The current conf of type T, for threads reading it on hot paths.
+//
+// The conf is kept behind butil::DoublyBufferedData: reads only take
+// a thread-local lock that publishing contends for, never a shared one,
+// and touch no shared reference count. Replaced confs are freed on
+// a background thread, even when a reader holds the last reference.
+template <typename T>
+class Snapshot final {
+public:
+    typedef std::shared_ptr<const T> Ptr;
+
+private:
+    typedef butil::DoublyBufferedData<Ptr> Data;
+
+public:
+    // Pins the conf read by Read. Publishing waits for it to be
+    // released, so do not keep it beyond the current request.
+    class ReadPtr final {
+    public:
+        // nullptr before the first Publish.
+        const T* get() const {
+            return _ptr->get();
+        }
+        const T& operator*() const {
+            return **_ptr;
+        }
+        const T* operator->() const {
+            return get();
+        }
+
+    private:
+        friend class Snapshot;
+        typename Data::ScopedPtr _ptr;
+    };
+
+    Snapshot() = default;
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    // Read the current conf into `ptr'.
+    // Returns True if success; otherwise False.
+    bool Read(ReadPtr* ptr) const {
+        return _data.Read(&ptr->_ptr) == 0;
+    }
+
+    // A reference to the current conf, to keep it longer than a ReadPtr.
+    Ptr Get() const {
+        ReadPtr ptr;
+        if (!Read(&ptr)) {
+            return Ptr();
+        }
+        return *ptr._ptr;
+    }
+
+    // Make `conf' the current conf.
+    // The previous one is freed once its last reader is done.
+    void Publish(Ptr conf) {
+        if (conf) {
+            // Hand the conf over to the background thread
+            // when the last reference to it goes away.
+            const T* raw = conf.get();
+            conf = Ptr(raw, Release{std::move(conf)});
+        }
+        _data.Modify(Assign, conf);
+    }
+
+    // Load a fresh conf through `conf' and publish it.
+    // Returns True if success; otherwise False,
+    // with the error in conf.ErrorMessage().
+    bool Load(PbConf& conf) {
+        std::shared_ptr<T> fresh(new T());
+        if (!conf.Load(*fresh)) {
+            return false;
+        }
+        Publish(std::move(fresh));
+        return true;
+    }
+
+    // Same as above, loading into a message from `allocator',
+    // which must hand out messages of type T.
+    bool Load(PbConf& conf, MessageAllocator& allocator) {
+        std::shared_ptr<::google::protobuf::Message> fresh = allocator.New();
+        if (!conf.Load(*fresh)) {
+            return false;
+        }
+        Publish(std::static_pointer_cast<const T>(fresh));
+        return true;
+    }
+
+    // A callback publishing each conf loaded by a PbConfWatcher
+    // started with a T prototype. The snapshot must outlive the watcher.
+    PbConfWatcher::Callback PublishCallback() {
+        return [this](const std::shared_ptr<const ::google::protobuf::Message>& msg) {
+            Publish(std::static_pointer_cast<const T>(msg));
+        };
+    }
+
+private:
+    struct Release {
+        std::shared_ptr<const void> owner;
+        void operator()(const T*) {
+            ReleaseInBackground(std::move(owner));
+        }
+    };
+
+    static size_t Assign(Ptr& bg, const Ptr& conf) {
+        bg = conf;
+        return 1;
+    }
+
+    mutable Data _data;
+};
+
+}
+
+#endif
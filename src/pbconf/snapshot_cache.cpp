@@ -0,0 +1,314 @@
+#include "snapshot_cache.h"
+
+#include <butil/strings/string_util.h>
+#include <butil/third_party/murmurhash3/murmurhash3.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/message.h>
+#include <limits.h>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "load_plan.h"
+
+namespace pbconf {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using FileDescriptor = ::google::protobuf::FileDescriptor;
+using FileDescriptorProto = ::google::protobuf::FileDescriptorProto;
+using Message = ::google::protobuf::Message;
+
+namespace {
+
+const char kMagic[8] = {'P', 'B', 'C', 'O', 'N', 'F', 'S', '1'};
+const uint32_t kHashSeed = 0x70626366;
+
+// Integers are stored in host byte order,
+// a snapshot is only meant for the host that wrote it.
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint64_t content_hash[2];
+    uint64_t descriptor_fingerprint[2];
+    uint64_t options;
+    uint64_t payload_size;
+    uint64_t payload_hash[2];
+};
+
+// Files larger than INT_MAX are not hashed, and thus never cached.
+bool Hash(const void* data, size_t size, uint64_t out[2]) {
+    if (size > INT_MAX) {
+        return false;
+    }
+    MurmurHash3_x64_128(data, static_cast<int>(size), kHashSeed, out);
+    return true;
+}
+
+class MappedFile final {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (_data != nullptr) {
+            munmap(_data, _size);
+        }
+    }
+
+    bool Map(const std::string& filename, struct stat* st) {
+        int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = fstat(fd, st) == 0 && S_ISREG(st->st_mode);
+        if (ok && st->st_size > 0) {
+            void* data = mmap(nullptr, st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ok = false;
+            } else {
+                _data = data;
+                _size = st->st_size;
+            }
+        }
+        close(fd);
+        return ok;
+    }
+
+    const char* data() const {
+        return static_cast<const char*>(_data);
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+private:
+    void* _data = nullptr;
+    size_t _size = 0;
+};
+
+bool ReadSourceKey(const std::string& filename, SnapshotCache::SourceKey* key) {
+    MappedFile source;
+    struct stat st;
+    if (!source.Map(filename, &st)) {
+        return false;
+    }
+    key->size = st.st_size;
+    key->mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    key->cacheable = Hash(source.data(), source.size(), key->content_hash);
+    // A hocon conf file may include other files, which are not part of
+    // the key. Be conservative and skip any file mentioning `include'.
+    if (key->cacheable && EndsWith(filename, ".conf", true)) {
+        static const char kInclude[] = "include";
+        key->cacheable = memmem(source.data(), source.size(),
+                kInclude, sizeof(kInclude) - 1) == nullptr;
+    }
+    return true;
+}
+
+bool SameSource(const SnapshotCache::SourceKey& lhs, const SnapshotCache::SourceKey& rhs) {
+    return lhs.size == rhs.size
+        && lhs.mtime_ns == rhs.mtime_ns
+        && lhs.content_hash[0] == rhs.content_hash[0]
+        && lhs.content_hash[1] == rhs.content_hash[1];
+}
+
+struct Fingerprint {
+    uint64_t hash[2];
+};
+
+// Hash the files defining the message type and all of their
+// dependencies, so that any change of a nested type is noticed.
+// Loads also fill the extensions linked in, see CollectFields, which
+// may be defined in files the type never imports: the extensions of
+// each type loaded are hashed by name and number, with their files.
+Fingerprint ComputeFingerprint(const Descriptor* descriptor) {
+    std::string content = descriptor->full_name();
+    std::vector<const FileDescriptor*> files = {descriptor->file()};
+    std::unordered_set<const FileDescriptor*> seen = {descriptor->file()};
+
+    std::vector<const Descriptor*> types = {descriptor};
+    std::unordered_set<const Descriptor*> seen_types = {descriptor};
+    for (size_t i = 0; i < types.size(); ++i) {
+        // The fields of the load plan, extensions last by number.
+        std::vector<const FieldDescriptor*> fields;
+        CollectFields(types[i], fields);
+        for (const FieldDescriptor* field : fields) {
+            if (field->is_extension()) {
+                content.append(1, '\n').append(field->full_name())
+                    .append(1, '=').append(std::to_string(field->number()));
+                if (seen.insert(field->file()).second) {
+                    files.push_back(field->file());
+                }
+            }
+            const Descriptor* type = field->message_type();
+            if (type && seen_types.insert(type).second) {
+                types.push_back(type);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        FileDescriptorProto proto;
+        files[i]->CopyTo(&proto);
+        proto.AppendToString(&content);
+        for (int j = 0; j < files[i]->dependency_count(); ++j) {
+            const FileDescriptor* dependency = files[i]->dependency(j);
+            if (seen.insert(dependency).second) {
+                files.push_back(dependency);
+            }
+        }
+    }
+
+    Fingerprint fingerprint = {{0, 0}};
+    Hash(content.data(), content.size(), fingerprint.hash);
+    return fingerprint;
+}
+
+Fingerprint DescriptorFingerprint(const Descriptor* descriptor) {
+    static std::mutex* mutex = new std::mutex();
+    static auto* fingerprints = new std::unordered_map<const Descriptor*, Fingerprint>();
+
+    std::lock_guard<std::mutex> guard(*mutex);
+    auto found = fingerprints->find(descriptor);
+    if (found == fingerprints->end()) {
+        found = fingerprints->emplace(descriptor, ComputeFingerprint(descriptor)).first;
+    }
+    return found->second;
+}
+
+void FillHeader(
+        const SnapshotCache::SourceKey& key,
+        const Descriptor* descriptor,
+        uint64_t options,
+        SnapshotHeader* header) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, kMagic, sizeof(kMagic));
+    header->source_size = key.size;
+    header->source_mtime_ns = key.mtime_ns;
+    header->content_hash[0] = key.content_hash[0];
+    header->content_hash[1] = key.content_hash[1];
+    Fingerprint fingerprint = DescriptorFingerprint(descriptor);
+    header->descriptor_fingerprint[0] = fingerprint.hash[0];
+    header->descriptor_fingerprint[1] = fingerprint.hash[1];
+    header->options = options;
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t nw = write(fd, data, size);
+        if (nw < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += nw;
+        size -= nw;
+    }
+    return true;
+}
+
+}
+
+SnapshotCache::SnapshotCache(const std::string& filename, uint64_t options)
+    : _filename(filename), _cache_filename(filename + ".pbcache"), _options(options) {
+}
+
+bool SnapshotCache::Load(Message& msg) {
+    if (!ReadSourceKey(_filename, &_key) || !_key.cacheable) {
+        return false;
+    }
+
+    MappedFile snapshot;
+    struct stat st;
+    if (!snapshot.Map(_cache_filename, &st) || snapshot.size() < sizeof(SnapshotHeader)) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    SnapshotHeader expected;
+    memcpy(&header, snapshot.data(), sizeof(header));
+    FillHeader(_key, msg.GetDescriptor(), _options, &expected);
+    // Everything but the payload must match.
+    if (memcmp(&header, &expected, offsetof(SnapshotHeader, payload_size)) != 0) {
+        return false;
+    }
+
+    const char* payload = snapshot.data() + sizeof(header);
+    const size_t payload_size = snapshot.size() - sizeof(header);
+    uint64_t payload_hash[2];
+    if (header.payload_size != payload_size
+            || !Hash(payload, payload_size, payload_hash)
+            || payload_hash[0] != header.payload_hash[0]
+            || payload_hash[1] != header.payload_hash[1]) {
+        return false;
+    }
+
+    // Parse in place when nothing has to be merged, as is usual.
+    if (msg.ByteSizeLong() == 0) {
+        if (msg.ParseFromArray(payload, static_cast<int>(payload_size))) {
+            return true;
+        }
+        msg.Clear();
+        return false;
+    }
+    std::unique_ptr<Message> loaded(msg.New());
+    if (!loaded->ParseFromArray(payload, static_cast<int>(payload_size))) {
+        return false;
+    }
+    msg.MergeFrom(*loaded);
+    return true;
+}
+
+void SnapshotCache::Store(const Message& msg) {
+    // The conf file may have changed while it was being loaded.
+    SourceKey key;
+    if (!_key.cacheable || !ReadSourceKey(_filename, &key) || !SameSource(key, _key)) {
+        return;
+    }
+
+    std::string payload;
+    if (!msg.SerializeToString(&payload)) {
+        return;
+    }
+    SnapshotHeader header;
+    FillHeader(_key, msg.GetDescriptor(), _options, &header);
+    header.payload_size = payload.size();
+    if (!Hash(payload.data(), payload.size(), header.payload_hash)) {
+        return;
+    }
+
+    // Every writer renames its own file into place,
+    // readers see either the old snapshot or a complete new one.
+    std::string tmp_filename = _cache_filename + ".XXXXXX";
+    int fd = mkstemp(&tmp_filename[0]);
+    if (fd < 0) {
+        return;
+    }
+    bool ok = fchmod(fd, 0644) == 0
+        && WriteAll(fd, reinterpret_cast<const char*>(&header), sizeof(header))
+        && WriteAll(fd, payload.data(), payload.size());
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp_filename.c_str(), _cache_filename.c_str()) != 0) {
+        unlink(tmp_filename.c_str());
+    }
+}
+
+}
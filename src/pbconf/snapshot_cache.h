@@ -0,0 +1,53 @@
+#ifndef SNAPSHOT_CACHE_H
+#define SNAPSHOT_CACHE_H
+
+#include <google/protobuf/message.h>
+#include <stdint.h>
+#include <string>
+
+namespace pbconf {
+
+// A binary snapshot of a loaded conf file, stored next to it as
+// `<filename>.pbcache'. The snapshot is keyed by the size, mtime and
+// content hash of the conf file, the fingerprint of the message type
+// (including the files it depends on and the extensions linked in)
+// and the load options, so that a stale or incompatible snapshot is
+// never used.
+//
+// Snapshots are written to a temporary file and renamed into place,
+// so processes racing to rebuild one never see a partial snapshot.
+// Failing to read or write a snapshot is not an error:
+// the conf file is simply loaded again.
+class SnapshotCache final {
+public:
+    // `options' holds the load options that change the loaded message.
+    SnapshotCache(const std::string& filename, uint64_t options);
+
+    // Load msg from the snapshot of the conf file.
+    // Returns True if the snapshot matched; otherwise False,
+    // leaving msg untouched.
+    bool Load(::google::protobuf::Message& msg);
+
+    // Store msg, just loaded from the conf file, as its snapshot.
+    // Nothing is stored if the conf file changed since Load,
+    // or if it cannot be cached at all.
+    void Store(const ::google::protobuf::Message& msg);
+
+    // The key of the conf file, see Load.
+    struct SourceKey {
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        uint64_t content_hash[2] = {0, 0};
+        bool cacheable = false;
+    };
+
+private:
+    std::string _filename;
+    std::string _cache_filename;
+    uint64_t _options;
+    SourceKey _key;
+};
+
+}
+
+#endif
@@ -1,11 +1,32 @@
 #include "yaml_conf.h"
 
+#include <algorithm>
+#include <atomic>
 #include <boost/exception/diagnostic_information.hpp> 
+#include <bthread/bthread.h>
+#include <butil/file_util.h>
+#include <butil/files/file_path.h>
 #include <butil/strings/stringprintf.h>
+#include <fstream>
 #include <google/protobuf/message.h>
+#include <memory>
+#include <stdint.h>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <yaml-cpp/eventhandler.h>
 #include <yaml-cpp/yaml.h>
 
+#include "generated_loader.h"
+#include "incremental_state.h"
+#include "lazy_fields.h"
+#include "load_mask.h"
+#include "load_metrics.h"
+#include "load_plan.h"
+#include "map_field.h"
+#include "repeated_field.h"
+
 namespace pbconf {
 
 using Descriptor = ::google::protobuf::Descriptor;
@@ -16,40 +37,93 @@ using Node = YAML::Node;
 using Reflection = ::google::protobuf::Reflection;
 using string = std::string;
 
+using FieldPlan = ::pbconf::BasicFieldPlan<const Node&>;
+using LoadPlan = ::pbconf::BasicLoadPlan<const Node&>;
+
 static bool OnNode(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg);
+
+// Where OnMap leaves the lazy fields of the root message.
+struct LazySink {
+    LazyFields* fields;
+    bool ignore_enum_case;
+    bool use_generated;
+    // The text of the document after its byte order mark,
+    // if known and in block style, as positioned by YAML::Mark.
+    const char* text;
+    size_t text_size;
+    // Where the keys of the root map start in `text', in order.
+    std::vector<size_t> key_positions;
+};
+
+static void Defer(
+        const Node& key,
+        const Node& value,
+        const FieldPlan& plan,
+        const LazySink& lazy);
+
+static bool OnMaskedMessage(
+        const Node& node,
+        const FieldPlan& plan,
+        const LoadMask& mask,
         Message& parent_msg,
         string& err_msg);
 
-static bool OnMap(const Node& node, Message& msg, string& err_msg) {
+static bool OnMap(
+        const Node& node,
+        const LoadPlan& plan,
+        Message& msg,
+        string& err_msg,
+        const LazySink* lazy = nullptr,
+        const LoadMask* mask = nullptr) {
     if (!node.IsMap()) {
         return false;
     }
 
-    const Descriptor* descriptor = msg.GetDescriptor();
-    const Reflection* reflection = msg.GetReflection();
+    // Walk the keys of the map once,
+    // resolving each of them through the plan's name index.
+    PresenceBitmap present(plan.fields.size());
+    for (auto citr = node.begin(); citr != node.end(); ++citr) {
+        // citr-> would point into a temporary, dereference once instead.
+        const auto entry = *citr;
+        const Node& key = entry.first;
+        const Node& value = entry.second;
+        if (!key.IsScalar()) {
+            continue;
+        }
+        int pos = plan.index.Find(key.Scalar());
+        // Not in the schema, or a null value which is the same as a missing one.
+        if (pos < 0 || value.IsNull()) {
+            continue;
+        }
+        // Not in the mask.
+        if (mask && !mask->Contains(pos)) {
+            continue;
+        }
 
-    // Collect all field descriptors of msg,
-    // including the normal and extended fields.
-    std::vector<const FieldDescriptor*> fields;
-    for (int i = 0; i < descriptor->field_count(); ++i) {
-        fields.push_back(descriptor->field(i));
-    }
-    for (int i = 0; i < descriptor->extension_range_count(); ++i) {
-        auto range = descriptor->extension_range(i);
-        for (int tag = range->start; tag < range->end; ++tag) {
-            auto field = reflection->FindKnownExtensionByNumber(tag);
-            if (field) {
-                fields.push_back(field);
+        present.Set(pos);
+        if (lazy && lazy->fields->IsLazy(plan.fields[pos].field)) {
+            Defer(key, value, plan.fields[pos], *lazy);
+            continue;
+        }
+        const LoadMask* child_mask = mask ? mask->Child(pos) : nullptr;
+        if (child_mask) {
+            if (!OnMaskedMessage(value, plan.fields[pos], *child_mask, msg, err_msg)) {
+                return false;
             }
+        } else if (!OnNode(value, plan.fields[pos], msg, err_msg)) {
+            return false;
         }
     }
 
-    // Convert each sub-node.
-    for (auto field : fields) {
-        auto& field_node = node[field->name()];
-        if (!OnNode(field_node, field, msg, err_msg)) {
+    // Missing the required field
+    for (auto pos : mask ? mask->Required() : plan.required) {
+        if (!present.Test(pos)) {
+            butil::StringAppendF(&err_msg, "Field is required:%s",
+                    plan.fields[pos].field->full_name().c_str());
             return false;
         }
     }
@@ -57,24 +131,21 @@ static bool OnMap(const Node& node, Message& msg, string& err_msg) {
     return true;
 }
 
-static inline bool OnRootNode(const Node& node, Message& msg, string& err_msg) {
-    // Root node is a map
-    return OnMap(node, msg, err_msg);
-}
-
-template <typename T>
-static bool OnNodeFor(
+static inline bool OnRootNode(
         const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    return false;
+        const LoadPlan& plan,
+        Message& msg,
+        string& err_msg,
+        const LazySink* lazy = nullptr,
+        const LoadMask* mask = nullptr) {
+    // Root node is a map
+    return OnMap(node, plan, msg, err_msg, lazy, mask);
 }
 
 template <typename T>
 static bool OnNodeForSingle(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     return false;
@@ -83,7 +154,7 @@ static bool OnNodeForSingle(
 template <typename T>
 static bool OnNodeForRepeated(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     return false;
@@ -108,9 +179,10 @@ inline bool get<int32_t>(const Node& node, int32_t& value) {
 template <>
 inline bool OnNodeForSingle<int32_t>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     int32_t value{0};
     if (!get(node, value)) {
         return false;
@@ -123,35 +195,21 @@ inline bool OnNodeForSingle<int32_t>(
 template <>
 inline bool OnNodeForRepeated<int32_t>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<int32_t>(
+            parent_msg, plan.field, node.size());
 
     int32_t value{0};
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddInt32(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<int32_t>(
-        const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<int32_t>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<int32_t>(node, field, parent_msg, err_msg);
-    }
-}
 // End int32_t
 
 // Begin uint32_t
@@ -168,9 +226,10 @@ inline bool get<uint32_t>(const Node& node, uint32_t& value) {
 template <>
 inline bool OnNodeForSingle<uint32_t>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     uint32_t value{0};
     if (!get(node, value)) {
         return false;
@@ -183,35 +242,21 @@ inline bool OnNodeForSingle<uint32_t>(
 template <>
 inline bool OnNodeForRepeated<uint32_t>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<uint32_t>(
+            parent_msg, plan.field, node.size());
 
     uint32_t value{0};
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddUInt32(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<uint32_t>(
-        const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<uint32_t>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<uint32_t>(node, field, parent_msg, err_msg);
-    }
-}
 // End uint32_t
 
 // Begin int64_t
@@ -228,9 +273,10 @@ inline bool get<int64_t>(const Node& node, int64_t& value) {
 template <>
 inline bool OnNodeForSingle<int64_t>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     int64_t value{0};
     if (!get(node, value)) {
         return false;
@@ -243,35 +289,21 @@ inline bool OnNodeForSingle<int64_t>(
 template <>
 inline bool OnNodeForRepeated<int64_t>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<int64_t>(
+            parent_msg, plan.field, node.size());
 
     int64_t value{0};
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddInt64(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<int64_t>(
-        const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<int64_t>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<int64_t>(node, field, parent_msg, err_msg);
-    }
-}
 // End int64_t
 
 // Begin uint64_t
@@ -288,9 +320,10 @@ inline bool get<uint64_t>(const Node& node, uint64_t& value) {
 template <>
 inline bool OnNodeForSingle<uint64_t>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     uint64_t value{0};
     if (!get(node, value)) {
         return false;
@@ -303,35 +336,21 @@ inline bool OnNodeForSingle<uint64_t>(
 template <>
 inline bool OnNodeForRepeated<uint64_t>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<uint64_t>(
+            parent_msg, plan.field, node.size());
 
     uint64_t value{0};
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddUInt64(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<uint64_t>(
-        const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<uint64_t>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<uint64_t>(node, field, parent_msg, err_msg);
-    }
-}
 // End uint64_t
 
 // Begin bool
@@ -348,9 +367,10 @@ inline bool get<bool>(const Node& node, bool& value) {
 template <>
 inline bool OnNodeForSingle<bool>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     bool value{false};
     if (!get(node, value)) {
         butil::StringAppendF(&err_msg, "Expect boolean value at:%s",
@@ -365,35 +385,21 @@ inline bool OnNodeForSingle<bool>(
 template <>
 inline bool OnNodeForRepeated<bool>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<bool>(
+            parent_msg, plan.field, node.size());
 
     bool value{false};
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddBool(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<bool>(
-        const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<bool>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<bool>(node, field, parent_msg, err_msg);
-    }
-}
 // End bool
 
 // Begin float
@@ -410,9 +416,10 @@ inline bool get<float>(const Node& node, float& value) {
 template <>
 inline bool OnNodeForSingle<float>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     float value{0.};
     if (!get(node, value)) {
         butil::StringAppendF(&err_msg, "Expect float value at:%s",
@@ -427,35 +434,21 @@ inline bool OnNodeForSingle<float>(
 template <>
 inline bool OnNodeForRepeated<float>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<float>(
+            parent_msg, plan.field, node.size());
 
     float value{0.};
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddFloat(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<float>(
-        const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<float>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<float>(node, field, parent_msg, err_msg);
-    }
-}
 // End float
 
 // Begin double
@@ -472,9 +465,10 @@ inline bool get<double>(const Node& node, double& value) {
 template <>
 inline bool OnNodeForSingle<double>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     double value{0.};
     if (!get(node, value)) {
         butil::StringAppendF(&err_msg, "Expect double value at:%s",
@@ -489,40 +483,32 @@ inline bool OnNodeForSingle<double>(
 template <>
 inline bool OnNodeForRepeated<double>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<double>(
+            parent_msg, plan.field, node.size());
 
     double value{0.};
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
         if (!get(*citr, value)) {
             return false;
         }
-        reflection->AddDouble(&parent_msg, field, value);
+        values->Add(value);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<double>(
-        const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
-
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<double>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<double>(node, field, parent_msg, err_msg);
-    }
-}
 // End double
 
 // Begin string
+// Scalars are assigned in place, into the capacity `value' has,
+// instead of through the temporary as<string>() returns.
 template <>
 inline bool get<string>(const Node& node, string& value) {
+    if (node.IsScalar()) {
+        value.assign(node.Scalar());
+        return true;
+    }
     try {
         value = node.as<string>();
         return true;
@@ -534,131 +520,108 @@ inline bool get<string>(const Node& node, string& value) {
 template <>
 inline bool OnNodeForSingle<string>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     string value;
     if (!get(node, value)) {
-        butil::StringAppendF(&err_msg, "Expect double value at:%s",
+        butil::StringAppendF(&err_msg, "Expect string value at:%s",
                 field->full_name().c_str());
         return false;
     }
+    // Reflection has no mutable string, hand the only copy over.
     const Reflection* reflection = parent_msg.GetReflection();
-    reflection->SetString(&parent_msg, field, value);
+    reflection->SetString(&parent_msg, field, std::move(value));
     return true;
 }
 
 template <>
 inline bool OnNodeForRepeated<string>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+    auto values = MutableRepeated<string>(
+            parent_msg, plan.field, node.size());
 
-    string value;
+    // Straight into the new element, which reuses a cleared one if any.
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
-        if (!get(*citr, value)) {
+        if (!get(*citr, *values->Add())) {
+            values->RemoveLast();
             return false;
         }
-        reflection->AddString(&parent_msg, field, value);
     }
     return true;
 }
+// End string
 
-template <>
-inline bool OnNodeFor<string>(
+// Begin enum
+enum DummyEnum {};
+
+// Names are tried first: they are matched straight on the scalar,
+// while a failed as<int32_t>() costs an exception.
+static const EnumValueDescriptor* GetEnum(
         const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    const Reflection* reflection = parent_msg.GetReflection();
+        const EnumTable& table,
+        bool ignore_case) {
+    if (!node.IsScalar()) {
+        return nullptr;
+    }
+    const string& literal = node.Scalar();
+    const EnumValueDescriptor* enumd = table.FindByName(
+            literal.data(), literal.size(), ignore_case);
 
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<string>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<string>(node, field, parent_msg, err_msg);
+    int32_t value{0};
+    if (!enumd && get<int32_t>(node, value)) {
+        enumd = table.FindByNumber(value);
     }
+    return enumd;
 }
-// End string
 
-// Begin enum
-enum DummyEnum {};
+static inline const EnumValueDescriptor* GetEnum(
+        const Node& node,
+        const FieldPlan& plan) {
+    return GetEnum(node, *plan.enum_table, plan.ignore_enum_case);
+}
 
 template <>
 inline bool OnNodeForSingle<enum DummyEnum>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    const EnumValueDescriptor* enumd = nullptr;
-
-    int32_t value{0};
-    if (get<int32_t>(node, value)) {
-        enumd = field->enum_type()->FindValueByNumber(value);
-    }
-
-    std::string literal;
-    if (!enumd && get<std::string>(node, literal)) {
-        enumd = field->enum_type()->FindValueByName(literal);
-    }
-
+    const EnumValueDescriptor* enumd = GetEnum(node, plan);
     if (!enumd) {
         butil::StringAppendF(&err_msg, "Expect enum value at:%s",
-                field->full_name().c_str());
+                plan.field->full_name().c_str());
         return false;
     }
 
     const Reflection* reflection = parent_msg.GetReflection();
-    reflection->SetEnum(&parent_msg, field, enumd);
+    reflection->SetEnum(&parent_msg, plan.field, enumd);
     return true;
 }
 
 template <>
 inline bool OnNodeForRepeated<enum DummyEnum>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
     const Reflection* reflection = parent_msg.GetReflection();
 
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
-        const EnumValueDescriptor* enumd = nullptr;
-
-        int32_t value{0};
-        if (get<int32_t>(*citr, value)) {
-            enumd = field->enum_type()->FindValueByNumber(value);
-        }
-
-        std::string literal;
-        if (!enumd && get<std::string>(*citr, literal)) {
-            enumd = field->enum_type()->FindValueByName(literal);
-        }
-
+        const EnumValueDescriptor* enumd = GetEnum(*citr, plan);
         if (!enumd) {
             butil::StringAppendF(&err_msg, "Expect enum value at:%s",
-                    field->full_name().c_str());
+                    plan.field->full_name().c_str());
             return false;
         }
-
-        const Reflection* reflection = parent_msg.GetReflection();
-        reflection->AddEnum(&parent_msg, field, enumd);
+        reflection->AddEnum(&parent_msg, plan.field, enumd);
     }
     return true;
 }
-
-template <>
-inline bool OnNodeFor<enum DummyEnum>(
-        const Node& node,
-        const FieldDescriptor* field,
-        Message& parent_msg,
-        string& err_msg) {
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<enum DummyEnum>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<enum DummyEnum>(node, field, parent_msg, err_msg);
-    }
-}
 // End enum
 
 // Begin message
@@ -667,95 +630,1329 @@ class DummyClass {};
 template <>
 inline bool OnNodeForSingle<DummyClass>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     const Reflection* reflection = parent_msg.GetReflection();
 
     Message& child_msg = *(reflection->MutableMessage(&parent_msg, field));
-    return OnMap(node, child_msg, err_msg);
+    return OnMap(node, *plan.message_plan, child_msg, err_msg);
 }
 
 template <>
 inline bool OnNodeForRepeated<DummyClass>(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
+    const FieldDescriptor* field = plan.field;
     const Reflection* reflection = parent_msg.GetReflection();
 
     for (auto citr = node.begin(); citr != node.end(); ++citr) {
         Message& child_msg = *(reflection->AddMessage(&parent_msg, field));
-        if (!OnMap(*citr, child_msg, err_msg)) {
+        if (!OnMap(*citr, *plan.message_plan, child_msg, err_msg)) {
             return false;
         }
     }
     return true;
 }
 
-template <>
-inline bool OnNodeFor<DummyClass>(
+// Convert the message field of `plan', only the fields in `mask'.
+static bool OnMaskedMessage(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
+        const LoadMask& mask,
         Message& parent_msg,
         string& err_msg) {
-    if (field->is_repeated()) {
-        return OnNodeForRepeated<DummyClass>(node, field, parent_msg, err_msg);
-    } else {
-        return OnNodeForSingle<DummyClass>(node, field, parent_msg, err_msg);
+    const FieldDescriptor* field = plan.field;
+    const Reflection* reflection = parent_msg.GetReflection();
+    if (!field->is_repeated()) {
+        Message& child_msg = *(reflection->MutableMessage(&parent_msg, field));
+        return OnMap(node, *plan.message_plan, child_msg, err_msg, nullptr, &mask);
+    }
+
+    for (auto citr = node.begin(); citr != node.end(); ++citr) {
+        Message& child_msg = *(reflection->AddMessage(&parent_msg, field));
+        if (!OnMap(*citr, *plan.message_plan, child_msg, err_msg, nullptr, &mask)) {
+            return false;
+        }
     }
+    return true;
 }
 // End message
 
-static bool OnNode(
+// Begin map
+// A map fills a map field with one entry per key,
+// anything else is taken as the list of its entries.
+static bool OnNodeForMap(
         const Node& node,
-        const FieldDescriptor* field,
+        const FieldPlan& plan,
         Message& parent_msg,
         string& err_msg) {
-    // Missing the required field
-    if (field->is_required() && (!node || node.IsNull())) {
-        butil::StringAppendF(&err_msg, "Field is required:%s",
-                field->full_name().c_str());
-        return false;
-    }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT32) {
-        return OnNodeFor<int32_t>(node, field, parent_msg, err_msg);
+    if (!node.IsMap()) {
+        return OnNodeForRepeated<DummyClass>(node, plan, parent_msg, err_msg);
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT32) {
-        return OnNodeFor<uint32_t>(node, field, parent_msg, err_msg);
+
+    const FieldPlan& value_plan = plan.message_plan->fields[kMapValuePos];
+    const Reflection* reflection = parent_msg.GetReflection();
+    MutableRepeated<Message>(parent_msg, plan.field, node.size());
+    for (auto citr = node.begin(); citr != node.end(); ++citr) {
+        const auto entry = *citr;
+        const Node& key = entry.first;
+        const Node& value = entry.second;
+        Message& entry_msg = *(reflection->AddMessage(&parent_msg, plan.field));
+        if (!key.IsScalar()) {
+            butil::StringAppendF(&err_msg, "Expect a scalar key at:%s",
+                    plan.field->full_name().c_str());
+            return false;
+        }
+        const string& text = key.Scalar();
+        if (!SetMapKey(entry_msg, text.data(), text.size(), err_msg)) {
+            return false;
+        }
+        // A null value leaves the default one.
+        if (!value.IsNull() && !OnNode(value, value_plan, entry_msg, err_msg)) {
+            return false;
+        }
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
-        return OnNodeFor<int64_t>(node, field, parent_msg, err_msg);
+    return true;
+}
+// End map
+
+// Begin parallel message
+// Long lists of messages are split into chunks, which bthreads convert
+// into separate messages. The chunks are spliced in order afterwards.
+
+// Lists shorter than this are not worth the bthreads.
+static const size_t kParallelMinElements = 1024;
+static const size_t kParallelMinChunk = 256;
+
+// Messages on an arena are freed along with it.
+struct ArenaAwareDelete {
+    void operator()(Message* msg) const {
+        if (!msg->GetArena()) {
+            delete msg;
+        }
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT64) {
-        return OnNodeFor<uint64_t>(node, field, parent_msg, err_msg);
+};
+
+struct ChunkTask {
+    const std::vector<Node>* elements;
+    size_t begin;
+    size_t end;
+    const LoadPlan* plan;
+    const Message* prototype;
+    // Where the parent message lives, nullptr for the heap.
+    ::google::protobuf::Arena* arena;
+    // Index of the first failed element known so far.
+    std::atomic<size_t>* first_error;
+
+    std::vector<std::unique_ptr<Message, ArenaAwareDelete>> messages;
+    size_t error_index = SIZE_MAX;
+    string err_msg;
+};
+
+static void* ConvertChunk(void* arg) {
+    ChunkTask* task = static_cast<ChunkTask*>(arg);
+    task->messages.reserve(task->end - task->begin);
+    for (size_t i = task->begin; i < task->end; ++i) {
+        // An earlier element failed, its error is the one reported.
+        if (i > task->first_error->load(std::memory_order_relaxed)) {
+            break;
+        }
+        std::unique_ptr<Message, ArenaAwareDelete> msg(task->prototype->New(task->arena));
+        if (!OnMap((*task->elements)[i], *task->plan, *msg, task->err_msg)) {
+            task->error_index = i;
+            size_t first = task->first_error->load();
+            while (i < first && !task->first_error->compare_exchange_weak(first, i)) {
+            }
+            break;
+        }
+        task->messages.push_back(std::move(msg));
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
-        return OnNodeFor<bool>(node, field, parent_msg, err_msg);
+    return nullptr;
+}
+
+// Whether a map or a sequence is reachable from several elements,
+// through aliases (`*name') or a node assigned to several places.
+// yaml-cpp updates caches of maps and sequences on const reads, such as
+// their sizes, so such nodes must not be read by several bthreads.
+// Tag() refers to the tag stored in the node itself, which those places
+// share, so its address tells nodes apart.
+static bool ShareNodes(const std::vector<Node>& elements) {
+    std::unordered_map<const void*, size_t> owners;
+    std::vector<Node> pending;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        pending.push_back(elements[i]);
+        while (!pending.empty()) {
+            const Node node = pending.back();
+            pending.pop_back();
+            if (!node.IsMap() && !node.IsSequence()) {
+                continue;
+            }
+            auto inserted = owners.emplace(&node.Tag(), i);
+            if (!inserted.second) {
+                if (inserted.first->second != i) {
+                    return true;
+                }
+                // Already walked from this element.
+                continue;
+            }
+            for (auto citr = node.begin(); citr != node.end(); ++citr) {
+                const auto entry = *citr;
+                // Keys are only read as scalars.
+                pending.push_back(node.IsMap() ? entry.second : static_cast<const Node&>(entry));
+            }
+        }
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT) {
-        return OnNodeFor<float>(node, field, parent_msg, err_msg);
+    return false;
+}
+
+static bool OnNodeForRepeatedInParallel(
+        const Node& node,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    if (!node.IsSequence() || node.size() < kParallelMinElements) {
+        return OnNodeForRepeated<DummyClass>(node, plan, parent_msg, err_msg);
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE) {
-        return OnNodeFor<double>(node, field, parent_msg, err_msg);
+
+    const FieldDescriptor* field = plan.field;
+    const Reflection* reflection = parent_msg.GetReflection();
+    std::vector<Node> elements;
+    elements.reserve(node.size());
+    for (auto citr = node.begin(); citr != node.end(); ++citr) {
+        elements.push_back(*citr);
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
-        return OnNodeFor<enum DummyEnum>(node, field, parent_msg, err_msg);
+    if (ShareNodes(elements)) {
+        return OnNodeForRepeated<DummyClass>(node, plan, parent_msg, err_msg);
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
-        return OnNodeFor<string>(node, field, parent_msg, err_msg);
+
+    const size_t concurrency = std::max(bthread_getconcurrency(), 1);
+    const size_t chunk = std::max(kParallelMinChunk, elements.size() / (concurrency * 4) + 1);
+    std::vector<ChunkTask> tasks((elements.size() + chunk - 1) / chunk);
+    std::vector<bthread_t> tids(tasks.size(), INVALID_BTHREAD);
+    std::atomic<size_t> first_error(SIZE_MAX);
+    const Message* prototype =
+        reflection->GetMessageFactory()->GetPrototype(field->message_type());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        ChunkTask& task = tasks[i];
+        task.elements = &elements;
+        task.begin = i * chunk;
+        task.end = std::min(task.begin + chunk, elements.size());
+        task.plan = plan.message_plan;
+        task.prototype = prototype;
+        task.arena = parent_msg.GetArena();
+        task.first_error = &first_error;
+        if (bthread_start_background(&tids[i], nullptr, ConvertChunk, &task) != 0) {
+            tids[i] = INVALID_BTHREAD;
+            ConvertChunk(&task);
+        }
     }
-    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
-        return OnNodeFor<DummyClass>(node, field, parent_msg, err_msg);
+    for (bthread_t tid : tids) {
+        if (tid != INVALID_BTHREAD) {
+            bthread_join(tid, nullptr);
+        }
     }
 
-    return false;
-}
+    // Report the first error by index, as a sequential load would.
+    if (first_error.load() != SIZE_MAX) {
+        for (const ChunkTask& task : tasks) {
+            if (task.error_index == first_error.load()) {
+                err_msg += task.err_msg;
+                break;
+            }
+        }
+        return false;
+    }
+
+    for (ChunkTask& task : tasks) {
+        for (auto& msg : task.messages) {
+            reflection->AddAllocatedMessage(&parent_msg, field, msg.release());
+        }
+    }
+    return true;
+}
+// End parallel message
+
+static bool OnNode(
+        const Node& node,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    if (!plan.convert) {
+        return false;
+    }
+    return plan.convert(node, plan, parent_msg, err_msg);
+}
+
+template <typename T>
+static FieldPlan::Converter ConverterFor(const FieldDescriptor* field) {
+    if (field->is_repeated()) {
+        return &OnNodeForRepeated<T>;
+    } else {
+        return &OnNodeForSingle<T>;
+    }
+}
+
+// Resolve the converter of field once, when its LoadPlan is built.
+static FieldPlan::Converter ResolveConverter(const FieldDescriptor* field) {
+    if (field->is_map()) {
+        return &OnNodeForMap;
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT32) {
+        return ConverterFor<int32_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT32) {
+        return ConverterFor<uint32_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
+        return ConverterFor<int64_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT64) {
+        return ConverterFor<uint64_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
+        return ConverterFor<bool>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT) {
+        return ConverterFor<float>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE) {
+        return ConverterFor<double>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+        return ConverterFor<enum DummyEnum>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+        return ConverterFor<string>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+        return ConverterFor<DummyClass>(field);
+    }
+
+    return nullptr;
+}
+
+// Same as ResolveConverter, converting long lists of messages in parallel.
+static FieldPlan::Converter ResolveParallelConverter(const FieldDescriptor* field) {
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE && field->is_repeated()
+            && !field->is_map()) {
+        return &OnNodeForRepeatedInParallel;
+    }
+    return ResolveConverter(field);
+}
+
+static LoadPlanRegistry<const Node&>& PlanRegistry(bool ignore_enum_case, bool parallel = false) {
+    static LoadPlanRegistry<const Node&> registry(ResolveConverter);
+    static LoadPlanRegistry<const Node&> ignore_case_registry(ResolveConverter, true);
+    static LoadPlanRegistry<const Node&> parallel_registry(ResolveParallelConverter);
+    static LoadPlanRegistry<const Node&> parallel_ignore_case_registry(
+            ResolveParallelConverter, true);
+    if (parallel) {
+        return ignore_enum_case ? parallel_ignore_case_registry : parallel_registry;
+    }
+    return ignore_enum_case ? ignore_case_registry : registry;
+}
+
+namespace generated {
+
+bool Get(const Node& node, int32_t& value) {
+    return get(node, value);
+}
+
+bool Get(const Node& node, int64_t& value) {
+    return get(node, value);
+}
+
+bool Get(const Node& node, uint32_t& value) {
+    return get(node, value);
+}
+
+bool Get(const Node& node, uint64_t& value) {
+    return get(node, value);
+}
+
+bool Get(const Node& node, bool& value) {
+    return get(node, value);
+}
+
+bool Get(const Node& node, float& value) {
+    return get(node, value);
+}
+
+bool Get(const Node& node, double& value) {
+    return get(node, value);
+}
+
+bool Get(const Node& node, string& value) {
+    return get(node, value);
+}
+
+const EnumValueDescriptor* GetEnum(
+        const Node& node, const EnumTable& table, bool ignore_case) {
+    return ::pbconf::GetEnum(node, table, ignore_case);
+}
+
+bool LoadMessage(
+        const Node& node,
+        Message& msg,
+        bool ignore_enum_case,
+        string& err_msg) {
+    const GeneratedLoader* loader = FindGeneratedLoader(msg);
+    if (loader) {
+        return loader->load_yaml(node, msg, ignore_enum_case, err_msg);
+    }
+    const LoadPlan& plan =
+        PlanRegistry(ignore_enum_case).Get(msg.GetDescriptor());
+    return OnMap(node, plan, msg, err_msg);
+}
+
+bool LoadField(
+        const Node& node,
+        Message& msg,
+        int number,
+        bool ignore_enum_case,
+        string& err_msg) {
+    const LoadPlan& plan =
+        PlanRegistry(ignore_enum_case).Get(msg.GetDescriptor());
+    for (const FieldPlan& field_plan : plan.fields) {
+        if (field_plan.field->number() == number) {
+            return OnNode(node, field_plan, msg, err_msg);
+        }
+    }
+    return false;
+}
+
+}
+
+// Begin incremental
+// Subtree hashes follow the load plans, see SubtreeHash.
+// Scalars hash their tag and text, which is all the conversions read.
+
+static inline uint64_t Mix(uint64_t hash, uint64_t value) {
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15ULL;
+    return hash ^ (hash >> 32);
+}
+
+static uint64_t HashText(const string& text, uint64_t hash) {
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return Mix(hash, text.size());
+}
+
+static uint64_t HashNode(const Node& node) {
+    uint64_t hash = node.Type();
+    if (node.IsScalar()) {
+        return HashText(node.Scalar(), HashText(node.Tag(), hash));
+    }
+    if (node.IsSequence()) {
+        for (auto citr = node.begin(); citr != node.end(); ++citr) {
+            hash = Mix(hash, HashNode(*citr));
+        }
+    } else if (node.IsMap()) {
+        for (auto citr = node.begin(); citr != node.end(); ++citr) {
+            const auto entry = *citr;
+            hash = Mix(Mix(hash, HashNode(entry.first)), HashNode(entry.second));
+        }
+    }
+    return hash;
+}
+
+static uint64_t HashMap(const Node& node, const LoadPlan& plan, SubtreeHash* out);
+
+// Hash one occurrence of a field, with the maps of message fields.
+static uint64_t HashField(const Node& value, const FieldPlan& plan, SubtreeHash::Field* out) {
+    if (!plan.message_plan) {
+        return HashNode(value);
+    }
+    if (!plan.field->is_repeated() && value.IsMap()) {
+        out->by_element = true;
+        out->elements.resize(1);
+        return HashMap(value, *plan.message_plan, &out->elements[0]);
+    }
+    if (plan.field->is_repeated() && value.IsSequence()) {
+        out->by_element = true;
+        out->elements.resize(value.size());
+        uint64_t hash = value.Type();
+        size_t i = 0;
+        for (auto citr = value.begin(); citr != value.end(); ++citr, ++i) {
+            hash = Mix(hash, HashMap(*citr, *plan.message_plan, &out->elements[i]));
+        }
+        return hash;
+    }
+    return HashNode(value);
+}
+
+// Hash the fields of the map `node' as OnMap loads them.
+static uint64_t HashMap(const Node& node, const LoadPlan& plan, SubtreeHash* out) {
+    out->fields.clear();
+    if (!node.IsMap()) {
+        out->hash = HashNode(node);
+        return out->hash;
+    }
+
+    out->fields.resize(plan.fields.size());
+    for (auto citr = node.begin(); citr != node.end(); ++citr) {
+        const auto entry = *citr;
+        const Node& key = entry.first;
+        const Node& value = entry.second;
+        if (!key.IsScalar()) {
+            continue;
+        }
+        int pos = plan.index.Find(key.Scalar());
+        if (pos < 0 || value.IsNull()) {
+            continue;
+        }
+
+        SubtreeHash::Field& field = out->fields[pos];
+        if (field.hash == 0) {
+            field.hash = HashField(value, plan.fields[pos], &field);
+        } else {
+            // A repeated key is loaded over the previous one,
+            // the field can only be converted as a whole.
+            SubtreeHash::Field again;
+            field.hash = Mix(field.hash, HashField(value, plan.fields[pos], &again));
+            field.by_element = false;
+            field.elements.clear();
+        }
+        // Zero stands for absent fields.
+        field.hash |= 1;
+    }
+
+    uint64_t hash = node.Type();
+    for (size_t pos = 0; pos < out->fields.size(); ++pos) {
+        if (out->fields[pos].hash != 0) {
+            hash = Mix(Mix(hash, pos), out->fields[pos].hash);
+        }
+    }
+    out->hash = hash;
+    return hash;
+}
+
+// Bring `msg', a copy of the message loaded from the map hashed as
+// `previous', up to date with the map `node' hashed as `current'.
+// Only the fields whose hash changed are converted again.
+static bool ApplyMap(
+        const Node& node,
+        const LoadPlan& plan,
+        const SubtreeHash& previous,
+        const SubtreeHash& current,
+        const string& prefix,
+        Message& msg,
+        std::vector<string>* changed_paths,
+        string& err_msg) {
+    if (!node.IsMap() || previous.fields.size() != plan.fields.size()) {
+        return false;
+    }
+
+    // Missing the required field
+    for (auto pos : plan.required) {
+        if (current.fields[pos].hash == 0) {
+            butil::StringAppendF(&err_msg, "Field is required:%s",
+                    plan.fields[pos].field->full_name().c_str());
+            return false;
+        }
+    }
+
+    // The fields of the map in document order, as OnMap sees them.
+    std::vector<std::pair<int, Node>> values;
+    for (auto citr = node.begin(); citr != node.end(); ++citr) {
+        const auto entry = *citr;
+        if (!entry.first.IsScalar() || entry.second.IsNull()) {
+            continue;
+        }
+        int pos = plan.index.Find(entry.first.Scalar());
+        if (pos >= 0) {
+            values.emplace_back(pos, entry.second);
+        }
+    }
+
+    const Reflection* reflection = msg.GetReflection();
+    for (size_t pos = 0; pos < plan.fields.size(); ++pos) {
+        const SubtreeHash::Field& before = previous.fields[pos];
+        const SubtreeHash::Field& after = current.fields[pos];
+        if (before.hash == after.hash) {
+            continue;
+        }
+
+        const FieldPlan& field_plan = plan.fields[pos];
+        const FieldDescriptor* field = field_plan.field;
+        const string path = FieldPath(prefix, field);
+        Node value;
+        for (const auto& entry : values) {
+            if (entry.first == static_cast<int>(pos)) {
+                value = entry.second;
+            }
+        }
+
+        if (field_plan.message_plan && before.by_element && after.by_element) {
+            const LoadPlan& message_plan = *field_plan.message_plan;
+            if (!field->is_repeated()) {
+                if (!ApplyMap(value, message_plan, before.elements[0], after.elements[0],
+                            path + ".", *reflection->MutableMessage(&msg, field),
+                            changed_paths, err_msg)) {
+                    return false;
+                }
+                continue;
+            }
+
+            const size_t before_size = before.elements.size();
+            const size_t after_size = after.elements.size();
+            size_t i = 0;
+            for (auto citr = value.begin(); citr != value.end(); ++citr, ++i) {
+                const string element_path = path + "[" + std::to_string(i) + "]";
+                if (i >= before_size) {
+                    changed_paths->push_back(element_path);
+                    if (!OnMap(*citr, message_plan,
+                                *reflection->AddMessage(&msg, field), err_msg)) {
+                        return false;
+                    }
+                } else if (before.elements[i].hash != after.elements[i].hash) {
+                    Message& element = *reflection->MutableRepeatedMessage(&msg, field, i);
+                    if (!ApplyMap(*citr, message_plan, before.elements[i],
+                                after.elements[i], element_path + ".",
+                                element, changed_paths, err_msg)) {
+                        return false;
+                    }
+                }
+            }
+            for (i = after_size; i < before_size; ++i) {
+                changed_paths->push_back(path + "[" + std::to_string(i) + "]");
+                reflection->RemoveLast(&msg, field);
+            }
+            continue;
+        }
+
+        // Convert the whole field again.
+        changed_paths->push_back(path);
+        reflection->ClearField(&msg, field);
+        for (const auto& entry : values) {
+            if (entry.first == static_cast<int>(pos)
+                    && !OnNode(entry.second, field_plan, msg, err_msg)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+// End incremental
+
+// Begin streaming
+// In streaming mode, scalars are converted one at a time
+// through a scratch scalar node, with the same conversions as above.
+// Sub-messages and sequences are tracked by YamlEventHandler.
+
+static inline void add(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        int32_t value) {
+    reflection->AddInt32(&msg, field, value);
+}
+
+static inline void add(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        uint32_t value) {
+    reflection->AddUInt32(&msg, field, value);
+}
+
+static inline void add(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        int64_t value) {
+    reflection->AddInt64(&msg, field, value);
+}
+
+static inline void add(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        uint64_t value) {
+    reflection->AddUInt64(&msg, field, value);
+}
+
+static inline void add(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        bool value) {
+    reflection->AddBool(&msg, field, value);
+}
+
+static inline void add(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        float value) {
+    reflection->AddFloat(&msg, field, value);
+}
+
+static inline void add(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        double value) {
+    reflection->AddDouble(&msg, field, value);
+}
+
+static inline void add(
+        const Reflection* reflection,
+        Message& msg,
+        const FieldDescriptor* field,
+        string&& value) {
+    reflection->AddString(&msg, field, std::move(value));
+}
+
+// Add the scalar node as one element of a repeated field.
+template <typename T>
+static bool OnScalarForRepeated(
+        const Node& node,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    T value{};
+    if (!get(node, value)) {
+        butil::StringAppendF(&err_msg, "Expect %s value at:%s",
+                plan.field->cpp_type_name(), plan.field->full_name().c_str());
+        return false;
+    }
+    add(parent_msg.GetReflection(), parent_msg, plan.field, std::move(value));
+    return true;
+}
+
+template <>
+inline bool OnScalarForRepeated<enum DummyEnum>(
+        const Node& node,
+        const FieldPlan& plan,
+        Message& parent_msg,
+        string& err_msg) {
+    const EnumValueDescriptor* enumd = GetEnum(node, plan);
+    if (!enumd) {
+        butil::StringAppendF(&err_msg, "Expect enum value at:%s",
+                plan.field->full_name().c_str());
+        return false;
+    }
+
+    parent_msg.GetReflection()->AddEnum(&parent_msg, plan.field, enumd);
+    return true;
+}
+
+template <typename T>
+static FieldPlan::Converter ScalarConverterFor(const FieldDescriptor* field) {
+    if (field->is_repeated()) {
+        return &OnScalarForRepeated<T>;
+    } else {
+        return &OnNodeForSingle<T>;
+    }
+}
+
+// Resolve the converter of one scalar of field.
+// Message fields have none, their maps are walked event by event.
+static FieldPlan::Converter ResolveScalarConverter(const FieldDescriptor* field) {
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT32) {
+        return ScalarConverterFor<int32_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT32) {
+        return ScalarConverterFor<uint32_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
+        return ScalarConverterFor<int64_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_UINT64) {
+        return ScalarConverterFor<uint64_t>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_BOOL) {
+        return ScalarConverterFor<bool>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_FLOAT) {
+        return ScalarConverterFor<float>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE) {
+        return ScalarConverterFor<double>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+        return ScalarConverterFor<enum DummyEnum>(field);
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_STRING) {
+        return ScalarConverterFor<string>(field);
+    }
+
+    return nullptr;
+}
+
+static LoadPlanRegistry<const Node&>& StreamPlanRegistry(bool ignore_enum_case) {
+    static LoadPlanRegistry<const Node&> registry(ResolveScalarConverter);
+    static LoadPlanRegistry<const Node&> ignore_case_registry(ResolveScalarConverter, true);
+    return ignore_enum_case ? ignore_case_registry : registry;
+}
+
+// Thrown by YamlEventHandler to stop the parser at the first error.
+struct StreamAbort {};
+
+// Writes parser events straight into the message
+// through a stack of the maps and sequences being read,
+// so that no YAML::Node tree is built.
+// Fields outside `mask', if not null, are skipped like unknown ones.
+class YamlEventHandler final : public YAML::EventHandler {
+public:
+    YamlEventHandler(const LoadPlan& plan, const LoadMask* mask, Message& msg, string& err_msg)
+        : _root_plan(plan), _root_mask(mask), _root_msg(msg), _err_msg(err_msg) {}
+
+    // Returns True if the root map was read completely.
+    bool Done() const {
+        return _root_done;
+    }
+
+    void OnDocumentStart(const YAML::Mark& mark) override {}
+    void OnDocumentEnd() override {}
+
+    void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override {
+        if (_skip_depth > 0) {
+            return;
+        }
+        if (_depth == 0) {
+            Fail(mark, "Expect a map at root");
+        }
+        Frame& frame = Top();
+        if (frame.kind == Frame::SEQUENCE) {
+            Fail(mark, "Unexpected null element");
+        }
+        if (frame.kind == Frame::ENTRIES && frame.expect_key) {
+            Fail(mark, "Unexpected null key");
+        }
+        if (frame.expect_key) {
+            // A null key matches no field.
+            frame.expect_key = false;
+            frame.pending = -1;
+            return;
+        }
+        // A null value is the same as a missing one.
+        frame.expect_key = true;
+    }
+
+    void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override {
+        if (_skip_depth > 0) {
+            return;
+        }
+        Fail(mark, "Aliases are not supported in streaming mode");
+    }
+
+    void OnScalar(const YAML::Mark& mark, const std::string& tag,
+            YAML::anchor_t anchor, const std::string& value) override {
+        if (_skip_depth > 0) {
+            return;
+        }
+        if (_depth == 0) {
+            Fail(mark, "Expect a map at root");
+        }
+
+        Frame& frame = Top();
+        const FieldPlan* field_plan = nullptr;
+        Message* msg = frame.msg;
+        if (frame.kind == Frame::SEQUENCE) {
+            field_plan = frame.field_plan;
+        } else if (frame.kind == Frame::ENTRIES) {
+            if (frame.expect_key) {
+                frame.expect_key = false;
+                frame.entry = frame.msg->GetReflection()->AddMessage(
+                        frame.msg, frame.field_plan->field);
+                if (!SetMapKey(*frame.entry, value.data(), value.size(), _err_msg)) {
+                    Fail(mark, nullptr);
+                }
+                return;
+            }
+            frame.expect_key = true;
+            field_plan = &frame.field_plan->message_plan->fields[kMapValuePos];
+            msg = frame.entry;
+        } else if (frame.expect_key) {
+            frame.expect_key = false;
+            frame.pending = frame.plan->index.Find(value);
+            if (frame.mask && frame.pending >= 0 && !frame.mask->Contains(frame.pending)) {
+                frame.pending = -1;
+            }
+            return;
+        } else {
+            frame.expect_key = true;
+            if (frame.pending < 0) {
+                // Not in the schema.
+                return;
+            }
+            field_plan = &frame.plan->fields[frame.pending];
+            frame.present[frame.pending] = true;
+            if (field_plan->field->is_repeated()) {
+                // A scalar has no elements to iterate in the tree mode,
+                // where it is taken as an empty list.
+                return;
+            }
+        }
+
+        if (!field_plan->convert) {
+            Fail(mark, "Expect a map");
+        }
+        _scratch = value;
+        if (!field_plan->convert(_scratch, *field_plan, *msg, _err_msg)) {
+            Fail(mark, nullptr);
+        }
+    }
+
+    void OnSequenceStart(const YAML::Mark& mark, const std::string& tag,
+            YAML::anchor_t anchor, YAML::EmitterStyle::value style) override {
+        if (_skip_depth > 0) {
+            ++_skip_depth;
+            return;
+        }
+        if (_depth == 0) {
+            Fail(mark, "Expect a map at root");
+        }
+
+        Frame& frame = Top();
+        if (frame.kind == Frame::SEQUENCE) {
+            Fail(mark, "Unexpected nested sequence");
+        }
+        if (frame.expect_key) {
+            Fail(mark, "Unsupported complex key");
+        }
+        if (frame.kind == Frame::ENTRIES) {
+            Fail(mark, "Unexpected sequence");
+        }
+        frame.expect_key = true;
+        if (frame.pending < 0) {
+            ++_skip_depth;
+            return;
+        }
+
+        const FieldPlan& field_plan = frame.plan->fields[frame.pending];
+        if (!field_plan.field->is_repeated()) {
+            Fail(mark, "Unexpected sequence");
+        }
+        frame.present[frame.pending] = true;
+
+        const LoadMask* mask = frame.mask ? frame.mask->Child(frame.pending) : nullptr;
+        Frame& sequence = Push();
+        sequence.kind = Frame::SEQUENCE;
+        sequence.msg = _frames[_depth - 2].msg;
+        sequence.field_plan = &field_plan;
+        sequence.mask = mask;
+    }
+
+    void OnSequenceEnd() override {
+        if (_skip_depth > 0) {
+            --_skip_depth;
+            return;
+        }
+        --_depth;
+    }
+
+    void OnMapStart(const YAML::Mark& mark, const std::string& tag,
+            YAML::anchor_t anchor, YAML::EmitterStyle::value style) override {
+        if (_skip_depth > 0) {
+            ++_skip_depth;
+            return;
+        }
+        if (_depth == 0) {
+            if (_root_done) {
+                Fail(mark, "Unexpected map");
+            }
+            PushMessage(_root_plan, _root_mask, _root_msg);
+            return;
+        }
+
+        Frame& frame = Top();
+        const FieldPlan* field_plan = nullptr;
+        const LoadMask* mask = nullptr;
+        Message* child_msg = nullptr;
+        if (frame.kind == Frame::SEQUENCE) {
+            field_plan = frame.field_plan;
+            mask = frame.mask;
+            if (!field_plan->message_plan) {
+                Fail(mark, "Unexpected map");
+            }
+            child_msg = frame.msg->GetReflection()->AddMessage(
+                    frame.msg, field_plan->field);
+        } else if (frame.kind == Frame::ENTRIES) {
+            if (frame.expect_key) {
+                Fail(mark, "Unsupported complex key");
+            }
+            frame.expect_key = true;
+            field_plan = &frame.field_plan->message_plan->fields[kMapValuePos];
+            if (!field_plan->message_plan) {
+                Fail(mark, "Unexpected map");
+            }
+            child_msg = frame.entry->GetReflection()->MutableMessage(
+                    frame.entry, field_plan->field);
+        } else {
+            if (frame.expect_key) {
+                Fail(mark, "Unsupported complex key");
+            }
+            frame.expect_key = true;
+            if (frame.pending < 0) {
+                ++_skip_depth;
+                return;
+            }
+            field_plan = &frame.plan->fields[frame.pending];
+            frame.present[frame.pending] = true;
+            if (field_plan->field->is_map()) {
+                // One entry per key, see OnNodeForMap.
+                Message* parent_msg = frame.msg;
+                Frame& entries = Push();
+                entries.kind = Frame::ENTRIES;
+                entries.msg = parent_msg;
+                entries.field_plan = field_plan;
+                entries.mask = nullptr;
+                entries.expect_key = true;
+                entries.entry = nullptr;
+                return;
+            }
+            if (!field_plan->message_plan || field_plan->field->is_repeated()) {
+                Fail(mark, "Unexpected map");
+            }
+            mask = frame.mask ? frame.mask->Child(frame.pending) : nullptr;
+            child_msg = frame.msg->GetReflection()->MutableMessage(
+                    frame.msg, field_plan->field);
+        }
+        PushMessage(*field_plan->message_plan, mask, *child_msg);
+    }
+
+    void OnMapEnd() override {
+        if (_skip_depth > 0) {
+            --_skip_depth;
+            return;
+        }
+
+        Frame& frame = Top();
+        if (frame.kind == Frame::ENTRIES) {
+            --_depth;
+            return;
+        }
+
+        // Missing the required field
+        for (auto pos : frame.mask ? frame.mask->Required() : frame.plan->required) {
+            if (!frame.present[pos]) {
+                butil::StringAppendF(&_err_msg, "Field is required:%s",
+                        frame.plan->fields[pos].field->full_name().c_str());
+                throw StreamAbort();
+            }
+        }
+
+        --_depth;
+        if (_depth == 0) {
+            _root_done = true;
+        }
+    }
+
+private:
+    struct Frame {
+        enum Kind { MESSAGE, SEQUENCE, ENTRIES } kind;
+        Message* msg;
+        // MESSAGE: the plan of msg.
+        const LoadPlan* plan;
+        // SEQUENCE: the repeated field of msg being filled.
+        // ENTRIES: the map field of msg being filled.
+        const FieldPlan* field_plan;
+        // MESSAGE: the fields of msg converted, all if null.
+        // SEQUENCE: the same for the messages of field_plan.
+        const LoadMask* mask;
+        // MESSAGE, ENTRIES: whether the next scalar is a key.
+        // MESSAGE: the position of the field of the last key, -1 if unknown.
+        bool expect_key;
+        int pending;
+        // ENTRIES: the entry of the last key.
+        Message* entry;
+        // MESSAGE: which fields of plan have been met.
+        std::vector<bool> present;
+    };
+
+    Frame& Top() {
+        return _frames[_depth - 1];
+    }
+
+    // Frames are recycled, so the present bitmaps keep their capacity.
+    // Push() may move the frames, so references to them must be dropped.
+    Frame& Push() {
+        if (_depth == _frames.size()) {
+            _frames.emplace_back();
+        }
+        return _frames[_depth++];
+    }
+
+    void PushMessage(const LoadPlan& plan, const LoadMask* mask, Message& msg) {
+        Frame& frame = Push();
+        frame.kind = Frame::MESSAGE;
+        frame.msg = &msg;
+        frame.plan = &plan;
+        frame.mask = mask;
+        frame.expect_key = true;
+        frame.pending = -1;
+        frame.present.assign(plan.fields.size(), false);
+    }
+
+    void Fail(const YAML::Mark& mark, const char* reason) {
+        if (reason) {
+            _err_msg.append(reason);
+        }
+        butil::StringAppendF(&_err_msg, " at line %d, column %d",
+                mark.line + 1, mark.column + 1);
+        throw StreamAbort();
+    }
+
+    const LoadPlan& _root_plan;
+    const LoadMask* _root_mask;
+    Message& _root_msg;
+    string& _err_msg;
+    std::vector<Frame> _frames;
+    size_t _depth = 0;
+    // Depth of the unknown map or sequence being skipped.
+    int _skip_depth = 0;
+    bool _root_done = false;
+    Node _scratch;
+};
+
+static bool LoadStream(
+        const string& filename,
+        const LoadPlan& plan,
+        const LoadMask* mask,
+        Message& msg,
+        string& err_msg) {
+    std::ifstream input(filename);
+    if (!input) {
+        throw YAML::BadFile(filename);
+    }
+
+    YamlEventHandler handler(plan, mask, msg, err_msg);
+    YAML::Parser parser(input);
+    try {
+        parser.HandleNextDocument(handler);
+    } catch (StreamAbort) {
+        return false;
+    }
+    return handler.Done();
+}
+// End streaming
+
+// Loads a lazy field on first access, from its yaml text,
+// or from its node if it has no text of its own.
+struct DeferredYaml {
+    string text;
+    Node node;
+    bool ignore_enum_case;
+    bool use_generated;
+
+    bool operator()(Message& msg, string& err_msg) {
+        try {
+            return YamlConf()
+                .SetIgnoreEnumCase(ignore_enum_case)
+                .SetUseGenerated(use_generated)
+                .LoadDocument(text.empty() ? node : YAML::Load(text), msg, err_msg);
+        } catch (...) {
+            err_msg = boost::current_exception_diagnostic_information();
+            return false;
+        }
+    }
+};
+
+// Keep the source text of a lazy field, from its value up to the next
+// key of the root map, which takes much less memory than its nodes and
+// lets the document be freed. Emitting or cloning the nodes would take
+// longer than converting them. Values of flow style root maps, aliases
+// and documents given as nodes keep their node instead.
+static void Defer(
+        const Node& key,
+        const Node& value,
+        const FieldPlan& plan,
+        const LazySink& lazy) {
+    DeferredYaml deferred;
+    deferred.ignore_enum_case = lazy.ignore_enum_case;
+    deferred.use_generated = lazy.use_generated;
+    const YAML::Mark mark = value.Mark();
+    // An alias is marked where its anchor is.
+    if (!lazy.text || mark.is_null() || mark.pos <= key.Mark().pos
+            || static_cast<size_t>(mark.pos) >= lazy.text_size) {
+        deferred.node = value;
+        lazy.fields->Defer(plan.field, std::move(deferred));
+        return;
+    }
+
+    const size_t begin = mark.pos;
+    auto next = std::upper_bound(lazy.key_positions.begin(), lazy.key_positions.end(), begin);
+    const size_t end = next == lazy.key_positions.end()
+        ? lazy.text_size : std::min(*next, lazy.text_size);
+    // Indented as in the document, for the lines after the first one.
+    deferred.text.reserve(mark.column + end - begin);
+    deferred.text.assign(mark.column, ' ');
+    deferred.text.append(lazy.text + begin, end - begin);
+    lazy.fields->Defer(plan.field, std::move(deferred));
+}
+
+// Read the file named `filename' into `content' and parse it,
+// recording the phases into `metrics' if not null.
+static Node ParseContent(const string& filename, LoadMetrics* metrics, string& content) {
+    {
+        ScopedPhase read(metrics, LoadMetrics::YAML, LoadMetrics::READ);
+        if (!butil::ReadFileToString(butil::FilePath(filename), &content)) {
+            // Fail the same way as YAML::LoadFile.
+            return YAML::LoadFile(filename);
+        }
+    }
+    if (metrics) {
+        metrics->RecordBytesRead(LoadMetrics::YAML, content.size());
+    }
+    ScopedPhase parse(metrics, LoadMetrics::YAML, LoadMetrics::PARSE);
+    return YAML::Load(content);
+}
+
+// YAML::LoadFile, recording the read and parse phases apart
+// into `metrics' if not null.
+static Node ParseFile(const string& filename, LoadMetrics* metrics) {
+    if (!metrics) {
+        return YAML::LoadFile(filename);
+    }
+    string content;
+    return ParseContent(filename, metrics, content);
+}
 
 bool YamlConf::Load(const string& filename, Message& msg, string& err_msg) {
+    const bool ok = LoadFile(filename, msg, err_msg);
+    if (_metrics) {
+        _metrics->RecordResult(LoadMetrics::YAML, ok, msg);
+    }
+    return ok;
+}
+
+bool YamlConf::LoadFile(const string& filename, Message& msg, string& err_msg) {
     try {
-        const Node root = YAML::LoadFile(filename);
-        return OnRootNode(root, msg, err_msg);
+        if (_streaming) {
+            if (_lazy) {
+                butil::StringAppendF(&err_msg, "No lazy fields in streaming mode");
+                return false;
+            }
+            const LoadPlan& plan =
+                StreamPlanRegistry(_ignore_enum_case).Get(msg.GetDescriptor());
+            int64_t size = 0;
+            if (_metrics && butil::GetFileSize(butil::FilePath(filename), &size)) {
+                _metrics->RecordBytesRead(LoadMetrics::YAML, size);
+            }
+            ScopedPhase convert(_metrics, LoadMetrics::YAML, LoadMetrics::CONVERT);
+            return LoadStream(filename, plan, _mask, msg, err_msg);
+        }
+        if (!_lazy) {
+            return LoadDocument(ParseFile(filename, _metrics), msg, err_msg);
+        }
+        // Lazy fields keep their text from the file.
+        string content;
+        const Node root = ParseContent(filename, _metrics, content);
+        return LoadRoot(root, &content, msg, err_msg);
+    } catch (YAML::ParserException e) {
+        err_msg = e.what();
+        return false;
+    } catch (YAML::BadFile e) {
+        err_msg = e.what();
+        return false;
+    } catch (...) {
+        err_msg = boost::current_exception_diagnostic_information();
+        return false;
+    }
+}
+
+bool YamlConf::LoadDocument(const Node& root, Message& msg, string& err_msg) {
+    return LoadRoot(root, nullptr, msg, err_msg);
+}
+
+bool YamlConf::LoadRoot(
+        const Node& root,
+        const string* content,
+        Message& msg,
+        string& err_msg) {
+    ScopedPhase convert(_metrics, LoadMetrics::YAML, LoadMetrics::CONVERT);
+    try {
+        if (_lazy && !_lazy->Reset(msg, err_msg)) {
+            return false;
+        }
+        if (_use_generated && !_parallel && !_lazy && !_mask) {
+            return generated::LoadMessage(root, msg, _ignore_enum_case, err_msg);
+        }
+        const LoadPlan& plan =
+            PlanRegistry(_ignore_enum_case, _parallel).Get(msg.GetDescriptor());
+        LazySink lazy{_lazy, _ignore_enum_case, _use_generated, nullptr, 0, {}};
+        if (_lazy && content && root.Style() != YAML::EmitterStyle::Flow) {
+            // YAML::Mark does not count the byte order mark.
+            const size_t bom = content->compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+            lazy.text = content->data() + bom;
+            lazy.text_size = content->size() - bom;
+            for (auto citr = root.begin(); citr != root.end(); ++citr) {
+                const YAML::Mark mark = (*citr).first.Mark();
+                if (!mark.is_null()) {
+                    lazy.key_positions.push_back(mark.pos);
+                }
+            }
+            std::sort(lazy.key_positions.begin(), lazy.key_positions.end());
+        }
+        return OnRootNode(root, plan, msg, err_msg, _lazy ? &lazy : nullptr, _mask);
+    } catch (...) {
+        err_msg = boost::current_exception_diagnostic_information();
+        return false;
+    }
+}
+
+bool YamlConf::Load(const string& filename, IncrementalState& state, string& err_msg) {
+    const bool ok = LoadFile(filename, state, err_msg);
+    if (_metrics) {
+        _metrics->RecordResult(LoadMetrics::YAML, ok,
+                ok ? *state._current : *state._prototype);
+    }
+    return ok;
+}
+
+bool YamlConf::LoadFile(const string& filename, IncrementalState& state, string& err_msg) {
+    try {
+        const Node root = ParseFile(filename, _metrics);
+        ScopedPhase convert(_metrics, LoadMetrics::YAML, LoadMetrics::CONVERT);
+        const LoadPlan& plan =
+            PlanRegistry(_ignore_enum_case, _parallel).Get(state._prototype->GetDescriptor());
+        std::unique_ptr<SubtreeHash> hashes(new SubtreeHash());
+        HashMap(root, plan, hashes.get());
+
+        std::vector<string> changed_paths;
+        const bool incremental = state._current && state._hashes
+            && state._ignore_enum_case == _ignore_enum_case;
+        if (incremental && hashes->hash == state._hashes->hash) {
+            // Nothing changed, keep the current message.
+            state._hashes = std::move(hashes);
+            state._changed_paths.clear();
+            return true;
+        }
+
+        std::shared_ptr<Message> msg = state.NewMessage();
+        if (incremental) {
+            msg->CopyFrom(*state._current);
+            if (!ApplyMap(root, plan, *state._hashes, *hashes, string(),
+                        *msg, &changed_paths, err_msg)) {
+                return false;
+            }
+        } else {
+            bool ok = _use_generated && !_parallel
+                ? generated::LoadMessage(root, *msg, _ignore_enum_case, err_msg)
+                : OnRootNode(root, plan, *msg, err_msg);
+            if (!ok) {
+                return false;
+            }
+            for (size_t pos = 0; pos < hashes->fields.size(); ++pos) {
+                if (hashes->fields[pos].hash != 0) {
+                    changed_paths.push_back(FieldPath(string(), plan.fields[pos].field));
+                }
+            }
+        }
+
+        state._current = std::move(msg);
+        state._hashes = std::move(hashes);
+        state._ignore_enum_case = _ignore_enum_case;
+        state._changed_paths.swap(changed_paths);
+        return true;
     } catch (YAML::ParserException e) {
         err_msg = e.what();
         return false;
@@ -4,10 +4,84 @@
 #include <google/protobuf/message.h>
 #include <string>
 
+#include "incremental_state.h"
+
+namespace YAML {
+class Node;
+}
+
 namespace pbconf {
 
+class LazyFields;
+class LoadMask;
+class LoadMetrics;
+
 class YamlConf final {
 public:
+    // Parse the conf file as a stream of events
+    // instead of building the whole YAML::Node tree first,
+    // so that peak memory follows the nesting depth, not the file size.
+    // Anchors and aliases are not supported in this mode.
+    YamlConf& SetStreaming(bool streaming) {
+        _streaming = streaming;
+        return *this;
+    }
+
+    // Match enum names ignoring ASCII case, e.g. `red' for `RED'.
+    // Names that only differ by case still need the exact spelling.
+    YamlConf& SetIgnoreEnumCase(bool ignore_enum_case) {
+        _ignore_enum_case = ignore_enum_case;
+        return *this;
+    }
+
+    // Load through the loader generated by protoc-gen-pbconf
+    // when one is linked in for the message type, which is the default.
+    // Otherwise, or when disabled, the message is loaded through Reflection.
+    YamlConf& SetUseGenerated(bool use_generated) {
+        _use_generated = use_generated;
+        return *this;
+    }
+
+    // Convert lists of at least 1024 messages in parallel on bthreads,
+    // in chunks spliced in order. The first failed element by index
+    // is the one reported, as when converting sequentially. Lists whose
+    // elements share nodes, e.g. through aliases, convert sequentially.
+    // Loads through Reflection, not the generated loaders.
+    // Does not apply to the streaming mode.
+    YamlConf& SetParallel(bool parallel) {
+        _parallel = parallel;
+        return *this;
+    }
+
+    // Leave the lazy fields of the root message to `lazy', to be
+    // converted on first access, see LazyFields. The root message is
+    // then loaded through Reflection; lazy fields follow the options
+    // above when converted. Loads in streaming mode fail with lazy
+    // fields, incremental loads convert all fields.
+    // `lazy' must outlive the loads.
+    YamlConf& SetLazyFields(LazyFields* lazy) {
+        _lazy = lazy;
+        return *this;
+    }
+
+    // Only convert the fields in `mask', skipping the others, see
+    // LoadMask. The streaming mode skips them without building them.
+    // The message is then loaded through Reflection; lazy fields in
+    // the mask are converted whole when accessed. Incremental loads
+    // convert all fields. `mask' must outlive the loads.
+    YamlConf& SetLoadMask(const LoadMask* mask) {
+        _mask = mask;
+        return *this;
+    }
+
+    // Record the phases, size and result of each load of a conf file
+    // into `metrics', see LoadMetrics. Loads of documents only record
+    // their conversion. The metrics must outlive the loads.
+    YamlConf& SetMetrics(LoadMetrics* metrics) {
+        _metrics = metrics;
+        return *this;
+    }
+
     // Treat the specified file named `filename'
     // as a yaml-formatted conf file.
     // Load the conf info into msg.
@@ -16,6 +90,52 @@ public:
             const std::string& filename,
             ::google::protobuf::Message& msg,
             std::string& err_msg);
+
+    // Load an already parsed yaml document into msg,
+    // e.g. one merged from several conf files by ConfOverlay.
+    // Returns True if success; otherwise False.
+    bool LoadDocument(
+            const YAML::Node& root,
+            ::google::protobuf::Message& msg,
+            std::string& err_msg);
+
+    // Load the conf file into a new message of `state',
+    // converting only the subtrees that changed since the last load
+    // through `state' and copying the rest from its message.
+    // The paths of the changed fields are in state.ChangedPaths().
+    // Always uses the tree mode and, for changed subtrees, Reflection.
+    // Returns True if success, with state.Current() updated;
+    // otherwise False, with `state' unchanged.
+    bool Load(
+            const std::string& filename,
+            IncrementalState& state,
+            std::string& err_msg);
+
+private:
+    bool LoadFile(
+            const std::string& filename,
+            ::google::protobuf::Message& msg,
+            std::string& err_msg);
+
+    bool LoadFile(
+            const std::string& filename,
+            IncrementalState& state,
+            std::string& err_msg);
+
+    // Load the document `root', parsed from `content' if not null.
+    bool LoadRoot(
+            const YAML::Node& root,
+            const std::string* content,
+            ::google::protobuf::Message& msg,
+            std::string& err_msg);
+
+    bool _streaming = false;
+    bool _ignore_enum_case = false;
+    bool _use_generated = true;
+    bool _parallel = false;
+    LazyFields* _lazy = nullptr;
+    const LoadMask* _mask = nullptr;
+    LoadMetrics* _metrics = nullptr;
 };
 
 }
@@ -0,0 +1,10 @@
+#include <google/protobuf/compiler/plugin.h>
+
+#include "pbconf_generator.h"
+
+// protoc-gen-pbconf, used as:
+// protoc --plugin=protoc-gen-pbconf=<path> --pbconf_out=<dir> <protos>
+int main(int argc, char* argv[]) {
+    pbconf::PbConfGenerator generator;
+    return ::google::protobuf::compiler::PluginMain(argc, argv, &generator);
+}
@@ -0,0 +1,713 @@
+#include "pbconf_generator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/printer.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace pbconf {
+
+using Descriptor = ::google::protobuf::Descriptor;
+using EnumDescriptor = ::google::protobuf::EnumDescriptor;
+using FieldDescriptor = ::google::protobuf::FieldDescriptor;
+using FileDescriptor = ::google::protobuf::FileDescriptor;
+using FileOptions = ::google::protobuf::FileOptions;
+using GeneratorContext = ::google::protobuf::compiler::GeneratorContext;
+using Printer = ::google::protobuf::io::Printer;
+using ZeroCopyOutputStream = ::google::protobuf::io::ZeroCopyOutputStream;
+using Vars = std::map<std::string, std::string>;
+using string = std::string;
+
+// Begin naming
+// The names below follow the C++ code generator of protoc.
+
+static string StripProto(const string& filename) {
+    const string suffix = ".proto";
+    if (filename.size() >= suffix.size()
+            && filename.compare(filename.size() - suffix.size(),
+                suffix.size(), suffix) == 0) {
+        return filename.substr(0, filename.size() - suffix.size());
+    }
+    return filename;
+}
+
+static string Replace(string text, const string& from, const string& to) {
+    for (size_t pos = text.find(from); pos != string::npos;
+            pos = text.find(from, pos + to.size())) {
+        text.replace(pos, from.size(), to);
+    }
+    return text;
+}
+
+// Qualified C++ name of a message or enum type,
+// e.g. `::demo::ConfMessage_User' for `demo.ConfMessage.User'.
+static string QualifiedName(const string& full_name, const string& package) {
+    string name = package.empty()
+        ? full_name
+        : full_name.substr(package.size() + 1);
+    string qualified = "::";
+    if (!package.empty()) {
+        qualified += Replace(package, ".", "::") + "::";
+    }
+    return qualified + Replace(name, ".", "_");
+}
+
+static string ClassName(const Descriptor* descriptor) {
+    return QualifiedName(descriptor->full_name(), descriptor->file()->package());
+}
+
+static string EnumName(const EnumDescriptor* descriptor) {
+    return QualifiedName(descriptor->full_name(), descriptor->file()->package());
+}
+
+// Name of the accessors of field, e.g. `set_<name>()'.
+static string FieldName(const FieldDescriptor* field) {
+    static const std::set<string> kKeywords = {
+        "NULL", "alignas", "alignof", "and", "and_eq", "asm", "auto",
+        "bitand", "bitor", "bool", "break", "case", "catch", "char",
+        "char8_t", "char16_t", "char32_t", "class", "compl", "concept",
+        "const", "consteval", "constexpr", "constinit", "const_cast",
+        "continue", "co_await", "co_return", "co_yield", "decltype",
+        "default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+        "explicit", "export", "extern", "false", "float", "for", "friend",
+        "goto", "if", "inline", "int", "long", "mutable", "namespace", "new",
+        "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq",
+        "private", "protected", "public", "register", "reinterpret_cast",
+        "requires", "return", "short", "signed", "sizeof", "static",
+        "static_assert", "static_cast", "struct", "switch", "template",
+        "this", "thread_local", "throw", "true", "try", "typedef", "typeid",
+        "typename", "union", "unsigned", "using", "virtual", "void",
+        "volatile", "wchar_t", "while", "xor", "xor_eq"
+    };
+    string name = field->name();
+    std::transform(name.begin(), name.end(), name.begin(),
+            [](char c) { return static_cast<char>(tolower(c)); });
+    if (kKeywords.count(name) > 0) {
+        name += "_";
+    }
+    return name;
+}
+
+static string CppType(const FieldDescriptor* field) {
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+        return "int32_t";
+    case FieldDescriptor::CPPTYPE_INT64:
+        return "int64_t";
+    case FieldDescriptor::CPPTYPE_UINT32:
+        return "uint32_t";
+    case FieldDescriptor::CPPTYPE_UINT64:
+        return "uint64_t";
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+        return "double";
+    case FieldDescriptor::CPPTYPE_FLOAT:
+        return "float";
+    case FieldDescriptor::CPPTYPE_BOOL:
+        return "bool";
+    case FieldDescriptor::CPPTYPE_STRING:
+        return "std::string";
+    default:
+        return "";
+    }
+}
+// End naming
+
+// Whether a loader is generated for the message type.
+// Others are loaded through Reflection. Map entries are loaded
+// along with their map field, see GenerateYamlMapField.
+static bool HasLoader(const Descriptor* descriptor) {
+    return !descriptor->options().map_entry()
+        && descriptor->extension_range_count() == 0;
+}
+
+static void CollectMessages(
+        const Descriptor* descriptor,
+        std::vector<const Descriptor*>& messages) {
+    if (HasLoader(descriptor)) {
+        messages.push_back(descriptor);
+    }
+    for (int i = 0; i < descriptor->nested_type_count(); ++i) {
+        CollectMessages(descriptor->nested_type(i), messages);
+    }
+}
+
+// Which of the two formats the code is generated for.
+enum class Format { YAML, JSON };
+
+static Vars FieldVars(const FieldDescriptor* field, Format format) {
+    Vars vars;
+    vars["name"] = FieldName(field);
+    vars["field_name"] = field->name();
+    vars["full_name"] = field->full_name();
+    vars["number"] = std::to_string(field->number());
+    vars["type"] = CppType(field);
+    vars["type_name"] = field->cpp_type_name();
+    vars["load"] = format == Format::YAML ? "LoadYaml" : "LoadJson";
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+        vars["enum"] = EnumName(field->enum_type());
+    }
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+        const Descriptor* type = field->message_type();
+        // Types of other files, or without a loader, are dispatched at runtime.
+        if (type->file() != field->file() || !HasLoader(type)) {
+            vars["load"] = "generated::LoadMessage";
+        }
+    }
+    return vars;
+}
+
+// Convert the value at `node' into one element of field:
+// the field itself when singular, a new element when repeated.
+static void GenerateElement(
+        Printer& printer,
+        const FieldDescriptor* field,
+        Vars vars,
+        const string& node) {
+    vars["node"] = node;
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+        printer.Print(vars, field->is_repeated()
+            ? "if (!$load$($node$, *msg.add_$name$(), ignore_enum_case, err_msg)) {\n"
+            : "if (!$load$($node$, *msg.mutable_$name$(), ignore_enum_case, err_msg)) {\n");
+        printer.Print("    return false;\n}\n");
+        break;
+    case FieldDescriptor::CPPTYPE_ENUM:
+        printer.Print(vars,
+                "static const ::pbconf::EnumTable& table =\n"
+                "    ::pbconf::EnumTable::Get($enum$_descriptor());\n"
+                "const ::google::protobuf::EnumValueDescriptor* enumd =\n"
+                "    generated::GetEnum($node$, table, ignore_enum_case);\n"
+                "if (!enumd) {\n"
+                "    return generated::ExpectValue(\"enum\", \"$full_name$\", err_msg);\n"
+                "}\n");
+        printer.Print(vars, field->is_repeated()
+            ? "msg.add_$name$(static_cast<$enum$>(enumd->number()));\n"
+            : "msg.set_$name$(static_cast<$enum$>(enumd->number()));\n");
+        break;
+    case FieldDescriptor::CPPTYPE_STRING:
+        printer.Print(vars, field->is_repeated()
+            ? "if (!generated::Get($node$, *values->Add())) {\n"
+            : "if (!generated::Get($node$, *msg.mutable_$name$())) {\n");
+        printer.Print(vars,
+                "    return generated::ExpectValue(\"$type_name$\", \"$full_name$\", err_msg);\n"
+                "}\n");
+        break;
+    default:
+        printer.Print(vars,
+                "$type$ scalar{};\n"
+                "if (!generated::Get($node$, scalar)) {\n"
+                "    return generated::ExpectValue(\"$type_name$\", \"$full_name$\", err_msg);\n"
+                "}\n");
+        printer.Print(vars, field->is_repeated()
+            ? "values->Add(scalar);\n"
+            : "msg.set_$name$(scalar);\n");
+        break;
+    }
+}
+
+// Convert the value at `node' into `map_value', the value of a map
+// entry, of the type of the map entry field `field'.
+static void GenerateMapValue(
+        Printer& printer,
+        const FieldDescriptor* field,
+        Vars vars,
+        const string& node) {
+    vars["node"] = node;
+    switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+        printer.Print(vars,
+                "if (!$load$($node$, map_value, ignore_enum_case, err_msg)) {\n"
+                "    return false;\n"
+                "}\n");
+        break;
+    case FieldDescriptor::CPPTYPE_ENUM:
+        printer.Print(vars,
+                "static const ::pbconf::EnumTable& table =\n"
+                "    ::pbconf::EnumTable::Get($enum$_descriptor());\n"
+                "const ::google::protobuf::EnumValueDescriptor* enumd =\n"
+                "    generated::GetEnum($node$, table, ignore_enum_case);\n"
+                "if (!enumd) {\n"
+                "    return generated::ExpectValue(\"enum\", \"$full_name$\", err_msg);\n"
+                "}\n"
+                "map_value = static_cast<$enum$>(enumd->number());\n");
+        break;
+    default:
+        printer.Print(vars,
+                "if (!generated::Get($node$, map_value)) {\n"
+                "    return generated::ExpectValue(\"$type_name$\", \"$full_name$\", err_msg);\n"
+                "}\n");
+        break;
+    }
+}
+
+// The key and value variables of the map field `field'.
+static Vars MapVars(const FieldDescriptor* field) {
+    const FieldDescriptor* key = field->message_type()->map_key();
+    Vars vars;
+    vars["name"] = FieldName(field);
+    vars["number"] = std::to_string(field->number());
+    vars["full_name"] = field->full_name();
+    vars["key_type"] = CppType(key);
+    vars["key_type_name"] = key->cpp_type_name();
+    vars["key_full_name"] = key->full_name();
+    return vars;
+}
+
+// Repeated numbers and strings are appended to the RepeatedField itself.
+static bool HasValues(const FieldDescriptor* field) {
+    return field->is_repeated()
+        && field->cpp_type() != FieldDescriptor::CPPTYPE_ENUM
+        && field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE;
+}
+
+static void Indent(Printer& printer, int levels) {
+    // Printer indents by 2 spaces, the generated code by 4.
+    for (int i = 0; i < levels * 2; ++i) {
+        printer.Indent();
+    }
+}
+
+static void Outdent(Printer& printer, int levels) {
+    for (int i = 0; i < levels * 2; ++i) {
+        printer.Outdent();
+    }
+}
+
+// A map goes straight into the Map<K, V>, one entry per key.
+// The list of the entries protobuf describes is loaded through
+// Reflection, as it is rare and costs a message per entry anyway.
+static void GenerateYamlMapField(Printer& printer, const FieldDescriptor* field) {
+    const FieldDescriptor* value_field = field->message_type()->map_value();
+    Vars vars = MapVars(field);
+    printer.Print(vars,
+            "if (value.IsMap()) {\n"
+            "    auto* values = msg.mutable_$name$();\n"
+            "    for (auto item = value.begin(); item != value.end(); ++item) {\n"
+            "        const auto pair = *item;\n"
+            "        $key_type$ map_key{};\n"
+            "        if (!generated::GetKey(pair.first, map_key)) {\n"
+            "            return generated::ExpectValue(\"$key_type_name$\", \"$key_full_name$\", err_msg);\n"
+            "        }\n"
+            "        auto& map_value = (*values)[std::move(map_key)];\n"
+            "        // A null value leaves the default one.\n"
+            "        if (pair.second.IsNull()) {\n"
+            "            continue;\n"
+            "        }\n");
+    Indent(printer, 2);
+    GenerateMapValue(printer, value_field, FieldVars(value_field, Format::YAML), "pair.second");
+    Outdent(printer, 2);
+    printer.Print(vars,
+            "    }\n"
+            "} else if (!generated::LoadField(value, msg, $number$, ignore_enum_case, err_msg)) {\n"
+            "    return false;\n"
+            "}\n");
+}
+
+static void GenerateJsonMapField(Printer& printer, const FieldDescriptor* field) {
+    const FieldDescriptor* value_field = field->message_type()->map_value();
+    Vars vars = MapVars(field);
+    printer.Print(vars,
+            "if (reader.Peek() == JsonReader::ARRAY) {\n"
+            "    if (!generated::LoadField(reader, msg, $number$, ignore_enum_case, err_msg)) {\n"
+            "        return false;\n"
+            "    }\n"
+            "    break;\n"
+            "}\n"
+            "if (!reader.StartObject()) {\n"
+            "    return generated::ExpectObject(\"$full_name$\", err_msg);\n"
+            "}\n"
+            "auto* values = msg.mutable_$name$();\n"
+            "const char* item = nullptr;\n"
+            "size_t item_size = 0;\n"
+            "bool object_end = false;\n"
+            "while (reader.NextMember(item, item_size, object_end) && !object_end) {\n"
+            "    $key_type$ map_key{};\n"
+            "    if (!generated::GetKey(item, item_size, map_key)) {\n"
+            "        return generated::ExpectValue(\"$key_type_name$\", \"$key_full_name$\", err_msg);\n"
+            "    }\n"
+            "    auto& map_value = (*values)[std::move(map_key)];\n"
+            "    // A null value leaves the default one.\n"
+            "    if (reader.Peek() == JsonReader::NUL) {\n"
+            "        if (!reader.ReadNull()) {\n"
+            "            return false;\n"
+            "        }\n"
+            "        continue;\n"
+            "    }\n");
+    Indent(printer, 1);
+    GenerateMapValue(printer, value_field, FieldVars(value_field, Format::JSON), "reader");
+    Outdent(printer, 1);
+    printer.Print(
+            "}\n"
+            "if (!object_end) {\n"
+            "    return false;\n"
+            "}\n");
+}
+
+static void GenerateYamlField(Printer& printer, const FieldDescriptor* field) {
+    if (field->is_map()) {
+        GenerateYamlMapField(printer, field);
+        return;
+    }
+    Vars vars = FieldVars(field, Format::YAML);
+    if (!field->is_repeated()) {
+        GenerateElement(printer, field, vars, "value");
+        return;
+    }
+
+    // Sequences are walked like the reflection loader does,
+    // a scalar in place of a sequence has no elements.
+    if (HasValues(field)) {
+        printer.Print(vars,
+                "auto* values = msg.mutable_$name$();\n"
+                "values->Reserve(values->size() + static_cast<int>(value.size()));\n");
+    }
+    printer.Print("for (auto item = value.begin(); item != value.end(); ++item) {\n");
+    Indent(printer, 1);
+    GenerateElement(printer, field, vars, "*item");
+    Outdent(printer, 1);
+    printer.Print("}\n");
+}
+
+static void GenerateJsonField(Printer& printer, const FieldDescriptor* field) {
+    if (field->is_map()) {
+        GenerateJsonMapField(printer, field);
+        return;
+    }
+    Vars vars = FieldVars(field, Format::JSON);
+    if (!field->is_repeated()) {
+        GenerateElement(printer, field, vars, "reader");
+        return;
+    }
+
+    printer.Print(vars,
+            "if (!reader.StartArray()) {\n"
+            "    return generated::ExpectArray(\"$full_name$\", err_msg);\n"
+            "}\n");
+    if (HasValues(field)) {
+        printer.Print(vars, "auto* values = msg.mutable_$name$();\n");
+    }
+    printer.Print(
+            "bool array_end = false;\n"
+            "while (reader.NextElement(array_end) && !array_end) {\n");
+    Indent(printer, 1);
+    GenerateElement(printer, field, vars, "reader");
+    Outdent(printer, 1);
+    printer.Print(
+            "}\n"
+            "if (!array_end) {\n"
+            "    return false;\n"
+            "}\n");
+}
+
+// The fields of the message, grouped by the length of their names.
+static std::map<size_t, std::vector<const FieldDescriptor*>> FieldsByLength(
+        const Descriptor* descriptor) {
+    std::map<size_t, std::vector<const FieldDescriptor*>> fields;
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+        const FieldDescriptor* field = descriptor->field(i);
+        fields[field->name().size()].push_back(field);
+    }
+    return fields;
+}
+
+static void GenerateFieldNumber(Printer& printer, const Descriptor* descriptor) {
+    Vars vars;
+    vars["class"] = ClassName(descriptor);
+    printer.Print(vars,
+            "// Number of the field named [key, key + size), 0 if unknown.\n"
+            "int FieldNumber(const $class$&, const char* key, size_t size) {\n"
+            "    switch (size) {\n");
+    for (const auto& group : FieldsByLength(descriptor)) {
+        vars["size"] = std::to_string(group.first);
+        printer.Print(vars, "    case $size$:\n");
+        for (auto field : group.second) {
+            vars["field_name"] = field->name();
+            vars["number"] = std::to_string(field->number());
+            printer.Print(vars,
+                    "        if (memcmp(key, \"$field_name$\", $size$) == 0) {\n"
+                    "            return $number$;\n"
+                    "        }\n");
+        }
+        printer.Print("        break;\n");
+    }
+    printer.Print(
+            "    }\n"
+            "    return 0;\n"
+            "}\n\n");
+}
+
+// Positions of the required fields in the presence bits.
+static std::vector<const FieldDescriptor*> RequiredFields(
+        const Descriptor* descriptor) {
+    std::vector<const FieldDescriptor*> required;
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+        if (descriptor->field(i)->is_required()) {
+            required.push_back(descriptor->field(i));
+        }
+    }
+    return required;
+}
+
+static void GenerateSwitch(
+        Printer& printer,
+        const Descriptor* descriptor,
+        Format format) {
+    std::vector<const FieldDescriptor*> required = RequiredFields(descriptor);
+    printer.Print("switch (number) {\n");
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+        const FieldDescriptor* field = descriptor->field(i);
+        Vars vars;
+        vars["number"] = std::to_string(field->number());
+        vars["field_name"] = field->name();
+        printer.Print(vars, "case $number$: {  // $field_name$\n");
+        Indent(printer, 1);
+        if (format == Format::YAML) {
+            GenerateYamlField(printer, field);
+        } else {
+            GenerateJsonField(printer, field);
+        }
+        auto pos = std::find(required.begin(), required.end(), field);
+        if (pos != required.end()) {
+            size_t bit = pos - required.begin();
+            vars["word"] = std::to_string(bit / 64);
+            vars["bit"] = std::to_string(bit % 64);
+            printer.Print(vars, "present[$word$] |= uint64_t(1) << $bit$;\n");
+        }
+        printer.Print("break;\n");
+        Outdent(printer, 1);
+        printer.Print("}\n");
+    }
+    printer.Print(
+            "default:\n"
+            "    break;\n"
+            "}\n");
+}
+
+static void GenerateRequiredChecks(Printer& printer, const Descriptor* descriptor) {
+    std::vector<const FieldDescriptor*> required = RequiredFields(descriptor);
+    if (required.empty()) {
+        return;
+    }
+    printer.Print("\n    // Missing the required field\n");
+    for (size_t bit = 0; bit < required.size(); ++bit) {
+        Vars vars;
+        vars["word"] = std::to_string(bit / 64);
+        vars["bit"] = std::to_string(bit % 64);
+        vars["full_name"] = required[bit]->full_name();
+        printer.Print(vars,
+                "    if (!(present[$word$] & (uint64_t(1) << $bit$))) {\n"
+                "        return generated::Required(\"$full_name$\", err_msg);\n"
+                "    }\n");
+    }
+}
+
+static void GeneratePresence(Printer& printer, const Descriptor* descriptor) {
+    std::vector<const FieldDescriptor*> required = RequiredFields(descriptor);
+    if (!required.empty()) {
+        Vars vars;
+        vars["words"] = std::to_string((required.size() + 63) / 64);
+        printer.Print(vars, "    uint64_t present[$words$] = {};\n");
+    }
+}
+
+static void GenerateYamlLoader(Printer& printer, const Descriptor* descriptor) {
+    Vars vars;
+    vars["class"] = ClassName(descriptor);
+    vars["full_name"] = descriptor->full_name();
+    printer.Print(vars,
+            "bool LoadYaml(\n"
+            "        const YAML::Node& node,\n"
+            "        $class$& msg,\n"
+            "        bool ignore_enum_case,\n"
+            "        std::string& err_msg) {\n"
+            "    if (!node.IsMap()) {\n"
+            "        return generated::ExpectObject(\"$full_name$\", err_msg);\n"
+            "    }\n\n");
+    GeneratePresence(printer, descriptor);
+    printer.Print(
+            "    for (auto citr = node.begin(); citr != node.end(); ++citr) {\n"
+            "        const auto entry = *citr;\n"
+            "        const YAML::Node& key = entry.first;\n"
+            "        const YAML::Node& value = entry.second;\n"
+            "        // A null value is the same as a missing one.\n"
+            "        if (!key.IsScalar() || value.IsNull()) {\n"
+            "            continue;\n"
+            "        }\n"
+            "        const std::string& name = key.Scalar();\n"
+            "        int number = FieldNumber(msg, name.data(), name.size());\n");
+    Indent(printer, 2);
+    GenerateSwitch(printer, descriptor, Format::YAML);
+    Outdent(printer, 2);
+    printer.Print("    }\n");
+    GenerateRequiredChecks(printer, descriptor);
+    printer.Print(
+            "    return true;\n"
+            "}\n\n");
+}
+
+static void GenerateJsonLoader(Printer& printer, const Descriptor* descriptor) {
+    Vars vars;
+    vars["class"] = ClassName(descriptor);
+    vars["full_name"] = descriptor->full_name();
+    printer.Print(vars,
+            "bool LoadJson(\n"
+            "        JsonReader& reader,\n"
+            "        $class$& msg,\n"
+            "        bool ignore_enum_case,\n"
+            "        std::string& err_msg) {\n"
+            "    if (!reader.StartObject()) {\n"
+            "        return generated::ExpectObject(\"$full_name$\", err_msg);\n"
+            "    }\n\n");
+    GeneratePresence(printer, descriptor);
+    printer.Print(
+            "    const char* key = nullptr;\n"
+            "    size_t key_size = 0;\n"
+            "    bool end = false;\n"
+            "    while (reader.NextMember(key, key_size, end) && !end) {\n"
+            "        int number = FieldNumber(msg, key, key_size);\n"
+            "        if (number == 0) {\n"
+            "            // Not in the schema.\n"
+            "            if (!reader.Skip()) {\n"
+            "                return false;\n"
+            "            }\n"
+            "            continue;\n"
+            "        }\n"
+            "        // A null value counts as absent.\n"
+            "        if (reader.Peek() == JsonReader::NUL) {\n"
+            "            if (!reader.ReadNull()) {\n"
+            "                return false;\n"
+            "            }\n"
+            "            continue;\n"
+            "        }\n\n");
+    Indent(printer, 2);
+    GenerateSwitch(printer, descriptor, Format::JSON);
+    Outdent(printer, 2);
+    printer.Print(
+            "    }\n"
+            "    if (!end) {\n"
+            "        return false;\n"
+            "    }\n");
+    GenerateRequiredChecks(printer, descriptor);
+    printer.Print(
+            "    return true;\n"
+            "}\n\n");
+}
+
+bool PbConfGenerator::Generate(
+        const FileDescriptor* file,
+        const string& parameter,
+        GeneratorContext* context,
+        string* error) const {
+    const string basename = StripProto(file->name());
+    std::unique_ptr<ZeroCopyOutputStream> output(
+            context->Open(basename + ".pbconf.cc"));
+    Printer printer(output.get(), '$');
+
+    Vars vars;
+    vars["source"] = file->name();
+    vars["header"] = basename + ".pb.h";
+    printer.Print(vars,
+            "// Generated by protoc-gen-pbconf. DO NOT EDIT!\n"
+            "// source: $source$\n\n");
+
+    std::vector<const Descriptor*> messages;
+    if (file->options().optimize_for() != FileOptions::LITE_RUNTIME) {
+        for (int i = 0; i < file->message_type_count(); ++i) {
+            CollectMessages(file->message_type(i), messages);
+        }
+    }
+    if (messages.empty()) {
+        printer.Print("// No message type to generate a loader for.\n");
+        return !printer.failed();
+    }
+
+    printer.Print(vars,
+            "#include <cstdint>\n"
+            "#include <cstring>\n"
+            "#include <google/protobuf/descriptor.h>\n"
+            "#include <google/protobuf/message.h>\n"
+            "#include <pbconf/generated_loader.h>\n"
+            "#include <string>\n"
+            "#include <utility>\n"
+            "#include <yaml-cpp/yaml.h>\n\n"
+            "#include \"$header$\"\n\n"
+            "namespace {\n\n"
+            "using ::pbconf::JsonReader;\n"
+            "namespace generated = ::pbconf::generated;\n\n");
+
+    // Declare all loaders first, message types may refer to each other.
+    for (auto descriptor : messages) {
+        vars["class"] = ClassName(descriptor);
+        printer.Print(vars,
+                "bool LoadYaml(const YAML::Node& node, $class$& msg,\n"
+                "        bool ignore_enum_case, std::string& err_msg);\n"
+                "bool LoadJson(JsonReader& reader, $class$& msg,\n"
+                "        bool ignore_enum_case, std::string& err_msg);\n");
+    }
+    printer.Print("\n");
+
+    for (auto descriptor : messages) {
+        vars["full_name"] = descriptor->full_name();
+        printer.Print(vars, "// Begin $full_name$\n");
+        GenerateFieldNumber(printer, descriptor);
+        GenerateYamlLoader(printer, descriptor);
+        GenerateJsonLoader(printer, descriptor);
+        printer.Print(vars, "// End $full_name$\n\n");
+    }
+
+    printer.Print(
+            "template <typename T>\n"
+            "const ::google::protobuf::Message* Prototype() {\n"
+            "    return &T::default_instance();\n"
+            "}\n\n"
+            "template <typename T>\n"
+            "bool LoadYamlAs(\n"
+            "        const YAML::Node& node,\n"
+            "        ::google::protobuf::Message& msg,\n"
+            "        bool ignore_enum_case,\n"
+            "        std::string& err_msg) {\n"
+            "    return LoadYaml(node, static_cast<T&>(msg), ignore_enum_case, err_msg);\n"
+            "}\n\n"
+            "template <typename T>\n"
+            "bool LoadJsonAs(\n"
+            "        JsonReader& reader,\n"
+            "        ::google::protobuf::Message& msg,\n"
+            "        bool ignore_enum_case,\n"
+            "        std::string& err_msg) {\n"
+            "    return LoadJson(reader, static_cast<T&>(msg), ignore_enum_case, err_msg);\n"
+            "}\n\n"
+            "const ::pbconf::GeneratedLoader kLoaders[] = {\n");
+    for (auto descriptor : messages) {
+        vars["class"] = ClassName(descriptor);
+        printer.Print(vars,
+                "    {&Prototype<$class$>,\n"
+                "        &LoadYamlAs<$class$>,\n"
+                "        &LoadJsonAs<$class$>},\n");
+    }
+    printer.Print(
+            "};\n\n"
+            "struct Registrar {\n"
+            "    Registrar() {\n"
+            "        for (const auto& loader : kLoaders) {\n"
+            "            ::pbconf::RegisterGeneratedLoader(&loader);\n"
+            "        }\n"
+            "    }\n"
+            "} registrar;\n\n"
+            "}\n");
+
+    if (printer.failed()) {
+        *error = "Fail to write " + basename + ".pbconf.cc";
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,33 @@
+#ifndef PBCONF_GENERATOR_H
+#define PBCONF_GENERATOR_H
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/descriptor.h>
+#include <string>
+
+namespace pbconf {
+
+// Generates `<file>.pbconf.cc' next to `<file>.pb.cc', holding
+// a yaml and a json loader for each message type of the file.
+// The loaders register themselves when linked in,
+// see pbconf/generated_loader.h.
+//
+// Message types with extension ranges get no loader and are loaded
+// through Reflection, as are files of the lite runtime. Map fields are
+// loaded straight into their Map.
+class PbConfGenerator final : public ::google::protobuf::compiler::CodeGenerator {
+public:
+    bool Generate(
+            const ::google::protobuf::FileDescriptor* file,
+            const std::string& parameter,
+            ::google::protobuf::compiler::GeneratorContext* context,
+            std::string* error) const override;
+
+    uint64_t GetSupportedFeatures() const override {
+        return FEATURE_PROTO3_OPTIONAL;
+    }
+};
+
+}
+
+#endif
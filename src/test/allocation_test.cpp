@@ -0,0 +1,146 @@
+#include <functional>
+#include <google/protobuf/message.h>
+#include <pbconf/hocon_conf.h>
+#include <pbconf/json_conf.h>
+#include <pbconf/yaml_conf.h>
+#include <stdint.h>
+#include <string>
+
+#include "test.h"
+#include "test.pb.h"
+
+// Loading a string value allocates no more than its buffer and, in a
+// fresh message, the string holding it.
+//
+// The allocations of a field are those of a conf setting it, less those
+// of the same conf with the field renamed to an unknown one of the same
+// length, which parses the same but is skipped. The values are too long
+// to fit in the inline buffer of std::string.
+
+using ::google::protobuf::Message;
+
+typedef std::function<bool(const std::string& filename, Message& msg, std::string& err_msg)>
+    LoadFunc;
+
+static const int64_t kValues = 100;
+
+// The regrowths of the elements of a repeated field, when not reserved.
+static const int64_t kMaxRegrowths = 8;
+
+// JSON, which yaml and hocon read as well: `field' set in `kValues'
+// items, or the repeated `field' with `kValues' values. The other one
+// of `fields' is an empty list, so that both confs skip one list.
+static std::string Conf(const std::string& field, bool repeated) {
+    const std::string value = "\"" + std::string(40, 'x') + "\"";
+    std::string conf;
+    for (int64_t i = 0; i < kValues; ++i) {
+        conf += i == 0 ? "" : ", ";
+        if (repeated) {
+            conf += value;
+        } else {
+            conf += "{\"id\": " + std::to_string(i) + ", \"" + field + "\": " + value + "}";
+        }
+    }
+    if (!repeated) {
+        return "{\"items\": [" + conf + "]}";
+    }
+    const std::string other = field == "ss" ? "zz" : "ss";
+    return "{\"" + field + "\": [" + conf + "], \"" + other + "\": []}";
+}
+
+// Allocations loading `conf' through `load' a second time, the first
+// one having built the plans, into a fresh message or into the cleared
+// one of the first load. -1 on failures.
+static int64_t CountAllocations(const std::string& conf, bool cleared, const LoadFunc& load) {
+    const std::string filename = "allocation_test.conf";
+    std::string err_msg;
+    test::Everything loaded;
+    test::Everything fresh;
+    if (!pbconf::test::WriteFile(filename, conf) || !load(filename, loaded, err_msg)) {
+        return -1;
+    }
+    Message& msg = cleared ? loaded : fresh;
+    msg.Clear();
+    const int64_t before = pbconf::test::Allocations();
+    const bool ok = load(filename, msg, err_msg);
+    const int64_t allocations = pbconf::test::Allocations() - before;
+    return ok ? allocations : -1;
+}
+
+// Expect the values of the singular string field name to allocate
+// `singular' times each, and those of the repeated string field ss
+// `repeated' times each, plus the array of their elements in a fresh
+// message: once if reserved, up to kMaxRegrowths times otherwise.
+static bool ExpectAllocations(
+        const LoadFunc& load,
+        bool cleared,
+        int64_t singular,
+        int64_t repeated,
+        bool reserved,
+        std::string& err_msg) {
+    const int64_t with_name = CountAllocations(Conf("name", false), cleared, load);
+    const int64_t with_nome = CountAllocations(Conf("nome", false), cleared, load);
+    const int64_t with_ss = CountAllocations(Conf("ss", true), cleared, load);
+    const int64_t with_zz = CountAllocations(Conf("zz", true), cleared, load);
+    PBCONF_EXPECT(with_name >= 0 && with_nome >= 0 && with_ss >= 0 && with_zz >= 0);
+
+    const int64_t singular_allocations = with_name - with_nome;
+    const int64_t repeated_allocations = with_ss - with_zz;
+    const int64_t min_arrays = cleared ? 0 : 1;
+    const int64_t max_arrays = cleared ? 0 : (reserved ? 1 : kMaxRegrowths);
+    if (singular_allocations != kValues * singular
+            || repeated_allocations < kValues * repeated + min_arrays
+            || repeated_allocations > kValues * repeated + max_arrays) {
+        err_msg += std::string(cleared ? "cleared" : "fresh") + " message, "
+            + std::to_string(singular_allocations) + " singular and "
+            + std::to_string(repeated_allocations) + " repeated allocations: ";
+    }
+    PBCONF_EXPECT(singular_allocations == kValues * singular);
+    PBCONF_EXPECT(repeated_allocations >= kValues * repeated + min_arrays);
+    PBCONF_EXPECT(repeated_allocations <= kValues * repeated + max_arrays);
+    return true;
+}
+
+PBCONF_TEST(StringAllocationsYaml) {
+    LoadFunc load = [](const std::string& filename, Message& msg, std::string& err_msg) {
+        return pbconf::YamlConf().SetUseGenerated(false).Load(filename, msg, err_msg);
+    };
+    // The value read from the document is moved into the message,
+    // repeated values are read into the cleared strings.
+    PBCONF_EXPECT(ExpectAllocations(load, false, 2, 2, true, err_msg));
+    PBCONF_EXPECT(ExpectAllocations(load, true, 1, 0, true, err_msg));
+
+    // The generated loaders read into the cleared strings as well.
+    load = [](const std::string& filename, Message& msg, std::string& err_msg) {
+        return pbconf::YamlConf().Load(filename, msg, err_msg);
+    };
+    PBCONF_EXPECT(ExpectAllocations(load, false, 2, 2, true, err_msg));
+    PBCONF_EXPECT(ExpectAllocations(load, true, 0, 0, true, err_msg));
+    return true;
+}
+
+PBCONF_TEST(StringAllocationsJson) {
+    LoadFunc load = [](const std::string& filename, Message& msg, std::string& err_msg) {
+        return pbconf::JsonConf().SetUseGenerated(false).Load(filename, msg, err_msg);
+    };
+    PBCONF_EXPECT(ExpectAllocations(load, false, 2, 2, false, err_msg));
+    PBCONF_EXPECT(ExpectAllocations(load, true, 1, 0, false, err_msg));
+
+    load = [](const std::string& filename, Message& msg, std::string& err_msg) {
+        return pbconf::JsonConf().Load(filename, msg, err_msg);
+    };
+    PBCONF_EXPECT(ExpectAllocations(load, false, 2, 2, false, err_msg));
+    PBCONF_EXPECT(ExpectAllocations(load, true, 0, 0, false, err_msg));
+    return true;
+}
+
+PBCONF_TEST(StringAllocationsHocon) {
+    LoadFunc load = [](const std::string& filename, Message& msg, std::string& err_msg) {
+        return pbconf::HoconConf().Load(filename, msg, err_msg);
+    };
+    // cpp-hocon hands each value out as a new string, which is moved
+    // into the message, in place of the cleared one if any.
+    PBCONF_EXPECT(ExpectAllocations(load, false, 2, 2, true, err_msg));
+    PBCONF_EXPECT(ExpectAllocations(load, true, 1, 1, true, err_msg));
+    return true;
+}
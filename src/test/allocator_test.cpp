@@ -0,0 +1,57 @@
+#include <google/protobuf/message.h>
+#include <memory>
+#include <pbconf/message_allocator.h>
+#include <string>
+#include <thread>
+
+#include "test.h"
+#include "test.pb.h"
+
+// With reuse, a message comes back cleared once its last holder released
+// it, on any thread, and not before. Messages may outlive the allocator.
+
+using ::google::protobuf::Message;
+
+PBCONF_TEST(AllocatorReusesReleasedMessages) {
+    for (bool arena : {false, true}) {
+        pbconf::MessageAllocator allocator(test::Everything::default_instance());
+        allocator.SetArena(arena).SetReuse(true);
+
+        std::shared_ptr<Message> first = allocator.New();
+        static_cast<test::Everything&>(*first).set_s("first");
+        const Message* address = first.get();
+        std::shared_ptr<Message> second = allocator.New();
+        PBCONF_EXPECT(second.get() != address);
+
+        // Released by its last holder on another thread.
+        std::thread reader([&first]() { first.reset(); });
+        reader.join();
+        std::shared_ptr<Message> third = allocator.New();
+        PBCONF_EXPECT(third.get() == address);
+        PBCONF_EXPECT(!static_cast<test::Everything&>(*third).has_s());
+        PBCONF_EXPECT((third->GetArena() != nullptr) == arena);
+
+        // Held elsewhere, not reused.
+        std::shared_ptr<Message> reader_copy = third;
+        third.reset();
+        PBCONF_EXPECT(allocator.New().get() != address);
+        reader_copy.reset();
+    }
+    return true;
+}
+
+PBCONF_TEST(AllocatorOutlivedByMessages) {
+    for (bool arena : {false, true}) {
+        std::shared_ptr<Message> msg;
+        {
+            pbconf::MessageAllocator allocator(test::Everything::default_instance());
+            allocator.SetArena(arena).SetReuse(true);
+            allocator.New();
+            msg = allocator.New();
+        }
+        static_cast<test::Everything&>(*msg).set_s("still there");
+        PBCONF_EXPECT(static_cast<test::Everything&>(*msg).s() == "still there");
+        msg.reset();
+    }
+    return true;
+}
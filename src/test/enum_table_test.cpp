@@ -0,0 +1,66 @@
+#include <chrono>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <pbconf/enum_table.h>
+#include <string>
+
+#include "test.h"
+
+// Every name of a large enum is found, ignoring case unless another
+// name only differs by case, and its table builds quickly.
+
+using ::google::protobuf::DescriptorPool;
+using ::google::protobuf::EnumDescriptor;
+using ::google::protobuf::FileDescriptorProto;
+
+static const int kEnumValues = 10000;
+
+static bool Found(const pbconf::EnumTable& table, const std::string& name, bool ignore_case,
+        int number) {
+    const ::google::protobuf::EnumValueDescriptor* value =
+        table.FindByName(name.data(), name.size(), ignore_case);
+    return number < 0 ? value == nullptr : value && value->number() == number;
+}
+
+PBCONF_TEST(LargeEnumTable) {
+    // VALUE_<i>, then Twin and TWIN, which only differ by case.
+    FileDescriptorProto file;
+    file.set_name("enum_table_test.proto");
+    file.set_package("enum_table");
+    ::google::protobuf::EnumDescriptorProto* type = file.add_enum_type();
+    type->set_name("Large");
+    for (int i = 0; i < kEnumValues; ++i) {
+        auto* value = type->add_value();
+        value->set_name("VALUE_" + std::to_string(i));
+        value->set_number(i);
+    }
+    type->add_value()->set_name("Twin");
+    type->mutable_value(kEnumValues)->set_number(kEnumValues);
+    type->add_value()->set_name("TWIN");
+    type->mutable_value(kEnumValues + 1)->set_number(kEnumValues + 1);
+
+    DescriptorPool pool;
+    PBCONF_EXPECT(pool.BuildFile(file) != nullptr);
+    const EnumDescriptor* descriptor = pool.FindEnumTypeByName("enum_table.Large");
+    PBCONF_EXPECT(descriptor != nullptr);
+
+    const auto start = std::chrono::steady_clock::now();
+    const pbconf::EnumTable& table = pbconf::EnumTable::Get(descriptor);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed >= std::chrono::milliseconds(100)) {
+        err_msg += "built in " + std::to_string(
+                std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) + "ms: ";
+    }
+    PBCONF_EXPECT(elapsed < std::chrono::milliseconds(100));
+
+    for (int i = 0; i < kEnumValues; ++i) {
+        PBCONF_EXPECT(Found(table, "VALUE_" + std::to_string(i), false, i));
+        PBCONF_EXPECT(Found(table, "value_" + std::to_string(i), true, i));
+        PBCONF_EXPECT(Found(table, "value_" + std::to_string(i), false, -1));
+    }
+    PBCONF_EXPECT(Found(table, "VALUE_" + std::to_string(kEnumValues), true, -1));
+    PBCONF_EXPECT(Found(table, "Twin", true, kEnumValues));
+    PBCONF_EXPECT(Found(table, "TWIN", true, kEnumValues + 1));
+    PBCONF_EXPECT(Found(table, "twin", true, -1));
+    return true;
+}
@@ -0,0 +1,38 @@
+#include <atomic>
+#include <google/protobuf/dynamic_message.h>
+#include <memory>
+#include <pbconf/generated_loader.h>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+#include "test.pb.h"
+
+// Loaders are found from several threads at once, for the generated
+// classes only.
+
+PBCONF_TEST(FindGeneratedLoaderFromThreads) {
+    std::atomic<int> found(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&found]() {
+            for (int j = 0; j < 1000; ++j) {
+                const pbconf::GeneratedLoader* loader =
+                    pbconf::FindGeneratedLoader(test::Everything::default_instance());
+                if (loader && loader->prototype() == &test::Everything::default_instance()) {
+                    ++found;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    PBCONF_EXPECT(found.load() == 8 * 1000);
+
+    ::google::protobuf::DynamicMessageFactory factory;
+    std::unique_ptr<::google::protobuf::Message> dynamic(
+            factory.GetPrototype(test::Everything::descriptor())->New());
+    PBCONF_EXPECT(pbconf::FindGeneratedLoader(*dynamic) == nullptr);
+    return true;
+}
@@ -0,0 +1,34 @@
+#include <pbconf/lazy_fields.h>
+#include <pbconf/pbconf.h>
+#include <string>
+
+#include "test.h"
+#include "test.pb.h"
+
+// PbConf reads yaml conf files in tree mode when loading lazy fields,
+// even if asked to stream them.
+
+PBCONF_TEST(LazyFieldsWhileStreaming) {
+    const std::string filename = "lazy_test.yml";
+    PBCONF_EXPECT(pbconf::test::WriteFile(filename,
+                "i32: 1\n"
+                "item: {id: 2, name: two}\n"));
+
+    pbconf::LazyFields lazy;
+    lazy.AddField("item");
+    pbconf::PbConf conf;
+    conf.SetFilename(filename).SetStreaming(true).SetLazyFields(&lazy);
+    test::Everything msg;
+    const bool ok = conf.Load(msg);
+    if (!ok) {
+        err_msg += conf.ErrorMessage() + ": ";
+    }
+    PBCONF_EXPECT(ok);
+    PBCONF_EXPECT(msg.i32() == 1);
+    PBCONF_EXPECT(!msg.has_item());
+
+    std::string lazy_err;
+    const test::Item* item = lazy.Get<test::Item>("item", lazy_err);
+    PBCONF_EXPECT(item && item->id() == 2 && item->name() == "two");
+    return true;
+}
@@ -0,0 +1,80 @@
+#include <locale.h>
+#include <pbconf/number_conv.h>
+#include <string>
+
+#include "test.h"
+
+// Literals taking the fast path and the fallback one parse the same,
+// and only plain decimal literals are accepted by either.
+
+static bool Parse(const std::string& literal, double& value) {
+    return pbconf::ParseNumber(literal.data(), literal.size(), value);
+}
+
+static bool Parse(const std::string& literal, float& value) {
+    return pbconf::ParseNumber(literal.data(), literal.size(), value);
+}
+
+PBCONF_TEST(ParseDecimalLiterals) {
+    double value = 0;
+    PBCONF_EXPECT(Parse("3.14", value) && value == 3.14);
+    PBCONF_EXPECT(Parse("-2.5e3", value) && value == -2500);
+    PBCONF_EXPECT(Parse(".5", value) && value == 0.5);
+    PBCONF_EXPECT(Parse("5.", value) && value == 5);
+    // Past the exact range, through the fallback.
+    PBCONF_EXPECT(Parse("1.7976931348623157e308", value) && value == 1.7976931348623157e308);
+    PBCONF_EXPECT(Parse("0.1000000000000000000000000001", value) && value == 0.1);
+    PBCONF_EXPECT(Parse("123456789012345678901234567890", value)
+            && value == 123456789012345678901234567890.0);
+
+    float single = 0;
+    PBCONF_EXPECT(Parse("1.5", single) && single == 1.5f);
+    PBCONF_EXPECT(Parse("3.4028234e38", single) && single == 3.4028234e38f);
+    PBCONF_EXPECT(!Parse("1e39", single));
+    return true;
+}
+
+PBCONF_TEST(RejectOtherLiterals) {
+    const char* const kLiterals[] = {
+        "", "-", ".", "e5", "1e", "1e+", " 1.5", "1.5 ", "+-1", "1,5",
+        "inf", "-inf", "nan", "infinity", "0x1p3", "0x10",
+        // The same, long enough to miss the fast path.
+        " 1.00000000000000000000001", "1.00000000000000000000001 ",
+        "0x1.00000000000000000000001p3", "1,00000000000000000000001",
+    };
+    for (const char* literal : kLiterals) {
+        double value = 0;
+        float single = 0;
+        if (Parse(literal, value) || Parse(literal, single)) {
+            err_msg += std::string("accepted `") + literal + "': ";
+        }
+        PBCONF_EXPECT(!Parse(literal, value));
+        PBCONF_EXPECT(!Parse(literal, single));
+    }
+    return true;
+}
+
+// A locale with `,' as its decimal point does not change the parsing,
+// if such a locale is installed.
+PBCONF_TEST(ParseWhateverTheLocale) {
+    const char* const kLocales[] = {"de_DE.UTF-8", "de_DE", "fr_FR.UTF-8", "fr_FR"};
+    const std::string previous = setlocale(LC_NUMERIC, nullptr);
+    bool found = false;
+    for (const char* locale : kLocales) {
+        if (setlocale(LC_NUMERIC, locale)) {
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        return true;
+    }
+
+    double value = 0;
+    const bool point = Parse("0.1000000000000000000000000001", value) && value == 0.1;
+    const bool comma = Parse("0,1000000000000000000000000001", value);
+    setlocale(LC_NUMERIC, previous.c_str());
+    PBCONF_EXPECT(point);
+    PBCONF_EXPECT(!comma);
+    return true;
+}
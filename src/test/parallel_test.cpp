@@ -0,0 +1,50 @@
+#include <google/protobuf/util/message_differencer.h>
+#include <pbconf/yaml_conf.h>
+#include <string>
+
+#include "test.h"
+#include "test.pb.h"
+
+// Long lists of messages load the same in parallel as sequentially,
+// including those whose elements share nodes through aliases.
+
+enum Aliases { NONE, FIELDS, ELEMENTS };
+
+// A list long enough to be converted in parallel, whose later elements
+// alias the colors of the first ones, or the first ones themselves.
+static std::string ItemsConf(Aliases aliases) {
+    std::string conf = "items:\n";
+    for (int i = 0; i < 4096; ++i) {
+        const std::string id = std::to_string(i);
+        const std::string first = std::to_string(i % 2);
+        if (aliases == NONE) {
+            conf += "  - {id: " + id + ", colors: [RED, GREEN]}\n";
+        } else if (i < 2) {
+            conf += "  - &item" + id + " {id: " + id + ", colors: &colors" + id + " [RED, GREEN]}\n";
+        } else if (aliases == FIELDS) {
+            conf += "  - {id: " + id + ", colors: *colors" + first + "}\n";
+        } else {
+            conf += "  - *item" + first + "\n";
+        }
+    }
+    return conf;
+}
+
+PBCONF_TEST(ParallelMatchesSequential) {
+    const std::string filename = "parallel_test.yml";
+    for (Aliases aliases : {NONE, FIELDS, ELEMENTS}) {
+        PBCONF_EXPECT(pbconf::test::WriteFile(filename, ItemsConf(aliases)));
+        test::Everything sequential;
+        test::Everything parallel;
+        std::string sequential_err;
+        std::string parallel_err;
+        PBCONF_EXPECT(pbconf::YamlConf().SetUseGenerated(false)
+                .Load(filename, sequential, sequential_err));
+        PBCONF_EXPECT(pbconf::YamlConf().SetParallel(true)
+                .Load(filename, parallel, parallel_err));
+        PBCONF_EXPECT(sequential.items_size() == 4096);
+        using ::google::protobuf::util::MessageDifferencer;
+        PBCONF_EXPECT(MessageDifferencer::Equals(sequential, parallel));
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/text_format.h>
+#include <memory>
+#include <pbconf/snapshot_cache.h>
+#include <stdio.h>
+#include <string>
+
+#include "test.h"
+
+// A snapshot is only used by processes loading the same fields,
+// including the extensions linked in from files the type never imports.
+
+using ::google::protobuf::DescriptorPool;
+using ::google::protobuf::DynamicMessageFactory;
+using ::google::protobuf::FileDescriptorProto;
+using ::google::protobuf::Message;
+
+static const char kConfProto[] =
+    "name: 'conf.proto' package: 'snapshot'"
+    " message_type {"
+    "   name: 'Conf'"
+    "   field { name: 'id' number: 1 label: LABEL_OPTIONAL type: TYPE_INT32 }"
+    "   extension_range { start: 100 end: 200 }"
+    " }";
+
+static const char kExtensionProto[] =
+    "name: 'extension.proto' package: 'snapshot' dependency: 'conf.proto'"
+    " extension {"
+    "   name: 'label' number: 100 label: LABEL_OPTIONAL type: TYPE_STRING"
+    "   extendee: '.snapshot.Conf'"
+    " }";
+
+// Build `pool' from the files, which must be valid.
+static bool BuildPool(DescriptorPool& pool, bool with_extension) {
+    FileDescriptorProto conf;
+    FileDescriptorProto extension;
+    return ::google::protobuf::TextFormat::ParseFromString(kConfProto, &conf)
+        && pool.BuildFile(conf) != nullptr
+        && (!with_extension
+            || (::google::protobuf::TextFormat::ParseFromString(kExtensionProto, &extension)
+                && pool.BuildFile(extension) != nullptr));
+}
+
+PBCONF_TEST(SnapshotKeyedByExtensions) {
+    const std::string filename = "snapshot_test.yml";
+    remove((filename + ".pbcache").c_str());
+    PBCONF_EXPECT(pbconf::test::WriteFile(filename, "id: 1\n"));
+
+    DescriptorPool plain_pool;
+    DescriptorPool extended_pool;
+    PBCONF_EXPECT(BuildPool(plain_pool, false));
+    PBCONF_EXPECT(BuildPool(extended_pool, true));
+    DynamicMessageFactory plain_factory(&plain_pool);
+    DynamicMessageFactory extended_factory(&extended_pool);
+    std::unique_ptr<Message> plain(
+            plain_factory.GetPrototype(plain_pool.FindMessageTypeByName("snapshot.Conf"))->New());
+    std::unique_ptr<Message> extended(
+            extended_factory.GetPrototype(extended_pool.FindMessageTypeByName("snapshot.Conf"))->New());
+    PBCONF_EXPECT(::google::protobuf::TextFormat::ParseFromString("id: 1", plain.get()));
+
+    // Stored without the extension, the snapshot does not match with it.
+    pbconf::SnapshotCache store(filename, 0);
+    std::unique_ptr<Message> loaded(plain->New());
+    PBCONF_EXPECT(!store.Load(*loaded));
+    store.Store(*plain);
+
+    loaded.reset(plain->New());
+    PBCONF_EXPECT(pbconf::SnapshotCache(filename, 0).Load(*loaded));
+    PBCONF_EXPECT(loaded->SerializeAsString() == plain->SerializeAsString());
+    PBCONF_EXPECT(!pbconf::SnapshotCache(filename, 0).Load(*extended));
+    return true;
+}
@@ -0,0 +1,93 @@
+#include <google/protobuf/util/message_differencer.h>
+#include <pbconf/yaml_conf.h>
+#include <string>
+
+#include "test.h"
+#include "test.pb.h"
+
+// The streaming mode loads the same message as the tree mode, through
+// Reflection and through the generated loaders, and fails on the same
+// conf files.
+
+static const char* const kConfs[] = {
+    // Every kind of field.
+    "i32: -32\n"
+    "i64: -64\n"
+    "u32: 32\n"
+    "u64: 64\n"
+    "flag: true\n"
+    "f: 3.14\n"
+    "d: 3.1415926\n"
+    "s: \"Jack John's\"\n"
+    "color: GREEN\n"
+    "i32s: [1, 2, 3]\n"
+    "ds: [1.5, 2.5]\n"
+    "ss: [hello, world]\n"
+    "colors: [RED, 2, BLUE]\n"
+    "item: {id: 1, name: one, colors: [RED]}\n"
+    "items:\n"
+    "  - id: 2\n"
+    "    name: two\n"
+    "  - id: 3\n"
+    "weights: {a: 1, b: 2}\n"
+    "items_by_id:\n"
+    "  4: {id: 4, name: four}\n"
+    "  5: {id: 5}\n",
+    // Scalars given for repeated and map fields are empty lists.
+    "i32s: 1\n"
+    "ss: abc\n"
+    "colors: RED\n"
+    "items: x\n"
+    "weights: 3\n",
+    // Empty lists and maps, and null values.
+    "i32s: []\n"
+    "items: []\n"
+    "weights: {}\n"
+    "s: ~\n"
+    "item:\n",
+    // Unknown fields, with nested values.
+    "unknown: {a: [1, {b: 2}]}\n"
+    "others: [[1], {c: d}]\n"
+    "i32: 1\n",
+    // Maps as the list of their entries.
+    "weights: [{key: a, value: 1}, {key: b, value: 2}]\n"
+    "items_by_id: [{key: 4, value: {id: 4}}]\n",
+    // Errors.
+    "i32: abc\n",
+    "color: PURPLE\n",
+    "item: 3\n",
+    "items: [{name: no-id}]\n",
+    "items: [1, 2]\n",
+    "items_by_id: {x: {id: 1}}\n",
+};
+
+PBCONF_TEST(StreamingMatchesTree) {
+    const std::string filename = "streaming_test.yml";
+    for (const char* conf : kConfs) {
+        PBCONF_EXPECT(pbconf::test::WriteFile(filename, conf));
+
+        test::Everything tree;
+        test::Everything generated;
+        test::Everything streamed;
+        std::string tree_err;
+        std::string generated_err;
+        std::string streamed_err;
+        const bool tree_ok = pbconf::YamlConf().SetUseGenerated(false)
+            .Load(filename, tree, tree_err);
+        const bool generated_ok = pbconf::YamlConf()
+            .Load(filename, generated, generated_err);
+        const bool streamed_ok = pbconf::YamlConf().SetStreaming(true)
+            .Load(filename, streamed, streamed_err);
+        if (tree_ok != streamed_ok || tree_ok != generated_ok) {
+            err_msg += std::string("conf:\n") + conf;
+        }
+        PBCONF_EXPECT(tree_ok == generated_ok);
+        PBCONF_EXPECT(tree_ok == streamed_ok);
+        if (tree_ok) {
+            using ::google::protobuf::util::MessageDifferencer;
+            PBCONF_EXPECT(MessageDifferencer::Equals(tree, generated));
+            PBCONF_EXPECT(MessageDifferencer::Equals(tree, streamed));
+        }
+    }
+    return true;
+}
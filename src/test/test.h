@@ -0,0 +1,56 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pbconf {
+namespace test {
+
+// A test body checks its expectations with PBCONF_EXPECT.
+// Returns True if all of them hold; otherwise False, with err_msg filled.
+typedef std::function<bool(std::string& err_msg)> TestFunc;
+
+struct TestCase {
+    std::string name;
+    TestFunc func;
+};
+
+// All tests registered by PBCONF_TEST, in registration order.
+std::vector<TestCase>& Registry();
+
+struct Registrar {
+    Registrar(const std::string& name, TestFunc func) {
+        Registry().push_back({name, std::move(func)});
+    }
+};
+
+// Write `content' into the file named `filename', replacing it.
+bool WriteFile(const std::string& filename, const std::string& content);
+
+// The number of allocations through operator new so far,
+// which the test driver replaces to count them.
+int64_t Allocations();
+
+}
+}
+
+#define PBCONF_TEST(name) \
+    static bool name(std::string& err_msg); \
+    static ::pbconf::test::Registrar name##_registrar(#name, name); \
+    static bool name(std::string& err_msg)
+
+// Fail the running test unless `cond' holds.
+#define PBCONF_EXPECT(cond) \
+    do { \
+        if (!(cond)) { \
+            err_msg += std::string(__FILE__ ":") + std::to_string(__LINE__) \
+                + ": expect " #cond; \
+            return false; \
+        } \
+    } while (0)
+
+#endif
@@ -0,0 +1,87 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+// Count the allocations through operator new, for Allocations().
+static std::atomic<int64_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace pbconf {
+namespace test {
+
+int64_t Allocations() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+std::vector<TestCase>& Registry() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+bool WriteFile(const std::string& filename, const std::string& content) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out << content;
+    return out.good();
+}
+
+}
+}
+
+// Usage: pbconf_test [name-filter]
+// Runs the tests whose names contain the filter, all by default.
+// Returns 0 if all of them pass.
+int main(int argc, char* argv[]) {
+    const char* filter = argc > 1 ? argv[1] : "";
+
+    int failed = 0;
+    for (auto& test_case : pbconf::test::Registry()) {
+        if (!strstr(test_case.name.c_str(), filter)) {
+            continue;
+        }
+
+        std::string err_msg;
+        if (!test_case.func(err_msg)) {
+            std::cerr << test_case.name << " FAILED: " << err_msg << std::endl;
+            ++failed;
+            continue;
+        }
+        std::cout << test_case.name << "\tOK" << std::endl;
+    }
+    return failed == 0 ? 0 : -1;
+}
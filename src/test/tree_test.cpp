@@ -0,0 +1,34 @@
+#include <pbconf/yaml_conf.h>
+#include <string>
+
+#include "test.h"
+#include "test.pb.h"
+
+// The tree mode reads every key and value of the maps it walks, which
+// must outlive the iterator dereferenced for them: with references into
+// the temporary of citr->, this fails under AddressSanitizer.
+
+PBCONF_TEST(TreeModeReadsEveryEntry) {
+    const std::string filename = "tree_test.yml";
+    PBCONF_EXPECT(pbconf::test::WriteFile(filename,
+                "i32: 5\n"
+                "s: a string too long for the inline buffer\n"
+                "item: {id: 1, name: one}\n"
+                "items: [{id: 2, name: two}, {id: 3}]\n"
+                "weights: {a: 1, b: 2}\n"));
+
+    test::Everything msg;
+    std::string load_err;
+    const bool ok = pbconf::YamlConf().SetUseGenerated(false).Load(filename, msg, load_err);
+    if (!ok) {
+        err_msg += load_err + ": ";
+    }
+    PBCONF_EXPECT(ok);
+    PBCONF_EXPECT(msg.i32() == 5);
+    PBCONF_EXPECT(msg.s() == "a string too long for the inline buffer");
+    PBCONF_EXPECT(msg.item().id() == 1 && msg.item().name() == "one");
+    PBCONF_EXPECT(msg.items_size() == 2 && msg.items(0).name() == "two" && msg.items(1).id() == 3);
+    PBCONF_EXPECT(msg.weights().size() == 2 && msg.weights().at("a") == 1
+            && msg.weights().at("b") == 2);
+    return true;
+}
@@ -0,0 +1,49 @@
+#include <chrono>
+#include <cstdio>
+#include <google/protobuf/message.h>
+#include <memory>
+#include <pbconf/pbconf.h>
+#include <pbconf/pbconf_watcher.h>
+#include <string>
+#include <thread>
+
+#include "test.h"
+#include "test.pb.h"
+
+// Editing a file a hocon conf file includes reloads the conf.
+
+// Wait up to 5s for the watcher to publish a conf with `i32'.
+static bool WaitForI32(const pbconf::PbConfWatcher& watcher, int i32) {
+    for (int i = 0; i < 500; ++i) {
+        auto current = std::static_pointer_cast<const test::Everything>(watcher.Get());
+        if (current && current->i32() == i32) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+PBCONF_TEST(WatcherFollowsIncludes) {
+    const std::string filename = "watcher_test.conf";
+    const std::string included = "watcher_test_common.conf";
+    PBCONF_EXPECT(pbconf::test::WriteFile(included, "i32 = 1\n"));
+    PBCONF_EXPECT(pbconf::test::WriteFile(filename, "include \"" + included + "\"\n"));
+
+    pbconf::PbConf conf;
+    conf.SetFilename(filename);
+    pbconf::PbConfWatcher watcher(conf);
+    watcher.SetDebounceMs(10);
+    PBCONF_EXPECT(watcher.Start(test::Everything()));
+    PBCONF_EXPECT(WaitForI32(watcher, 1));
+
+    PBCONF_EXPECT(pbconf::test::WriteFile(included, "i32 = 2\n"));
+    PBCONF_EXPECT(WaitForI32(watcher, 2));
+
+    // Replaced by a rename, as editors do.
+    PBCONF_EXPECT(pbconf::test::WriteFile(included + ".tmp", "i32 = 3\n"));
+    PBCONF_EXPECT(rename((included + ".tmp").c_str(), included.c_str()) == 0);
+    PBCONF_EXPECT(WaitForI32(watcher, 3));
+    watcher.Stop();
+    return true;
+}